@@ -0,0 +1,19 @@
+
+#if !defined(MEDUSA_BUFFER_CHUNKED_STRUCT_H)
+#define MEDUSA_BUFFER_CHUNKED_STRUCT_H
+
+struct medusa_buffer_chunked_segment;
+
+TAILQ_HEAD(medusa_buffer_chunked_segments, medusa_buffer_chunked_segment);
+
+struct medusa_buffer_chunked {
+        struct medusa_buffer buffer;
+        unsigned int flags;
+        int64_t length;
+        int64_t size;
+        struct medusa_buffer_chunked_segments segments;
+};
+
+int medusa_buffer_chunked_init_with_options (struct medusa_buffer_chunked *chunked, const struct medusa_buffer_chunked_init_options *options);
+
+#endif
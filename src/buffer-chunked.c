@@ -0,0 +1,829 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <sys/uio.h>
+
+#include "error.h"
+#include "queue.h"
+#include "pool.h"
+#include "buffer.h"
+#include "buffer-struct.h"
+#include "buffer-chunked.h"
+#include "buffer-chunked-struct.h"
+
+#define MIN(a, b)                       (((a) < (b)) ? (a) : (b))
+
+#define MEDUSA_BUFFER_CHUNKED_USE_POOL  1
+#if defined(MEDUSA_BUFFER_CHUNKED_USE_POOL) && (MEDUSA_BUFFER_CHUNKED_USE_POOL == 1)
+static struct medusa_pool *g_pool_buffer_chunked;
+static struct medusa_pool *g_pool_buffer_chunked_segment;
+#endif
+
+/*
+ * data is kept in a list of segments, each with its own start offset, so
+ * consuming from the head only moves that offset or releases segments, and
+ * appending never moves stored data. segments of the default size come from
+ * a pool, larger ones made by linearize or by a short reserve are malloced.
+ * empty segments may stay behind the last data after a reserve, they are
+ * filled by the next append or commit.
+ */
+
+enum {
+        MEDUSA_BUFFER_CHUNKED_FLAG_ALLOC        = 0x80000000
+#define MEDUSA_BUFFER_CHUNKED_FLAG_ALLOC        MEDUSA_BUFFER_CHUNKED_FLAG_ALLOC
+};
+
+struct medusa_buffer_chunked_segment {
+        TAILQ_ENTRY(medusa_buffer_chunked_segment) list;
+        int64_t offset;
+        int64_t length;
+        int64_t size;
+        unsigned char data[0];
+};
+
+#define MEDUSA_BUFFER_CHUNKED_SEGMENT_DATA      ((int64_t) (MEDUSA_BUFFER_CHUNKED_SEGMENT_SIZE - sizeof(struct medusa_buffer_chunked_segment)))
+
+static struct medusa_buffer_chunked_segment * chunked_segment_create (int64_t size)
+{
+        struct medusa_buffer_chunked_segment *segment;
+        if (size <= MEDUSA_BUFFER_CHUNKED_SEGMENT_DATA) {
+                size = MEDUSA_BUFFER_CHUNKED_SEGMENT_DATA;
+#if defined(MEDUSA_BUFFER_CHUNKED_USE_POOL) && (MEDUSA_BUFFER_CHUNKED_USE_POOL == 1)
+                segment = medusa_pool_malloc(g_pool_buffer_chunked_segment);
+#else
+                segment = malloc(sizeof(struct medusa_buffer_chunked_segment) + size);
+#endif
+        } else {
+                segment = malloc(sizeof(struct medusa_buffer_chunked_segment) + size);
+        }
+        if (segment == NULL) {
+                return NULL;
+        }
+        segment->offset = 0;
+        segment->length = 0;
+        segment->size = size;
+        return segment;
+}
+
+static void chunked_segment_destroy (struct medusa_buffer_chunked_segment *segment)
+{
+        if (segment->size == MEDUSA_BUFFER_CHUNKED_SEGMENT_DATA) {
+#if defined(MEDUSA_BUFFER_CHUNKED_USE_POOL) && (MEDUSA_BUFFER_CHUNKED_USE_POOL == 1)
+                medusa_pool_free(segment);
+#else
+                free(segment);
+#endif
+        } else {
+                free(segment);
+        }
+}
+
+static void chunked_segments_destroy (struct medusa_buffer_chunked_segments *segments)
+{
+        struct medusa_buffer_chunked_segment *segment;
+        while ((segment = TAILQ_FIRST(segments)) != NULL) {
+                TAILQ_REMOVE(segments, segment, list);
+                chunked_segment_destroy(segment);
+        }
+}
+
+static inline int64_t chunked_segment_avail (const struct medusa_buffer_chunked_segment *segment)
+{
+        return segment->size - segment->offset - segment->length;
+}
+
+static void chunked_buffer_link (struct medusa_buffer_chunked *chunked, struct medusa_buffer_chunked_segment *after, struct medusa_buffer_chunked_segments *segments)
+{
+        struct medusa_buffer_chunked_segment *segment;
+        while ((segment = TAILQ_FIRST(segments)) != NULL) {
+                TAILQ_REMOVE(segments, segment, list);
+                if (after == NULL) {
+                        TAILQ_INSERT_HEAD(&chunked->segments, segment, list);
+                } else {
+                        TAILQ_INSERT_AFTER(&chunked->segments, after, segment, list);
+                }
+                chunked->size += segment->size;
+                chunked->length += segment->length;
+                after = segment;
+        }
+}
+
+static void chunked_buffer_release (struct medusa_buffer_chunked *chunked, struct medusa_buffer_chunked_segment *segment)
+{
+        if (segment == TAILQ_LAST(&chunked->segments, medusa_buffer_chunked_segments)) {
+                segment->offset = 0;
+                return;
+        }
+        TAILQ_REMOVE(&chunked->segments, segment, list);
+        chunked->size -= segment->size;
+        chunked_segment_destroy(segment);
+}
+
+static struct medusa_buffer_chunked_segment * chunked_buffer_find (const struct medusa_buffer_chunked *chunked, int64_t offset, int64_t *soffset)
+{
+        int64_t position;
+        struct medusa_buffer_chunked_segment *segment;
+        if (offset < chunked->length / 2) {
+                position = 0;
+                TAILQ_FOREACH(segment, &chunked->segments, list) {
+                        if (offset < position + segment->length) {
+                                *soffset = offset - position;
+                                return segment;
+                        }
+                        position += segment->length;
+                }
+        } else {
+                position = chunked->length;
+                TAILQ_FOREACH_REVERSE(segment, &chunked->segments, medusa_buffer_chunked_segments, list) {
+                        position -= segment->length;
+                        if (segment->length > 0 &&
+                            offset >= position) {
+                                *soffset = offset - position;
+                                return segment;
+                        }
+                }
+        }
+        return NULL;
+}
+
+static struct medusa_buffer_chunked_segment * chunked_buffer_tail (const struct medusa_buffer_chunked *chunked)
+{
+        struct medusa_buffer_chunked_segment *segment;
+        TAILQ_FOREACH_REVERSE(segment, &chunked->segments, medusa_buffer_chunked_segments, list) {
+                if (segment->length > 0) {
+                        return segment;
+                }
+        }
+        return TAILQ_FIRST(&chunked->segments);
+}
+
+static int chunked_buffer_reserve (struct medusa_buffer_chunked *chunked, int64_t length)
+{
+        int64_t avail;
+        struct medusa_buffer_chunked_segment *segment;
+        avail = 0;
+        for (segment = chunked_buffer_tail(chunked); segment != NULL; segment = TAILQ_NEXT(segment, list)) {
+                avail += chunked_segment_avail(segment);
+        }
+        while (avail < length) {
+                segment = chunked_segment_create(MEDUSA_BUFFER_CHUNKED_SEGMENT_DATA);
+                if (segment == NULL) {
+                        return -ENOMEM;
+                }
+                TAILQ_INSERT_TAIL(&chunked->segments, segment, list);
+                chunked->size += segment->size;
+                avail += segment->size;
+        }
+        return 0;
+}
+
+static int64_t chunked_buffer_appendv (struct medusa_buffer_chunked *chunked, const struct iovec *iovecs, int64_t niovecs, int64_t length)
+{
+        int rc;
+        int64_t i;
+        int64_t l;
+        int64_t n;
+        struct medusa_buffer_chunked_segment *segment;
+        rc = chunked_buffer_reserve(chunked, length);
+        if (rc < 0) {
+                return rc;
+        }
+        segment = chunked_buffer_tail(chunked);
+        for (i = 0; i < niovecs; i++) {
+                l = 0;
+                while (l < (int64_t) iovecs[i].iov_len) {
+                        n = MIN(chunked_segment_avail(segment), (int64_t) iovecs[i].iov_len - l);
+                        if (n == 0) {
+                                segment = TAILQ_NEXT(segment, list);
+                                continue;
+                        }
+                        memcpy(segment->data + segment->offset + segment->length, iovecs[i].iov_base + l, n);
+                        segment->length += n;
+                        l += n;
+                }
+        }
+        chunked->length += length;
+        return length;
+}
+
+static int64_t chunked_buffer_copyv (unsigned char *data, const struct iovec *iovecs, int64_t niovecs)
+{
+        int64_t i;
+        int64_t length;
+        length = 0;
+        for (i = 0; i < niovecs; i++) {
+                memcpy(data + length, iovecs[i].iov_base, iovecs[i].iov_len);
+                length += iovecs[i].iov_len;
+        }
+        return length;
+}
+
+static int64_t chunked_buffer_insertv (struct medusa_buffer *buffer, int64_t offset, const struct iovec *iovecs, int64_t niovecs)
+{
+        int64_t i;
+        int64_t l;
+        int64_t n;
+        int64_t length;
+        int64_t soffset;
+        struct medusa_buffer_chunked_segment *after;
+        struct medusa_buffer_chunked_segment *split;
+        struct medusa_buffer_chunked_segment *segment;
+        struct medusa_buffer_chunked_segments segments;
+        struct medusa_buffer_chunked *chunked = (struct medusa_buffer_chunked *) buffer;
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return -EINVAL;
+        }
+        if (offset < 0) {
+                offset = chunked->length + offset;
+        }
+        if (offset < 0) {
+                return -EINVAL;
+        }
+        if (offset > chunked->length) {
+                return -EINVAL;
+        }
+        if (niovecs < 0) {
+                return -EINVAL;
+        }
+        if (niovecs == 0) {
+                return 0;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(iovecs)) {
+                return -EINVAL;
+        }
+        length = 0;
+        for (i = 0; i < niovecs; i++) {
+                length += iovecs[i].iov_len;
+        }
+        if (length == 0) {
+                return 0;
+        }
+        if (offset == chunked->length) {
+                return chunked_buffer_appendv(chunked, iovecs, niovecs, length);
+        }
+        segment = chunked_buffer_find(chunked, offset, &soffset);
+        if (segment == NULL) {
+                return -EIO;
+        }
+        if (soffset == 0 &&
+            segment->offset >= length) {
+                segment->offset -= length;
+                segment->length += length;
+                chunked->length += length;
+                chunked_buffer_copyv(segment->data + segment->offset, iovecs, niovecs);
+                return length;
+        }
+        if (chunked_segment_avail(segment) >= length) {
+                memmove(segment->data + segment->offset + soffset + length, segment->data + segment->offset + soffset, segment->length - soffset);
+                segment->length += length;
+                chunked->length += length;
+                chunked_buffer_copyv(segment->data + segment->offset + soffset, iovecs, niovecs);
+                return length;
+        }
+        TAILQ_INIT(&segments);
+        split = NULL;
+        for (l = 0; l < length; l += MEDUSA_BUFFER_CHUNKED_SEGMENT_DATA) {
+                after = chunked_segment_create(MEDUSA_BUFFER_CHUNKED_SEGMENT_DATA);
+                if (after == NULL) {
+                        goto bail;
+                }
+                TAILQ_INSERT_TAIL(&segments, after, list);
+        }
+        if (soffset > 0) {
+                split = chunked_segment_create(segment->length - soffset);
+                if (split == NULL) {
+                        goto bail;
+                }
+        }
+        after = TAILQ_FIRST(&segments);
+        for (i = 0; i < niovecs; i++) {
+                l = 0;
+                while (l < (int64_t) iovecs[i].iov_len) {
+                        n = MIN(chunked_segment_avail(after), (int64_t) iovecs[i].iov_len - l);
+                        if (n == 0) {
+                                after = TAILQ_NEXT(after, list);
+                                continue;
+                        }
+                        memcpy(after->data + after->length, iovecs[i].iov_base + l, n);
+                        after->length += n;
+                        l += n;
+                }
+        }
+        if (split != NULL) {
+                split->length = segment->length - soffset;
+                memcpy(split->data, segment->data + segment->offset + soffset, split->length);
+                segment->length = soffset;
+                chunked->length -= split->length;
+                TAILQ_INSERT_TAIL(&segments, split, list);
+                after = segment;
+        } else {
+                after = TAILQ_PREV(segment, medusa_buffer_chunked_segments, list);
+        }
+        chunked_buffer_link(chunked, after, &segments);
+        return length;
+bail:   chunked_segments_destroy(&segments);
+        return -ENOMEM;
+}
+
+static int64_t chunked_buffer_insertfv (struct medusa_buffer *buffer, int64_t offset, const char *format, va_list va)
+{
+        int rc;
+        int length;
+        char *data;
+        va_list vs;
+        struct iovec iovec;
+        struct medusa_buffer_chunked *chunked = (struct medusa_buffer_chunked *) buffer;
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return -EINVAL;
+        }
+        va_copy(vs, va);
+        length = vsnprintf(NULL, 0, format, vs);
+        va_end(vs);
+        if (length < 0) {
+                return -EIO;
+        }
+        data = malloc(length + 1);
+        if (data == NULL) {
+                return -ENOMEM;
+        }
+        va_copy(vs, va);
+        rc = vsnprintf(data, length + 1, format, vs);
+        va_end(vs);
+        if (rc < 0) {
+                free(data);
+                return -EIO;
+        }
+        iovec.iov_base = data;
+        iovec.iov_len  = rc;
+        rc = chunked_buffer_insertv(buffer, offset, &iovec, 1);
+        free(data);
+        return rc;
+}
+
+static int64_t chunked_buffer_reservev (struct medusa_buffer *buffer, int64_t length, struct iovec *iovecs, int64_t niovecs)
+{
+        int rc;
+        int64_t n;
+        int64_t count;
+        int64_t avail;
+        int64_t remaining;
+        struct medusa_buffer_chunked_segment *segment;
+        struct medusa_buffer_chunked *chunked = (struct medusa_buffer_chunked *) buffer;
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return -EINVAL;
+        }
+        if (length < 0) {
+                return -EINVAL;
+        }
+        if (length == 0) {
+                return 0;
+        }
+        if (niovecs < 0) {
+                return -EINVAL;
+        }
+        count = 0;
+        remaining = length;
+        for (segment = chunked_buffer_tail(chunked); segment != NULL && remaining > 0; segment = TAILQ_NEXT(segment, list)) {
+                avail = chunked_segment_avail(segment);
+                if (avail > 0) {
+                        count += 1;
+                        remaining -= MIN(avail, remaining);
+                }
+        }
+        count += (remaining + MEDUSA_BUFFER_CHUNKED_SEGMENT_DATA - 1) / MEDUSA_BUFFER_CHUNKED_SEGMENT_DATA;
+        if (niovecs == 0) {
+                return count;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(iovecs)) {
+                return -EINVAL;
+        }
+        if (count > niovecs) {
+                for (segment = chunked_buffer_tail(chunked); segment != NULL; segment = TAILQ_NEXT(segment, list)) {
+                        if (segment->length == 0 &&
+                            chunked_segment_avail(segment) >= length) {
+                                break;
+                        }
+                }
+                if (segment == NULL) {
+                        segment = chunked_segment_create(length);
+                        if (segment == NULL) {
+                                return -ENOMEM;
+                        }
+                        TAILQ_INSERT_TAIL(&chunked->segments, segment, list);
+                        chunked->size += segment->size;
+                }
+                iovecs[0].iov_base = segment->data + segment->offset;
+                iovecs[0].iov_len  = length;
+                return 1;
+        }
+        rc = chunked_buffer_reserve(chunked, length);
+        if (rc < 0) {
+                return rc;
+        }
+        count = 0;
+        remaining = length;
+        for (segment = chunked_buffer_tail(chunked); segment != NULL && remaining > 0; segment = TAILQ_NEXT(segment, list)) {
+                n = MIN(chunked_segment_avail(segment), remaining);
+                if (n > 0) {
+                        iovecs[count].iov_base = segment->data + segment->offset + segment->length;
+                        iovecs[count].iov_len  = n;
+                        count += 1;
+                        remaining -= n;
+                }
+        }
+        return count;
+}
+
+static int chunked_buffer_commit (struct medusa_buffer_chunked *chunked, const struct iovec *iovecs, int64_t niovecs, int apply)
+{
+        int64_t i;
+        int64_t used;
+        unsigned char *base;
+        struct medusa_buffer_chunked_segment *segment;
+        segment = chunked_buffer_tail(chunked);
+        used = (segment != NULL) ? segment->offset + segment->length : 0;
+        for (i = 0; i < niovecs; i++) {
+                if (iovecs[i].iov_len == 0) {
+                        continue;
+                }
+                base = iovecs[i].iov_base;
+                while (segment != NULL) {
+                        if (base == segment->data + used &&
+                            base + iovecs[i].iov_len <= segment->data + segment->size) {
+                                break;
+                        }
+                        segment = TAILQ_NEXT(segment, list);
+                        used = (segment != NULL) ? segment->offset + segment->length : 0;
+                }
+                if (segment == NULL) {
+                        return -EINVAL;
+                }
+                used += iovecs[i].iov_len;
+                if (apply) {
+                        segment->length += iovecs[i].iov_len;
+                        chunked->length += iovecs[i].iov_len;
+                }
+        }
+        return 0;
+}
+
+static int64_t chunked_buffer_commitv (struct medusa_buffer *buffer, const struct iovec *iovecs, int64_t niovecs)
+{
+        int rc;
+        struct medusa_buffer_chunked *chunked = (struct medusa_buffer_chunked *) buffer;
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return -EINVAL;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(iovecs)) {
+                return -EINVAL;
+        }
+        if (niovecs < 0) {
+                return -EINVAL;
+        }
+        if (niovecs == 0) {
+                return 0;
+        }
+        rc = chunked_buffer_commit(chunked, iovecs, niovecs, 0);
+        if (rc < 0) {
+                return rc;
+        }
+        chunked_buffer_commit(chunked, iovecs, niovecs, 1);
+        return niovecs;
+}
+
+static int64_t chunked_buffer_queryv (const struct medusa_buffer *buffer, int64_t offset, int64_t length, struct iovec *iovecs, int64_t niovecs)
+{
+        int64_t n;
+        int64_t count;
+        int64_t soffset;
+        struct medusa_buffer_chunked_segment *segment;
+        struct medusa_buffer_chunked *chunked = (struct medusa_buffer_chunked *) buffer;
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return -EINVAL;
+        }
+        if (niovecs < 0) {
+                return -EINVAL;
+        }
+        if (offset < 0) {
+                offset = chunked->length + offset;
+        }
+        if (offset < 0) {
+                return -EINVAL;
+        }
+        if (offset > chunked->length) {
+                offset = chunked->length;
+        }
+        if (length < 0) {
+                length = chunked->length - offset;
+        }
+        if (length < 0) {
+                return -EINVAL;
+        }
+        if (length > chunked->length - offset) {
+                length = chunked->length - offset;
+        }
+        if (length == 0) {
+                return 0;
+        }
+        segment = chunked_buffer_find(chunked, offset, &soffset);
+        if (segment == NULL) {
+                return -EIO;
+        }
+        count = 0;
+        while (segment != NULL && length > 0) {
+                n = MIN(segment->length - soffset, length);
+                if (n > 0) {
+                        if (niovecs > 0) {
+                                iovecs[count].iov_base = segment->data + segment->offset + soffset;
+                                iovecs[count].iov_len  = n;
+                        }
+                        count += 1;
+                        length -= n;
+                        if (count == niovecs) {
+                                break;
+                        }
+                }
+                soffset = 0;
+                segment = TAILQ_NEXT(segment, list);
+        }
+        return count;
+}
+
+static int64_t chunked_buffer_choke (struct medusa_buffer *buffer, int64_t offset, int64_t length)
+{
+        int64_t n;
+        int64_t left;
+        int64_t soffset;
+        struct medusa_buffer_chunked_segment *next;
+        struct medusa_buffer_chunked_segment *segment;
+        struct medusa_buffer_chunked *chunked = (struct medusa_buffer_chunked *) buffer;
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return -EINVAL;
+        }
+        if (offset < 0) {
+                offset = chunked->length + offset;
+        }
+        if (offset < 0) {
+                return -EINVAL;
+        }
+        if (offset > chunked->length) {
+                offset = chunked->length;
+        }
+        if (length < 0) {
+                length = chunked->length - offset;
+        }
+        if (length < 0) {
+                return -EINVAL;
+        }
+        if (length > chunked->length - offset) {
+                length = chunked->length - offset;
+        }
+        if (length == 0) {
+                return 0;
+        }
+        segment = chunked_buffer_find(chunked, offset, &soffset);
+        if (segment == NULL) {
+                return -EIO;
+        }
+        n = MIN(segment->length - soffset, length);
+        if (soffset == 0) {
+                segment->offset += n;
+        } else if (soffset + n < segment->length) {
+                memmove(segment->data + segment->offset + soffset, segment->data + segment->offset + soffset + n, segment->length - soffset - n);
+        }
+        segment->length -= n;
+        left = length - n;
+        next = TAILQ_NEXT(segment, list);
+        if (segment->length == 0) {
+                chunked_buffer_release(chunked, segment);
+        }
+        while (left > 0) {
+                segment = next;
+                next = TAILQ_NEXT(segment, list);
+                n = MIN(segment->length, left);
+                segment->offset += n;
+                segment->length -= n;
+                left -= n;
+                if (segment->length == 0) {
+                        chunked_buffer_release(chunked, segment);
+                }
+        }
+        chunked->length -= length;
+        return length;
+}
+
+static void * chunked_buffer_linearize (struct medusa_buffer *buffer, int64_t offset, int64_t length)
+{
+        int64_t n;
+        int64_t copied;
+        int64_t soffset;
+        struct medusa_buffer_chunked_segment *linear;
+        struct medusa_buffer_chunked_segment *segment;
+        struct medusa_buffer_chunked_segments segments;
+        struct medusa_buffer_chunked *chunked = (struct medusa_buffer_chunked *) buffer;
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return MEDUSA_ERR_PTR(-EINVAL);
+        }
+        if (offset < 0) {
+                offset = chunked->length + offset;
+        }
+        if (offset < 0) {
+                return MEDUSA_ERR_PTR(-EINVAL);
+        }
+        if (offset > chunked->length) {
+                return MEDUSA_ERR_PTR(-EINVAL);
+        }
+        if (length < 0) {
+                return MEDUSA_ERR_PTR(-EINVAL);
+        }
+        if (offset + length > chunked->length) {
+                return MEDUSA_ERR_PTR(-EINVAL);
+        }
+        if (offset == chunked->length) {
+                segment = chunked_buffer_tail(chunked);
+                if (segment == NULL) {
+                        return NULL;
+                }
+                return segment->data + segment->offset + segment->length;
+        }
+        segment = chunked_buffer_find(chunked, offset, &soffset);
+        if (segment == NULL) {
+                return MEDUSA_ERR_PTR(-EIO);
+        }
+        if (soffset + length <= segment->length) {
+                return segment->data + segment->offset + soffset;
+        }
+        linear = chunked_segment_create(length);
+        if (linear == NULL) {
+                return MEDUSA_ERR_PTR(-ENOMEM);
+        }
+        for (copied = 0; copied < length; copied += n) {
+                n = MIN(segment->length - soffset, length - copied);
+                memcpy(linear->data + copied, segment->data + segment->offset + soffset, n);
+                soffset = 0;
+                segment = TAILQ_NEXT(segment, list);
+        }
+        linear->length = length;
+        chunked_buffer_choke(buffer, offset, length);
+        segment = (offset > 0) ? chunked_buffer_find(chunked, offset - 1, &soffset) : NULL;
+        TAILQ_INIT(&segments);
+        TAILQ_INSERT_TAIL(&segments, linear, list);
+        chunked_buffer_link(chunked, segment, &segments);
+        return linear->data;
+}
+
+static int64_t chunked_buffer_get_size (const struct medusa_buffer *buffer)
+{
+        struct medusa_buffer_chunked *chunked = (struct medusa_buffer_chunked *) buffer;
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return -EINVAL;
+        }
+        return chunked->size;
+}
+
+static int64_t chunked_buffer_get_length (const struct medusa_buffer *buffer)
+{
+        struct medusa_buffer_chunked *chunked = (struct medusa_buffer_chunked *) buffer;
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return -EINVAL;
+        }
+        return chunked->length;
+}
+
+static int chunked_buffer_reset (struct medusa_buffer *buffer)
+{
+        struct medusa_buffer_chunked *chunked = (struct medusa_buffer_chunked *) buffer;
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return -EINVAL;
+        }
+        chunked_segments_destroy(&chunked->segments);
+        chunked->length = 0;
+        chunked->size = 0;
+        return 0;
+}
+
+static void chunked_buffer_destroy (struct medusa_buffer *buffer)
+{
+        struct medusa_buffer_chunked *chunked = (struct medusa_buffer_chunked *) buffer;
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return;
+        }
+        chunked_segments_destroy(&chunked->segments);
+        if (chunked->flags & MEDUSA_BUFFER_CHUNKED_FLAG_ALLOC) {
+#if defined(MEDUSA_BUFFER_CHUNKED_USE_POOL) && (MEDUSA_BUFFER_CHUNKED_USE_POOL == 1)
+                medusa_pool_free(chunked);
+#else
+                free(chunked);
+#endif
+        } else {
+                memset(chunked, 0, sizeof(struct medusa_buffer_chunked));
+        }
+}
+
+const struct medusa_buffer_backend chunked_buffer_backend = {
+        .get_size       = chunked_buffer_get_size,
+        .get_length     = chunked_buffer_get_length,
+
+        .insertv        = chunked_buffer_insertv,
+        .insertfv       = chunked_buffer_insertfv,
+
+        .reservev       = chunked_buffer_reservev,
+        .commitv        = chunked_buffer_commitv,
+
+        .queryv         = chunked_buffer_queryv,
+        .choke          = chunked_buffer_choke,
+
+        .linearize      = chunked_buffer_linearize,
+
+        .reset          = chunked_buffer_reset,
+        .destroy        = chunked_buffer_destroy
+};
+
+int medusa_buffer_chunked_init_options_default (struct medusa_buffer_chunked_init_options *options)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(options)) {
+                return -EINVAL;
+        }
+        memset(options, 0, sizeof(struct medusa_buffer_chunked_init_options));
+        options->flags = MEDUSA_BUFFER_CHUNKED_FLAG_DEFAULT;
+        return 0;
+}
+
+struct medusa_buffer * medusa_buffer_chunked_create (unsigned int flags)
+{
+        int rc;
+        struct medusa_buffer_chunked_init_options options;
+        rc = medusa_buffer_chunked_init_options_default(&options);
+        if (rc < 0) {
+                return MEDUSA_ERR_PTR(rc);
+        }
+        options.flags = flags;
+        return medusa_buffer_chunked_create_with_options(&options);
+}
+
+int medusa_buffer_chunked_init_with_options (struct medusa_buffer_chunked *chunked, const struct medusa_buffer_chunked_init_options *options)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return -EINVAL;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(options)) {
+                return -EINVAL;
+        }
+        memset(chunked, 0, sizeof(struct medusa_buffer_chunked));
+        TAILQ_INIT(&chunked->segments);
+        chunked->buffer.backend = &chunked_buffer_backend;
+        return 0;
+}
+
+struct medusa_buffer * medusa_buffer_chunked_create_with_options (const struct medusa_buffer_chunked_init_options *options)
+{
+        int rc;
+        struct medusa_buffer_chunked *chunked;
+        if (MEDUSA_IS_ERR_OR_NULL(options)) {
+                return MEDUSA_ERR_PTR(-EINVAL);
+        }
+#if defined(MEDUSA_BUFFER_CHUNKED_USE_POOL) && (MEDUSA_BUFFER_CHUNKED_USE_POOL == 1)
+        chunked = medusa_pool_malloc(g_pool_buffer_chunked);
+#else
+        chunked = malloc(sizeof(struct medusa_buffer_chunked));
+#endif
+        if (MEDUSA_IS_ERR_OR_NULL(chunked)) {
+                return MEDUSA_ERR_PTR(-ENOMEM);
+        }
+        rc = medusa_buffer_chunked_init_with_options(chunked, options);
+        if (rc < 0) {
+#if defined(MEDUSA_BUFFER_CHUNKED_USE_POOL) && (MEDUSA_BUFFER_CHUNKED_USE_POOL == 1)
+                medusa_pool_free(chunked);
+#else
+                free(chunked);
+#endif
+                return MEDUSA_ERR_PTR(rc);
+        }
+        chunked->flags |= MEDUSA_BUFFER_CHUNKED_FLAG_ALLOC;
+        return &chunked->buffer;
+}
+
+__attribute__ ((constructor)) static void buffer_chunked_constructor (void)
+{
+#if defined(MEDUSA_BUFFER_CHUNKED_USE_POOL) && (MEDUSA_BUFFER_CHUNKED_USE_POOL == 1)
+        g_pool_buffer_chunked = medusa_pool_create("medusa-buffer-chunked", sizeof(struct medusa_buffer_chunked), 0, 0, MEDUSA_POOL_FLAG_DEFAULT | MEDUSA_POOL_FLAG_THREAD_SAFE, NULL, NULL, NULL);
+        g_pool_buffer_chunked_segment = medusa_pool_create("medusa-buffer-chunked-segment", MEDUSA_BUFFER_CHUNKED_SEGMENT_SIZE, 0, 0, MEDUSA_POOL_FLAG_DEFAULT | MEDUSA_POOL_FLAG_THREAD_SAFE, NULL, NULL, NULL);
+#endif
+}
+
+__attribute__ ((destructor)) static void buffer_chunked_destructor (void)
+{
+#if defined(MEDUSA_BUFFER_CHUNKED_USE_POOL) && (MEDUSA_BUFFER_CHUNKED_USE_POOL == 1)
+        if (g_pool_buffer_chunked_segment != NULL) {
+                medusa_pool_destroy(g_pool_buffer_chunked_segment);
+        }
+        if (g_pool_buffer_chunked != NULL) {
+                medusa_pool_destroy(g_pool_buffer_chunked);
+        }
+#endif
+}
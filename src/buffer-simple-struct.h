@@ -4,10 +4,13 @@
 
 struct medusa_buffer_simple {
         struct medusa_buffer buffer;
+        unsigned int flags;
         int64_t grow;
         int64_t length;
         int64_t size;
         void *data;
 };
 
+int medusa_buffer_simple_init_with_options (struct medusa_buffer_simple *simple, const struct medusa_buffer_simple_init_options *options);
+
 #endif
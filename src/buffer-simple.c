@@ -22,6 +22,11 @@
 static struct medusa_pool *g_pool_buffer_simple;
 #endif
 
+enum {
+        MEDUSA_BUFFER_SIMPLE_FLAG_ALLOC         = 0x80000000
+#define MEDUSA_BUFFER_SIMPLE_FLAG_ALLOC         MEDUSA_BUFFER_SIMPLE_FLAG_ALLOC
+};
+
 static int simple_buffer_resize (struct medusa_buffer *buffer, int64_t size)
 {
         void *data;
@@ -333,11 +338,15 @@ static void simple_buffer_destroy (struct medusa_buffer *buffer)
         if (simple->data != NULL) {
                 free(simple->data);
         }
+        if (simple->flags & MEDUSA_BUFFER_SIMPLE_FLAG_ALLOC) {
 #if defined(MEDUSA_BUFFER_SIMPLE_USE_POOL) && (MEDUSA_BUFFER_SIMPLE_USE_POOL == 1)
-        medusa_pool_free(simple);
+                medusa_pool_free(simple);
 #else
-        free(simple);
+                free(simple);
 #endif
+        } else {
+                memset(simple, 0, sizeof(struct medusa_buffer_simple));
+        }
 }
 
 const struct medusa_buffer_backend simple_buffer_backend = {
@@ -384,8 +393,26 @@ struct medusa_buffer * medusa_buffer_simple_create (unsigned int flags, unsigned
 
 }
 
+int medusa_buffer_simple_init_with_options (struct medusa_buffer_simple *simple, const struct medusa_buffer_simple_init_options *options)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(simple)) {
+                return -EINVAL;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(options)) {
+                return -EINVAL;
+        }
+        memset(simple, 0, sizeof(struct medusa_buffer_simple));
+        simple->grow = options->grow;
+        if (simple->grow <= 0) {
+                simple->grow = MEDUSA_BUFFER_SIMPLE_DEFAULT_GROW;
+        }
+        simple->buffer.backend = &simple_buffer_backend;
+        return 0;
+}
+
 struct medusa_buffer * medusa_buffer_simple_create_with_options (const struct medusa_buffer_simple_init_options *options)
 {
+        int rc;
         struct medusa_buffer_simple *simple;
         if (MEDUSA_IS_ERR_OR_NULL(options)) {
                 return MEDUSA_ERR_PTR(-EINVAL);
@@ -398,12 +425,16 @@ struct medusa_buffer * medusa_buffer_simple_create_with_options (const struct me
         if (MEDUSA_IS_ERR_OR_NULL(simple)) {
                 return MEDUSA_ERR_PTR(-ENOMEM);
         }
-        memset(simple, 0, sizeof(struct medusa_buffer_simple));
-        simple->grow = options->grow;
-        if (simple->grow <= 0) {
-                simple->grow = MEDUSA_BUFFER_SIMPLE_DEFAULT_GROW;
+        rc = medusa_buffer_simple_init_with_options(simple, options);
+        if (rc < 0) {
+#if defined(MEDUSA_BUFFER_SIMPLE_USE_POOL) && (MEDUSA_BUFFER_SIMPLE_USE_POOL == 1)
+                medusa_pool_free(simple);
+#else
+                free(simple);
+#endif
+                return MEDUSA_ERR_PTR(rc);
         }
-        simple->buffer.backend = &simple_buffer_backend;
+        simple->flags |= MEDUSA_BUFFER_SIMPLE_FLAG_ALLOC;
         return &simple->buffer;
 }
 
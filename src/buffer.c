@@ -13,6 +13,7 @@
 #include "buffer.h"
 #include "buffer-struct.h"
 #include "buffer-simple.h"
+#include "buffer-chunked.h"
 
 #define MIN(a, b)       (((a) < (b)) ? (a) : (b))
 
@@ -1098,6 +1099,15 @@ __attribute__ ((visibility ("default"))) struct medusa_buffer * medusa_buffer_cr
                 simple_options.flags = MEDUSA_BUFFER_SIMPLE_FLAG_DEFAULT;
                 simple_options.grow = options->u.simple.grow_size;
                 return medusa_buffer_simple_create_with_options(&simple_options);
+        } else if (options->type == MEDUSA_BUFFER_TYPE_CHUNKED) {
+                int rc;
+                struct medusa_buffer_chunked_init_options chunked_options;
+                rc = medusa_buffer_chunked_init_options_default(&chunked_options);
+                if (rc < 0) {
+                        return MEDUSA_ERR_PTR(rc);
+                }
+                chunked_options.flags = MEDUSA_BUFFER_CHUNKED_FLAG_DEFAULT;
+                return medusa_buffer_chunked_create_with_options(&chunked_options);
         } else {
                 return MEDUSA_ERR_PTR(-ENOENT);
         }
@@ -7,8 +7,10 @@ struct medusa_buffer;
 
 enum {
         MEDUSA_BUFFER_TYPE_SIMPLE       = 0,
+        MEDUSA_BUFFER_TYPE_CHUNKED      = 1,
         MEDUSA_BUFFER_TYPE_DEFAULT      = MEDUSA_BUFFER_TYPE_SIMPLE
 #define MEDUSA_BUFFER_TYPE_SIMPLE       MEDUSA_BUFFER_TYPE_SIMPLE
+#define MEDUSA_BUFFER_TYPE_CHUNKED      MEDUSA_BUFFER_TYPE_CHUNKED
 #define MEDUSA_BUFFER_TYPE_DEFAULT      MEDUSA_BUFFER_TYPE_DEFAULT
 };
 
@@ -2,6 +2,12 @@
 #include <errno.h>
 #include <time.h>
 
+#if defined(__x86_64__)
+#include <pthread.h>
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
 #include "error.h"
 
 __attribute__ ((visibility ("default"))) int medusa_clock_monotonic (struct timespec *timespec)
@@ -29,3 +35,171 @@ __attribute__ ((visibility ("default"))) int medusa_clock_monotonic_raw (struct
         }
         return 0;
 }
+
+__attribute__ ((visibility ("default"))) int medusa_clock_monotonic_coarse (struct timespec *timespec)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(timespec)) {
+                return -EINVAL;
+        }
+#if defined(CLOCK_MONOTONIC_COARSE)
+        rc = clock_gettime(CLOCK_MONOTONIC_COARSE, timespec);
+#else
+        rc = clock_gettime(CLOCK_MONOTONIC, timespec);
+#endif
+        if (rc < 0) {
+                return -errno;
+        }
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_clock_monotonic_coarse_resolution (struct timespec *timespec)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(timespec)) {
+                return -EINVAL;
+        }
+#if defined(CLOCK_MONOTONIC_COARSE)
+        rc = clock_getres(CLOCK_MONOTONIC_COARSE, timespec);
+#else
+        rc = clock_getres(CLOCK_MONOTONIC, timespec);
+#endif
+        if (rc < 0) {
+                return -errno;
+        }
+        return 0;
+}
+
+#if defined(__x86_64__)
+
+#define MEDUSA_CLOCK_FAST_SHIFT         32
+#define MEDUSA_CLOCK_FAST_CALIBRATE     1000000ULL
+#define MEDUSA_CLOCK_FAST_RECALIBRATE   1000000000ULL
+
+/*
+ * tsc to nanoseconds conversion, readers take a consistent snapshot via
+ * the sequence counter, recalibration is done by whichever caller wins
+ * the busy flag once the recalibrate mark is passed.
+ */
+static struct {
+        int init;
+        int tsc;
+        unsigned int seq;
+        unsigned int busy;
+        unsigned long long tsc_base;
+        unsigned long long nsec_base;
+        unsigned long long tsc_anchor;
+        unsigned long long nsec_anchor;
+        unsigned long long tsc_next;
+        unsigned long long mult;
+} g_clock_fast;
+static pthread_once_t g_clock_fast_once = PTHREAD_ONCE_INIT;
+
+static inline unsigned long long clock_fast_nsec (void)
+{
+        struct timespec timespec;
+        clock_gettime(CLOCK_MONOTONIC, &timespec);
+        return timespec.tv_sec * 1000000000ULL + timespec.tv_nsec;
+}
+
+static inline unsigned long long clock_fast_convert (unsigned long long tsc, unsigned long long tsc_base, unsigned long long nsec_base, unsigned long long mult)
+{
+        return nsec_base + (unsigned long long) (((unsigned __int128) (tsc - tsc_base) * mult) >> MEDUSA_CLOCK_FAST_SHIFT);
+}
+
+static void clock_fast_recalibrate (void)
+{
+        unsigned long long tsc;
+        unsigned long long mult;
+        unsigned long long nsec;
+        unsigned long long base;
+        if (__atomic_exchange_n(&g_clock_fast.busy, 1, __ATOMIC_ACQUIRE) != 0) {
+                return;
+        }
+        nsec = clock_fast_nsec();
+        tsc  = __rdtsc();
+        mult = (unsigned long long) (((unsigned __int128) (nsec - g_clock_fast.nsec_anchor) << MEDUSA_CLOCK_FAST_SHIFT) / (tsc - g_clock_fast.tsc_anchor));
+        base = clock_fast_convert(tsc, g_clock_fast.tsc_base, g_clock_fast.nsec_base, g_clock_fast.mult);
+        if (base < nsec) {
+                base = nsec;
+        }
+        __atomic_store_n(&g_clock_fast.seq, g_clock_fast.seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&g_clock_fast.tsc_base, tsc, __ATOMIC_RELAXED);
+        __atomic_store_n(&g_clock_fast.nsec_base, base, __ATOMIC_RELAXED);
+        __atomic_store_n(&g_clock_fast.mult, mult, __ATOMIC_RELAXED);
+        __atomic_store_n(&g_clock_fast.tsc_next, tsc + (unsigned long long) (((unsigned __int128) MEDUSA_CLOCK_FAST_RECALIBRATE << MEDUSA_CLOCK_FAST_SHIFT) / mult), __ATOMIC_RELAXED);
+        __atomic_store_n(&g_clock_fast.seq, g_clock_fast.seq + 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&g_clock_fast.busy, 0, __ATOMIC_RELEASE);
+}
+
+static void clock_fast_init (void)
+{
+        unsigned int eax;
+        unsigned int ebx;
+        unsigned int ecx;
+        unsigned int edx;
+        unsigned long long tsc;
+        unsigned long long nsec;
+        if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0 ||
+            (edx & (1 << 8)) == 0) {
+                goto out;
+        }
+        g_clock_fast.nsec_anchor = clock_fast_nsec();
+        g_clock_fast.tsc_anchor  = __rdtsc();
+        do {
+                nsec = clock_fast_nsec();
+                tsc  = __rdtsc();
+        } while (nsec - g_clock_fast.nsec_anchor < MEDUSA_CLOCK_FAST_CALIBRATE);
+        if (tsc <= g_clock_fast.tsc_anchor) {
+                goto out;
+        }
+        g_clock_fast.mult      = (unsigned long long) (((unsigned __int128) (nsec - g_clock_fast.nsec_anchor) << MEDUSA_CLOCK_FAST_SHIFT) / (tsc - g_clock_fast.tsc_anchor));
+        g_clock_fast.tsc_base  = tsc;
+        g_clock_fast.nsec_base = nsec;
+        g_clock_fast.tsc_next  = tsc + (unsigned long long) (((unsigned __int128) MEDUSA_CLOCK_FAST_RECALIBRATE << MEDUSA_CLOCK_FAST_SHIFT) / g_clock_fast.mult);
+        g_clock_fast.tsc       = (g_clock_fast.mult != 0);
+out:    __atomic_store_n(&g_clock_fast.init, 1, __ATOMIC_RELEASE);
+}
+
+#endif
+
+__attribute__ ((visibility ("default"))) int medusa_clock_fast (struct timespec *timespec)
+{
+#if defined(__x86_64__)
+        unsigned int seq;
+        unsigned long long tsc;
+        unsigned long long mult;
+        unsigned long long nsec;
+        unsigned long long tsc_base;
+        unsigned long long nsec_base;
+        unsigned long long tsc_next;
+#endif
+        if (MEDUSA_IS_ERR_OR_NULL(timespec)) {
+                return -EINVAL;
+        }
+#if defined(__x86_64__)
+        if (__atomic_load_n(&g_clock_fast.init, __ATOMIC_ACQUIRE) == 0) {
+                pthread_once(&g_clock_fast_once, clock_fast_init);
+        }
+        if (g_clock_fast.tsc) {
+                do {
+                        seq = __atomic_load_n(&g_clock_fast.seq, __ATOMIC_ACQUIRE);
+                        tsc_base  = __atomic_load_n(&g_clock_fast.tsc_base, __ATOMIC_RELAXED);
+                        nsec_base = __atomic_load_n(&g_clock_fast.nsec_base, __ATOMIC_RELAXED);
+                        mult      = __atomic_load_n(&g_clock_fast.mult, __ATOMIC_RELAXED);
+                        tsc_next  = __atomic_load_n(&g_clock_fast.tsc_next, __ATOMIC_RELAXED);
+                        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                } while ((seq & 1) || seq != __atomic_load_n(&g_clock_fast.seq, __ATOMIC_RELAXED));
+                tsc = __rdtsc();
+                if (tsc >= tsc_next) {
+                        clock_fast_recalibrate();
+                }
+                nsec = clock_fast_convert((tsc > tsc_base) ? tsc : tsc_base, tsc_base, nsec_base, mult);
+                timespec->tv_sec  = nsec / 1000000000ULL;
+                timespec->tv_nsec = nsec % 1000000000ULL;
+                return 0;
+        }
+#endif
+        return medusa_clock_monotonic(timespec);
+}
@@ -69,6 +69,9 @@ extern "C"
 
 int medusa_clock_monotonic (struct timespec *timespec);
 int medusa_clock_monotonic_raw (struct timespec *timespec);
+int medusa_clock_monotonic_coarse (struct timespec *timespec);
+int medusa_clock_monotonic_coarse_resolution (struct timespec *timespec);
+int medusa_clock_fast (struct timespec *timespec);
 
 #ifdef __cplusplus
 }
@@ -668,14 +668,17 @@ __attribute__ ((visibility ("default"))) int medusa_exec_onevent_unlocked (struc
 {
         int rc;
         struct medusa_monitor *monitor;
+        struct medusa_monitor_dispatch dispatch;
         rc = 0;
         monitor = exec->subject.monitor;
         if (exec->onevent != NULL) {
                 if ((medusa_subject_is_active(&exec->subject)) ||
                     (events & MEDUSA_EXEC_EVENT_DESTROY)) {
+                        medusa_monitor_dispatch_begin_unlocked(monitor, &dispatch, &exec->subject, (void (*) (void)) exec->onevent);
                         medusa_monitor_unlock(monitor);
                         rc = exec->onevent(exec, events, exec->context);
                         medusa_monitor_lock(monitor);
+                        medusa_monitor_dispatch_end_unlocked(monitor, &dispatch);
                 }
         }
         if (events & MEDUSA_EXEC_EVENT_DESTROY) {
@@ -1284,14 +1284,17 @@ __attribute__ ((visibility ("default"))) int medusa_httprequest_onevent_unlocked
 {
         int ret;
         struct medusa_monitor *monitor;
+        struct medusa_monitor_dispatch dispatch;
         ret = 0;
         monitor = httprequest->subject.monitor;
         if (httprequest->onevent != NULL) {
                 if ((medusa_subject_is_active(&httprequest->subject)) ||
                     (events & MEDUSA_HTTPREQUEST_EVENT_DESTROY)) {
+                        medusa_monitor_dispatch_begin_unlocked(monitor, &dispatch, &httprequest->subject, (void (*) (void)) httprequest->onevent);
                         medusa_monitor_unlock(monitor);
                         ret = httprequest->onevent(httprequest, events, httprequest->context);
                         medusa_monitor_lock(monitor);
+                        medusa_monitor_dispatch_end_unlocked(monitor, &dispatch);
                 }
         }
         if (events & MEDUSA_HTTPREQUEST_EVENT_DESTROY) {
@@ -23,11 +23,18 @@ unsigned int medusa_io_get_events_unlocked (const struct medusa_io *io);
 int medusa_io_set_enabled_unlocked (struct medusa_io *io, int enabled);
 int medusa_io_get_enabled_unlocked (const struct medusa_io *io);
 
+int medusa_io_set_edgetriggered_unlocked (struct medusa_io *io, int enabled);
+int medusa_io_get_edgetriggered_unlocked (const struct medusa_io *io);
+
 struct medusa_monitor * medusa_io_get_monitor_unlocked (const struct medusa_io *io);
 
 int medusa_io_onevent_unlocked (struct medusa_io *io, unsigned int events);
 int medusa_io_onevent (struct medusa_io *io, unsigned int events);
 
+int medusa_io_get_polled_unlocked (const struct medusa_io *io);
+int medusa_io_set_polled_unlocked (struct medusa_io *io, int polled);
+int medusa_io_rearm_unlocked (struct medusa_io *io);
+
 int medusa_io_is_valid_unlocked (const struct medusa_io *io);
 
 #endif
@@ -22,6 +22,13 @@
 #define MEDUSA_IO_EVENT_MASK            0xff
 #define MEDUSA_IO_EVENT_SHIFT           0x00
 
+#define MEDUSA_IO_EDGE_MASK             0xff
+#define MEDUSA_IO_EDGE_SHIFT            0x08
+
+#define MEDUSA_IO_POLL_MASK             0xff
+#define MEDUSA_IO_POLL_SHIFT            0x10
+#define MEDUSA_IO_POLL_EDGE             0x80
+
 #define MEDUSA_IO_ENABLE_MASK           0xff
 #define MEDUSA_IO_ENABLE_SHIFT          0x18
 
@@ -62,6 +69,38 @@ static inline void io_set_enabled (struct medusa_io *io, unsigned int enabled)
                     ((enabled & MEDUSA_IO_ENABLE_MASK) << MEDUSA_IO_ENABLE_SHIFT);
 }
 
+static inline unsigned int io_get_edgetriggered (const struct medusa_io *io)
+{
+        return (io->flags >> MEDUSA_IO_EDGE_SHIFT) & MEDUSA_IO_EDGE_MASK;
+}
+
+static inline void io_set_edgetriggered (struct medusa_io *io, unsigned int enabled)
+{
+        io->flags = (io->flags & ~(MEDUSA_IO_EDGE_MASK << MEDUSA_IO_EDGE_SHIFT)) |
+                    ((enabled & MEDUSA_IO_EDGE_MASK) << MEDUSA_IO_EDGE_SHIFT);
+}
+
+static inline unsigned int io_get_pollmask (const struct medusa_io *io)
+{
+        unsigned int mask;
+        mask = io_get_events(io) & (MEDUSA_IO_EVENT_IN | MEDUSA_IO_EVENT_OUT | MEDUSA_IO_EVENT_PRI);
+        if (io_get_edgetriggered(io)) {
+                mask |= MEDUSA_IO_POLL_EDGE;
+        }
+        return mask;
+}
+
+static inline unsigned int io_get_polled (const struct medusa_io *io)
+{
+        return (io->flags >> MEDUSA_IO_POLL_SHIFT) & MEDUSA_IO_POLL_MASK;
+}
+
+static inline void io_set_polled (struct medusa_io *io, unsigned int mask)
+{
+        io->flags = (io->flags & ~(MEDUSA_IO_POLL_MASK << MEDUSA_IO_POLL_SHIFT)) |
+                    ((mask & MEDUSA_IO_POLL_MASK) << MEDUSA_IO_POLL_SHIFT);
+}
+
 __attribute__ ((visibility ("default"))) int medusa_io_init_options_default (struct medusa_io_init_options *options)
 {
         if (MEDUSA_IS_ERR_OR_NULL(options)) {
@@ -123,6 +162,7 @@ __attribute__ ((visibility ("default"))) int medusa_io_init_with_options_unlocke
         io->onevent = options->onevent;
         io->context = options->context;
         io_set_events(io, options->events);
+        io_set_edgetriggered(io, !!options->edgetriggered);
         io_set_enabled(io, !!options->enabled);
         medusa_subject_set_type(&io->subject, MEDUSA_SUBJECT_TYPE_IO);
         io->subject.monitor = NULL;
@@ -411,6 +451,50 @@ __attribute__ ((visibility ("default"))) int medusa_io_get_enabled (const struct
         return rc;
 }
 
+__attribute__ ((visibility ("default"))) int medusa_io_set_edgetriggered_unlocked (struct medusa_io *io, int enabled)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(io)) {
+                return -EINVAL;
+        }
+        if (io_get_edgetriggered(io) == (unsigned int) !!enabled) {
+                return 0;
+        }
+        io_set_edgetriggered(io, !!enabled);
+        return medusa_monitor_mod_unlocked(&io->subject);
+}
+
+__attribute__ ((visibility ("default"))) int medusa_io_set_edgetriggered (struct medusa_io *io, int enabled)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(io)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(io->subject.monitor);
+        rc = medusa_io_set_edgetriggered_unlocked(io, enabled);
+        medusa_monitor_unlock(io->subject.monitor);
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_io_get_edgetriggered_unlocked (const struct medusa_io *io)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(io)) {
+                return -EINVAL;
+        }
+        return io_get_edgetriggered(io);
+}
+
+__attribute__ ((visibility ("default"))) int medusa_io_get_edgetriggered (const struct medusa_io *io)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(io)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(io->subject.monitor);
+        rc = medusa_io_get_edgetriggered_unlocked(io);
+        medusa_monitor_unlock(io->subject.monitor);
+        return rc;
+}
+
 __attribute__ ((visibility ("default"))) int medusa_io_enable (struct medusa_io *io)
 {
         return medusa_io_set_enabled(io, 1);
@@ -444,25 +528,30 @@ __attribute__ ((visibility ("default"))) struct medusa_monitor * medusa_io_get_m
 __attribute__ ((visibility ("default"))) int medusa_io_onevent_unlocked (struct medusa_io *io, unsigned int events)
 {
         int rc;
+        unsigned int flags;
         struct medusa_monitor *monitor;
+        struct medusa_monitor_dispatch dispatch;
         rc = 0;
+        flags = io->subject.flags;
         monitor = io->subject.monitor;
         if (io->onevent != NULL) {
                 if ((medusa_subject_is_active(&io->subject)) ||
                     (events & MEDUSA_IO_EVENT_DESTROY)) {
+                        medusa_monitor_dispatch_begin_unlocked(monitor, &dispatch, &io->subject, (void (*) (void)) io->onevent);
                         medusa_monitor_unlock(monitor);
                         rc = io->onevent(io, events, io->context);
                         medusa_monitor_lock(monitor);
+                        medusa_monitor_dispatch_end_unlocked(monitor, &dispatch);
                 }
         }
         if (events & MEDUSA_IO_EVENT_DESTROY) {
-                if (io->subject.flags & MEDUSA_SUBJECT_FLAG_ALLOC) {
+                if (flags & MEDUSA_SUBJECT_FLAG_ALLOC) {
 #if defined(MEDUSA_IO_USE_POOL) && (MEDUSA_IO_USE_POOL == 1)
                         medusa_pool_free(io);
 #else
                         free(io);
 #endif
-                } else {
+                } else if (!(flags & MEDUSA_SUBJECT_FLAG_EMBEDDED)) {
                         memset(io, 0, sizeof(struct medusa_io));
                 }
         }
@@ -481,6 +570,35 @@ __attribute__ ((visibility ("default"))) int medusa_io_onevent (struct medusa_io
         return rc;
 }
 
+__attribute__ ((visibility ("default"))) int medusa_io_get_polled_unlocked (const struct medusa_io *io)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(io)) {
+                return -EINVAL;
+        }
+        if (io_get_polled(io) == 0) {
+                return 0;
+        }
+        return io_get_polled(io) == io_get_pollmask(io);
+}
+
+__attribute__ ((visibility ("default"))) int medusa_io_set_polled_unlocked (struct medusa_io *io, int polled)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(io)) {
+                return -EINVAL;
+        }
+        io_set_polled(io, (polled) ? io_get_pollmask(io) : 0);
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_io_rearm_unlocked (struct medusa_io *io)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(io)) {
+                return -EINVAL;
+        }
+        io_set_polled(io, 0);
+        return medusa_monitor_mod_unlocked(&io->subject);
+}
+
 __attribute__ ((visibility ("default"))) int medusa_io_is_valid_unlocked (const struct medusa_io *io)
 {
         if (io->fd < 0) {
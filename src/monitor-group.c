@@ -0,0 +1,344 @@
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <errno.h>
+
+#include "error.h"
+#include "tcpsocket.h"
+#include "monitor.h"
+#include "monitor-group.h"
+
+struct member {
+        struct medusa_monitor_group *group;
+        unsigned int index;
+        unsigned int cpu;
+        struct medusa_monitor *monitor;
+        pthread_t thread;
+        int started;
+        int running;
+        int rc;
+        unsigned int listeners;
+        unsigned long long iterations;
+        unsigned long long connections;
+};
+
+struct listener {
+        struct member *member;
+        int (*onevent) (struct medusa_tcpsocket *tcpsocket, unsigned int events, void *context, ...);
+        void *context;
+};
+
+struct medusa_monitor_group {
+        unsigned int flags;
+        unsigned int count;
+        struct member *members;
+        pthread_mutex_t mutex;
+};
+
+static void * group_member_thread (void *arg)
+{
+        int rc;
+        struct member *member = (struct member *) arg;
+        while (1) {
+                rc = medusa_monitor_run_once(member->monitor);
+                __atomic_add_fetch(&member->iterations, 1, __ATOMIC_RELAXED);
+                if (rc <= 0) {
+                        break;
+                }
+        }
+        member->rc = rc;
+        __atomic_store_n(&member->running, 0, __ATOMIC_RELEASE);
+        return NULL;
+}
+
+static int group_listener_onevent (struct medusa_tcpsocket *tcpsocket, unsigned int events, void *context, ...)
+{
+        int rc;
+        struct listener *listener = (struct listener *) context;
+        if (events & MEDUSA_TCPSOCKET_EVENT_CONNECTION) {
+                __atomic_add_fetch(&listener->member->connections, 1, __ATOMIC_RELAXED);
+        }
+        rc = 0;
+        if (listener->onevent != NULL) {
+                rc = listener->onevent(tcpsocket, events, listener->context);
+        }
+        if (events & MEDUSA_TCPSOCKET_EVENT_DESTROY) {
+                __atomic_sub_fetch(&listener->member->listeners, 1, __ATOMIC_RELAXED);
+                free(listener);
+        }
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_monitor_group_init_options_default (struct medusa_monitor_group_init_options *options)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(options)) {
+                return -EINVAL;
+        }
+        memset(options, 0, sizeof(struct medusa_monitor_group_init_options));
+        options->flags = MEDUSA_MONITOR_GROUP_FLAG_DEFAULT;
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) struct medusa_monitor_group * medusa_monitor_group_create (unsigned int count)
+{
+        int rc;
+        struct medusa_monitor_group_init_options options;
+        rc = medusa_monitor_group_init_options_default(&options);
+        if (rc < 0) {
+                return MEDUSA_ERR_PTR(rc);
+        }
+        options.count = count;
+        return medusa_monitor_group_create_with_options(&options);
+}
+
+__attribute__ ((visibility ("default"))) struct medusa_monitor_group * medusa_monitor_group_create_with_options (const struct medusa_monitor_group_init_options *options)
+{
+        long ncpus;
+        unsigned int i;
+        struct medusa_monitor_group *group;
+        if (MEDUSA_IS_ERR_OR_NULL(options)) {
+                return MEDUSA_ERR_PTR(-EINVAL);
+        }
+        ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+        if (ncpus <= 0) {
+                ncpus = 1;
+        }
+        group = (struct medusa_monitor_group *) malloc(sizeof(struct medusa_monitor_group));
+        if (group == NULL) {
+                return MEDUSA_ERR_PTR(-ENOMEM);
+        }
+        memset(group, 0, sizeof(struct medusa_monitor_group));
+        pthread_mutex_init(&group->mutex, NULL);
+        group->flags = options->flags;
+        group->count = options->count;
+        if (group->count == 0) {
+                group->count = ncpus;
+        }
+        group->members = (struct member *) malloc(sizeof(struct member) * group->count);
+        if (group->members == NULL) {
+                medusa_monitor_group_destroy(group);
+                return MEDUSA_ERR_PTR(-ENOMEM);
+        }
+        memset(group->members, 0, sizeof(struct member) * group->count);
+        for (i = 0; i < group->count; i++) {
+                group->members[i].group = group;
+                group->members[i].index = i;
+                group->members[i].cpu   = (options->cpu + i) % ncpus;
+                group->members[i].monitor = medusa_monitor_create(options->monitor);
+                if (group->members[i].monitor == NULL) {
+                        medusa_monitor_group_destroy(group);
+                        return MEDUSA_ERR_PTR(-EIO);
+                }
+        }
+        return group;
+}
+
+__attribute__ ((visibility ("default"))) void medusa_monitor_group_destroy (struct medusa_monitor_group *group)
+{
+        unsigned int i;
+        if (MEDUSA_IS_ERR_OR_NULL(group)) {
+                return;
+        }
+        if (group->members != NULL) {
+                medusa_monitor_group_break(group);
+                medusa_monitor_group_wait(group);
+                for (i = 0; i < group->count; i++) {
+                        if (group->members[i].monitor != NULL) {
+                                medusa_monitor_destroy(group->members[i].monitor);
+                        }
+                }
+                free(group->members);
+        }
+        pthread_mutex_destroy(&group->mutex);
+        free(group);
+}
+
+__attribute__ ((visibility ("default"))) unsigned int medusa_monitor_group_get_count (const struct medusa_monitor_group *group)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(group)) {
+                return 0;
+        }
+        return group->count;
+}
+
+__attribute__ ((visibility ("default"))) struct medusa_monitor * medusa_monitor_group_get_monitor (const struct medusa_monitor_group *group, unsigned int index)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(group)) {
+                return MEDUSA_ERR_PTR(-EINVAL);
+        }
+        if (index >= group->count) {
+                return MEDUSA_ERR_PTR(-EINVAL);
+        }
+        return group->members[index].monitor;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_monitor_group_bind (struct medusa_monitor_group *group, const struct medusa_tcpsocket_init_options *options, unsigned int protocol, const char *address, unsigned short port)
+{
+        int rc;
+        unsigned int i;
+        struct listener *listener;
+        struct medusa_tcpsocket **tcpsockets;
+        struct medusa_tcpsocket_init_options tcpsocket_init_options;
+        if (MEDUSA_IS_ERR_OR_NULL(group)) {
+                return -EINVAL;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(options)) {
+                return -EINVAL;
+        }
+        tcpsockets = (struct medusa_tcpsocket **) malloc(sizeof(struct medusa_tcpsocket *) * group->count);
+        if (tcpsockets == NULL) {
+                return -ENOMEM;
+        }
+        memset(tcpsockets, 0, sizeof(struct medusa_tcpsocket *) * group->count);
+        for (i = 0; i < group->count; i++) {
+                listener = (struct listener *) malloc(sizeof(struct listener));
+                if (listener == NULL) {
+                        rc = -ENOMEM;
+                        goto bail;
+                }
+                listener->member  = &group->members[i];
+                listener->onevent = options->onevent;
+                listener->context = options->context;
+                memcpy(&tcpsocket_init_options, options, sizeof(struct medusa_tcpsocket_init_options));
+                tcpsocket_init_options.monitor   = group->members[i].monitor;
+                tcpsocket_init_options.onevent   = group_listener_onevent;
+                tcpsocket_init_options.context   = listener;
+                tcpsocket_init_options.reuseport = 1;
+                tcpsockets[i] = medusa_tcpsocket_create_with_options(&tcpsocket_init_options);
+                if (MEDUSA_IS_ERR_OR_NULL(tcpsockets[i])) {
+                        rc = MEDUSA_PTR_ERR(tcpsockets[i]);
+                        tcpsockets[i] = NULL;
+                        free(listener);
+                        goto bail;
+                }
+                __atomic_add_fetch(&group->members[i].listeners, 1, __ATOMIC_RELAXED);
+                rc = medusa_tcpsocket_bind(tcpsockets[i], protocol, address, port);
+                if (rc < 0) {
+                        goto bail;
+                }
+        }
+        free(tcpsockets);
+        return 0;
+bail:   for (i = 0; i < group->count; i++) {
+                if (tcpsockets[i] != NULL) {
+                        medusa_tcpsocket_destroy(tcpsockets[i]);
+                }
+        }
+        free(tcpsockets);
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_monitor_group_start (struct medusa_monitor_group *group)
+{
+        int rc;
+        unsigned int i;
+        cpu_set_t cpuset;
+        pthread_attr_t attr;
+        if (MEDUSA_IS_ERR_OR_NULL(group)) {
+                return -EINVAL;
+        }
+        pthread_mutex_lock(&group->mutex);
+        for (i = 0; i < group->count; i++) {
+                if (group->members[i].started) {
+                        continue;
+                }
+                pthread_attr_init(&attr);
+                if (group->flags & MEDUSA_MONITOR_GROUP_FLAG_AFFINITY) {
+                        CPU_ZERO(&cpuset);
+                        CPU_SET(group->members[i].cpu, &cpuset);
+                        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+                }
+                __atomic_store_n(&group->members[i].running, 1, __ATOMIC_RELEASE);
+                rc = pthread_create(&group->members[i].thread, &attr, group_member_thread, &group->members[i]);
+                pthread_attr_destroy(&attr);
+                if (rc != 0) {
+                        __atomic_store_n(&group->members[i].running, 0, __ATOMIC_RELEASE);
+                        pthread_mutex_unlock(&group->mutex);
+                        return -rc;
+                }
+                group->members[i].started = 1;
+        }
+        pthread_mutex_unlock(&group->mutex);
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_monitor_group_wait (struct medusa_monitor_group *group)
+{
+        int rc;
+        unsigned int i;
+        if (MEDUSA_IS_ERR_OR_NULL(group)) {
+                return -EINVAL;
+        }
+        rc = 0;
+        pthread_mutex_lock(&group->mutex);
+        for (i = 0; i < group->count; i++) {
+                if (group->members[i].started == 0) {
+                        continue;
+                }
+                pthread_join(group->members[i].thread, NULL);
+                group->members[i].started = 0;
+                if (group->members[i].rc < 0 && rc == 0) {
+                        rc = group->members[i].rc;
+                }
+        }
+        pthread_mutex_unlock(&group->mutex);
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_monitor_group_break (struct medusa_monitor_group *group)
+{
+        int rc;
+        unsigned int i;
+        if (MEDUSA_IS_ERR_OR_NULL(group)) {
+                return -EINVAL;
+        }
+        for (i = 0; i < group->count; i++) {
+                rc = medusa_monitor_break(group->members[i].monitor);
+                if (rc < 0) {
+                        return rc;
+                }
+        }
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_monitor_group_continue (struct medusa_monitor_group *group)
+{
+        int rc;
+        unsigned int i;
+        if (MEDUSA_IS_ERR_OR_NULL(group)) {
+                return -EINVAL;
+        }
+        for (i = 0; i < group->count; i++) {
+                rc = medusa_monitor_continue(group->members[i].monitor);
+                if (rc < 0) {
+                        return rc;
+                }
+        }
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_monitor_group_get_stats (const struct medusa_monitor_group *group, struct medusa_monitor_group_stats *stats)
+{
+        unsigned int i;
+        if (MEDUSA_IS_ERR_OR_NULL(group)) {
+                return -EINVAL;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(stats)) {
+                return -EINVAL;
+        }
+        memset(stats, 0, sizeof(struct medusa_monitor_group_stats));
+        stats->monitors = group->count;
+        for (i = 0; i < group->count; i++) {
+                stats->running     += __atomic_load_n(&group->members[i].running, __ATOMIC_ACQUIRE);
+                stats->listeners   += __atomic_load_n(&group->members[i].listeners, __ATOMIC_RELAXED);
+                stats->iterations  += __atomic_load_n(&group->members[i].iterations, __ATOMIC_RELAXED);
+                stats->connections += __atomic_load_n(&group->members[i].connections, __ATOMIC_RELAXED);
+        }
+        return 0;
+}
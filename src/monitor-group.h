@@ -0,0 +1,62 @@
+
+#if !defined(MEDUSA_MONITOR_GROUP_H)
+#define MEDUSA_MONITOR_GROUP_H
+
+struct medusa_monitor;
+struct medusa_monitor_init_options;
+struct medusa_monitor_group;
+struct medusa_tcpsocket_init_options;
+
+enum {
+        MEDUSA_MONITOR_GROUP_FLAG_NONE          = 0x00000000,
+        MEDUSA_MONITOR_GROUP_FLAG_AFFINITY      = 0x00000001,
+        MEDUSA_MONITOR_GROUP_FLAG_DEFAULT       = MEDUSA_MONITOR_GROUP_FLAG_AFFINITY
+#define MEDUSA_MONITOR_GROUP_FLAG_NONE          MEDUSA_MONITOR_GROUP_FLAG_NONE
+#define MEDUSA_MONITOR_GROUP_FLAG_AFFINITY      MEDUSA_MONITOR_GROUP_FLAG_AFFINITY
+#define MEDUSA_MONITOR_GROUP_FLAG_DEFAULT       MEDUSA_MONITOR_GROUP_FLAG_DEFAULT
+};
+
+struct medusa_monitor_group_init_options {
+        unsigned int flags;
+        unsigned int count;
+        unsigned int cpu;
+        const struct medusa_monitor_init_options *monitor;
+};
+
+struct medusa_monitor_group_stats {
+        unsigned int monitors;
+        unsigned int running;
+        unsigned int listeners;
+        unsigned long long iterations;
+        unsigned long long connections;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int medusa_monitor_group_init_options_default (struct medusa_monitor_group_init_options *options);
+
+struct medusa_monitor_group * medusa_monitor_group_create (unsigned int count);
+struct medusa_monitor_group * medusa_monitor_group_create_with_options (const struct medusa_monitor_group_init_options *options);
+void medusa_monitor_group_destroy (struct medusa_monitor_group *group);
+
+unsigned int medusa_monitor_group_get_count (const struct medusa_monitor_group *group);
+struct medusa_monitor * medusa_monitor_group_get_monitor (const struct medusa_monitor_group *group, unsigned int index);
+
+int medusa_monitor_group_bind (struct medusa_monitor_group *group, const struct medusa_tcpsocket_init_options *options, unsigned int protocol, const char *address, unsigned short port);
+
+int medusa_monitor_group_start (struct medusa_monitor_group *group);
+int medusa_monitor_group_wait (struct medusa_monitor_group *group);
+
+int medusa_monitor_group_break (struct medusa_monitor_group *group);
+int medusa_monitor_group_continue (struct medusa_monitor_group *group);
+
+int medusa_monitor_group_get_stats (const struct medusa_monitor_group *group, struct medusa_monitor_group_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,9 +2,18 @@
 #if !defined(MEDUSA_MONITOR_PRIVATE_H)
 #define MEDUSA_MONITOR_PRIVATE_H
 
+#include <time.h>
+
 struct medusa_subject;
 struct medusa_monitor;
 
+struct medusa_monitor_dispatch {
+        const struct medusa_subject *subject;
+        unsigned int type;
+        void (*onevent) (void);
+        struct timespec timespec;
+};
+
 int medusa_monitor_lock (struct medusa_monitor *monitor);
 int medusa_monitor_unlock (struct medusa_monitor *monitor);
 
@@ -16,4 +25,11 @@ int medusa_monitor_add_unlocked (struct medusa_monitor *monitor, struct medusa_s
 int medusa_monitor_mod_unlocked (struct medusa_subject *subject);
 int medusa_monitor_del_unlocked (struct medusa_subject *subject);
 
+void medusa_monitor_dispatch_begin_unlocked (struct medusa_monitor *monitor, struct medusa_monitor_dispatch *dispatch, struct medusa_subject *subject, void (*onevent) (void));
+void medusa_monitor_dispatch_end_unlocked (struct medusa_monitor *monitor, struct medusa_monitor_dispatch *dispatch);
+
+int medusa_monitor_now_unlocked (const struct medusa_monitor *monitor, struct timespec *now);
+
+unsigned int medusa_monitor_get_busypoll_socket_unlocked (const struct medusa_monitor *monitor);
+
 #endif
@@ -1,6 +1,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdint.h>
 #include <unistd.h>
@@ -8,8 +9,13 @@
 #include <pthread.h>
 #include <errno.h>
 
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
 #include "queue.h"
 #include "pqueue.h"
+#include "wheel.h"
 
 #include "error.h"
 #include "clock.h"
@@ -37,6 +43,7 @@
 #include "poll-kqueue.h"
 #include "poll-poll.h"
 #include "poll-select.h"
+#include "poll-io_uring.h"
 #include "poll-backend.h"
 
 #include "signal-sigaction.h"
@@ -45,6 +52,9 @@
 #include "timer-timerfd.h"
 #include "timer-backend.h"
 
+#define MONITOR_TIMER_BATCH     64
+#define MONITOR_CLOCK_STALE     10000ULL
+
 enum {
         WAKEUP_REASON_NONE,
         WAKEUP_REASON_LOOP_BREAK,
@@ -63,23 +73,53 @@ struct medusa_monitor {
         struct medusa_subjects rogues;
         struct {
                 struct medusa_poll_backend *backend;
+                unsigned long long elided;
         } poll;
         struct {
                 struct medusa_timer_backend *backend;
-                struct pqueue_head *pqueue;
+                struct pqueue4_head *pqueue;
+                struct wheel_head *wheel;
                 int fired;
                 int dirty;
+                int armed;
+                int precise;
+                struct timespec deadline;
                 struct medusa_io io;
         } timer;
         struct {
                 struct medusa_signal_backend *backend;
                 struct medusa_io io;
         } signal;
+        struct {
+                struct timespec timeout;
+                unsigned int iterations;
+                unsigned int socket;
+        } busypoll;
         struct {
                 int fds[2];
                 int fired;
+                int polling;
+                pthread_t thread;
                 struct medusa_io io;
         } wakeup;
+        struct {
+                struct timespec now;
+                struct timespec resolution;
+                unsigned long long updated;
+        } clock;
+        struct {
+                unsigned int depth;
+                struct medusa_monitor_stats counters;
+        } stats;
+        struct {
+                unsigned long long lag;
+                unsigned long long callback;
+                unsigned long long resumed;
+                unsigned int size;
+                unsigned int head;
+                unsigned int count;
+                struct medusa_monitor_stall *stalls;
+        } watchdog;
         pthread_mutex_t mutex;
 };
 
@@ -97,6 +137,16 @@ static const struct medusa_monitor_init_options g_init_options = {
                 .type   = MEDUSA_MONITOR_SIGNAL_DEFAULT,
                 .u      = { }
         },
+        .busypoll = {
+                .timeout    = 0,
+                .iterations = 0,
+                .socket     = 0
+        },
+        .watchdog = {
+                .lag        = 0,
+                .callback   = 0,
+                .size       = 0
+        },
 };
 
 static int fd_set_blocking (int fd, int on)
@@ -121,11 +171,11 @@ static int fd_set_blocking (int fd, int on)
 static int monitor_wakeup_io_onevent (struct medusa_io *io, unsigned int events, void *context, ...)
 {
         int rc;
-        unsigned int reason;
+        uint64_t values[8];
         struct medusa_monitor *monitor = (struct medusa_monitor *) context;
         if (events & MEDUSA_IO_EVENT_IN) {
                 while (1) {
-                        rc = read(io->fd, &reason, sizeof(reason));
+                        rc = read(io->fd, values, sizeof(values));
                         if (rc == 0) {
                                 break;
                         } else if (rc < 0) {
@@ -135,8 +185,8 @@ static int monitor_wakeup_io_onevent (struct medusa_io *io, unsigned int events,
                                         break;
                                 }
                                 goto bail;
-                        } else if (rc != sizeof(reason)) {
-                                goto bail;
+                        } else if (rc != sizeof(values)) {
+                                break;
                         }
                 }
                 medusa_monitor_lock(monitor);
@@ -193,27 +243,122 @@ static int monitor_signal_io_onevent (struct medusa_io *io, unsigned int events,
 static int monitor_signal (struct medusa_monitor *monitor, unsigned int reason)
 {
         int rc;
-        if (monitor->wakeup.fired == 0) {
-                rc = write(monitor->wakeup.fds[1], &reason, sizeof(reason));
-                if (rc != sizeof(reason)) {
-                        goto bail;
-                }
-                monitor->wakeup.fired = 1;
-        }
+        uint64_t value;
         if (reason == WAKEUP_REASON_LOOP_BREAK) {
                 monitor->running = 0;
         } else if (reason == WAKEUP_REASON_LOOP_CONTINUE) {
                 monitor->running = 1;
+        } else if (__atomic_load_n(&monitor->wakeup.polling, __ATOMIC_ACQUIRE) == 0) {
+                if (monitor->flags & MEDUSA_MONITOR_FLAG_THREAD_SAFE) {
+                        return 0;
+                }
+        } else if (pthread_equal(monitor->wakeup.thread, pthread_self())) {
+                return 0;
+        }
+        if (monitor->wakeup.fired == 0) {
+                value = 1;
+                rc = write(monitor->wakeup.fds[1], &value, sizeof(value));
+                if (rc != sizeof(value)) {
+                        if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                                return 0;
+                        }
+                        goto bail;
+                }
+                monitor->wakeup.fired = 1;
+                monitor->stats.counters.syscalls.wakeup += 1;
         }
         return 0;
 bail:   return -1;
 }
 
-static int monitor_timer_subject_compare (void *a, void *b)
+static inline unsigned long long monitor_timespec_nsec (const struct timespec *timespec)
+{
+        return timespec->tv_sec * 1000000000ULL + timespec->tv_nsec;
+}
+
+static inline unsigned long long monitor_timespec_ticks (const struct timespec *timespec, int ceil)
 {
-        struct medusa_timer *ta = a;
-        struct medusa_timer *tb = b;
-        return medusa_timespec_compare(&ta->_timespec, &tb->_timespec, >);
+        return timespec->tv_sec * 1000ULL + (timespec->tv_nsec + ((ceil) ? 999999 : 0)) / 1000000;
+}
+
+static inline void monitor_ticks_timespec (unsigned long long ticks, struct timespec *timespec)
+{
+        timespec->tv_sec  = ticks / 1000;
+        timespec->tv_nsec = (ticks % 1000) * 1000000;
+}
+
+static int monitor_clock_update (struct medusa_monitor *monitor)
+{
+        int rc;
+        struct timespec now;
+        if (monitor->flags & MEDUSA_MONITOR_FLAG_CLOCK_COARSE) {
+                rc = medusa_clock_monotonic_coarse(&now);
+        } else {
+                rc = medusa_clock_monotonic(&now);
+        }
+        if (rc < 0) {
+                return rc;
+        }
+        if (medusa_timespec_compare(&now, &monitor->clock.now, >)) {
+                monitor->clock.now = now;
+        }
+        return 0;
+}
+
+static int monitor_clock_refresh (struct medusa_monitor *monitor)
+{
+        int rc;
+        struct timespec fast;
+        /*
+         * the loop clock is read once per wakeup, time spent outside of
+         * the loop (callbacks, or the caller between runs) makes it stale,
+         * re-read it before timers are armed against it.
+         */
+        medusa_clock_fast(&fast);
+        if (monitor->clock.updated != 0 &&
+            monitor_timespec_nsec(&fast) - monitor->clock.updated < MONITOR_CLOCK_STALE) {
+                return 0;
+        }
+        rc = monitor_clock_update(monitor);
+        if (rc < 0) {
+                return rc;
+        }
+        monitor->clock.updated = monitor_timespec_nsec(&fast);
+        return 0;
+}
+
+static const char * monitor_subject_type_name (unsigned int type)
+{
+        switch (type) {
+                case MEDUSA_SUBJECT_TYPE_IO:            return "io";
+                case MEDUSA_SUBJECT_TYPE_TIMER:         return "timer";
+                case MEDUSA_SUBJECT_TYPE_SIGNAL:        return "signal";
+                case MEDUSA_SUBJECT_TYPE_TCPSOCKET:     return "tcpsocket";
+                case MEDUSA_SUBJECT_TYPE_HTTPREQUEST:   return "httprequest";
+                case MEDUSA_SUBJECT_TYPE_EXEC:          return "exec";
+        }
+        return "unknown";
+}
+
+static void monitor_watchdog_record (struct medusa_monitor *monitor, unsigned int type, const struct medusa_monitor_dispatch *dispatch, unsigned long long duration)
+{
+        struct medusa_monitor_stall *stall;
+        if (monitor->watchdog.stalls == NULL) {
+                return;
+        }
+        if (monitor->watchdog.count == monitor->watchdog.size) {
+                monitor->watchdog.head = (monitor->watchdog.head + 1) % monitor->watchdog.size;
+                monitor->watchdog.count -= 1;
+                monitor->stats.counters.watchdog.dropped += 1;
+        }
+        stall = &monitor->watchdog.stalls[(monitor->watchdog.head + monitor->watchdog.count) % monitor->watchdog.size];
+        stall->type     = type;
+        stall->name     = (dispatch) ? monitor_subject_type_name(dispatch->type) : NULL;
+        stall->subject  = (dispatch) ? dispatch->subject : NULL;
+        stall->onevent  = (dispatch) ? dispatch->onevent : NULL;
+        stall->duration = duration;
+        monitor->watchdog.count += 1;
+        monitor->stats.counters.watchdog.stalls += 1;
 }
 
 static void monitor_timer_subject_set_position (void *entry, unsigned int position)
@@ -228,318 +373,652 @@ static unsigned int monitor_timer_subject_get_position (void *entry)
         return timer->_position;
 }
 
-static int monitor_process_deletes (struct medusa_monitor *monitor)
+enum {
+        MONITOR_SUBJECT_PRIORITY_EXEC           = 0,
+        MONITOR_SUBJECT_PRIORITY_HTTPREQUEST    = 1,
+        MONITOR_SUBJECT_PRIORITY_TCPSOCKET      = 2,
+        MONITOR_SUBJECT_PRIORITY_PRIMITIVE      = 3,
+        MONITOR_SUBJECT_PRIORITY_COUNT          = 4
+};
+
+struct monitor_subject_ops {
+        unsigned int priority;
+        int (*change) (struct medusa_monitor *monitor, struct medusa_subject *subject, struct timespec *now);
+        int (*detach) (struct medusa_monitor *monitor, struct medusa_subject *subject);
+        int (*destroy) (struct medusa_monitor *monitor, struct medusa_subject *subject);
+};
+
+static inline void monitor_subject_activate (struct medusa_monitor *monitor, struct medusa_subject *subject)
+{
+        TAILQ_REMOVE(&monitor->changes, subject, list);
+        TAILQ_INSERT_TAIL(&monitor->actives, subject, list);
+        monitor->stats.counters.subjects.changes -= 1;
+        monitor->stats.counters.subjects.actives += 1;
+        subject->flags &= ~MEDUSA_SUBJECT_FLAG_MOD;
+        subject->flags &= ~MEDUSA_SUBJECT_FLAG_ROGUE;
+}
+
+static inline void monitor_subject_orphan (struct medusa_monitor *monitor, struct medusa_subject *subject)
+{
+        TAILQ_REMOVE(&monitor->changes, subject, list);
+        TAILQ_INSERT_TAIL(&monitor->rogues, subject, list);
+        monitor->stats.counters.subjects.changes -= 1;
+        monitor->stats.counters.subjects.rogues += 1;
+        subject->flags &= ~MEDUSA_SUBJECT_FLAG_MOD;
+        subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
+        subject->flags |= MEDUSA_SUBJECT_FLAG_ROGUE;
+}
+
+static int monitor_io_detach (struct medusa_monitor *monitor, struct medusa_subject *subject)
 {
         int rc;
-        struct medusa_subject *subject;
-        struct medusa_subject *nsubject;
-        TAILQ_FOREACH_SAFE(subject, &monitor->deletes, list, nsubject) {
-                if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_EXEC) {
-                        struct medusa_exec *exec;
-                        TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        exec = (struct medusa_exec *) subject;
-                        rc = medusa_exec_onevent_unlocked(exec, MEDUSA_EXEC_EVENT_DESTROY);
-                        if (rc < 0) {
-                                goto bail;
-                        }
+        if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
+                rc = monitor->poll.backend->del(monitor->poll.backend, (struct medusa_io *) subject);
+                if (rc != 0) {
+                        return rc;
                 }
+                monitor->stats.counters.syscalls.del += 1;
+                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
         }
-        TAILQ_FOREACH_SAFE(subject, &monitor->deletes, list, nsubject) {
-                if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_HTTPREQUEST) {
-                        struct medusa_httprequest *httprequest;
-                        TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        httprequest = (struct medusa_httprequest *) subject;
-                        rc = medusa_httprequest_onevent_unlocked(httprequest, MEDUSA_HTTPREQUEST_EVENT_DESTROY);
-                        if (rc < 0) {
-                                goto bail;
+        return 0;
+}
+
+static int monitor_io_change (struct medusa_monitor *monitor, struct medusa_subject *subject, struct timespec *now)
+{
+        int rc;
+        struct medusa_io *io = (struct medusa_io *) subject;
+        (void) now;
+        if (!medusa_io_is_valid_unlocked(io)) {
+                rc = monitor_io_detach(monitor, subject);
+                if (rc != 0) {
+                        return rc;
+                }
+                monitor_subject_orphan(monitor, subject);
+                return 0;
+        }
+        if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
+                if (medusa_io_get_polled_unlocked(io) > 0) {
+                        monitor->poll.elided += 1;
+                } else {
+                        rc = monitor->poll.backend->mod(monitor->poll.backend, io);
+                        if (rc != 0) {
+                                return rc;
                         }
+                        monitor->stats.counters.syscalls.mod += 1;
                 }
+        } else {
+                rc = monitor->poll.backend->add(monitor->poll.backend, io);
+                if (rc != 0) {
+                        return rc;
+                }
+                monitor->stats.counters.syscalls.add += 1;
         }
-        TAILQ_FOREACH_SAFE(subject, &monitor->deletes, list, nsubject) {
-                if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_TCPSOCKET) {
-                        struct medusa_tcpsocket *tcpsocket;
-                        TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        tcpsocket = (struct medusa_tcpsocket *) subject;
-                        rc = medusa_tcpsocket_onevent_unlocked(tcpsocket, MEDUSA_TCPSOCKET_EVENT_DESTROY);
+        medusa_io_set_polled_unlocked(io, 1);
+        monitor_subject_activate(monitor, subject);
+        subject->flags |= MEDUSA_SUBJECT_FLAG_HEAP;
+        return 0;
+}
+
+static int monitor_io_destroy (struct medusa_monitor *monitor, struct medusa_subject *subject)
+{
+        (void) monitor;
+        return medusa_io_onevent_unlocked((struct medusa_io *) subject, MEDUSA_IO_EVENT_DESTROY);
+}
+
+static int monitor_timer_is_millisecond (const struct medusa_timer *timer)
+{
+        unsigned int resolution;
+        resolution = medusa_timer_get_resolution_unlocked(timer);
+        return (resolution == MEDUSA_TIMER_RESOLUTION_MILLISECONDS ||
+                resolution == MEDUSA_TIMER_RESOLUTION_SECONDS);
+}
+
+static int monitor_timer_is_coarse (struct medusa_monitor *monitor, const struct medusa_timer *timer)
+{
+        if (medusa_timer_get_coarse_unlocked(timer) > 0) {
+                return 1;
+        }
+        if (monitor->flags & MEDUSA_MONITOR_FLAG_TIMER_WHEEL) {
+                return monitor_timer_is_millisecond(timer);
+        }
+        return 0;
+}
+
+static int monitor_timer_detach (struct medusa_monitor *monitor, struct medusa_subject *subject)
+{
+        int rc;
+        struct medusa_timer *timer = (struct medusa_timer *) subject;
+        if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
+                if (wheel_pending(&timer->_wheel)) {
+                        rc = wheel_del(monitor->timer.wheel, &timer->_wheel);
+                } else {
+                        rc = pqueue4_del(monitor->timer.pqueue, subject);
+                }
+                if (rc != 0) {
+                        return rc;
+                }
+                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
+                monitor->timer.dirty = 1;
+        }
+        return 0;
+}
+
+static int monitor_timer_change (struct medusa_monitor *monitor, struct medusa_subject *subject, struct timespec *now)
+{
+        int rc;
+        struct timespec base;
+        struct medusa_timer *timer = (struct medusa_timer *) subject;
+        if (!medusa_timer_is_valid_unlocked(timer)) {
+                rc = monitor_timer_detach(monitor, subject);
+                if (rc != 0) {
+                        return rc;
+                }
+                medusa_timespec_clear(&timer->_timespec);
+                monitor_subject_orphan(monitor, subject);
+                return 0;
+        }
+        if (monitor->flags & MEDUSA_MONITOR_FLAG_CLOCK_COARSE) {
+                /*
+                 * the coarse clock lags by up to one tick, so millisecond
+                 * timers are pushed by its resolution to never fire early,
+                 * finer timers read the precise clock.
+                 */
+                if (monitor_timer_is_millisecond(timer)) {
+                        medusa_timespec_add(now, &monitor->clock.resolution, &base);
+                } else {
+                        rc = medusa_clock_monotonic(&base);
                         if (rc < 0) {
-                                goto bail;
+                                return rc;
                         }
                 }
+                now = &base;
         }
-        TAILQ_FOREACH_SAFE(subject, &monitor->deletes, list, nsubject) {
-                if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_IO) {
-                        struct medusa_io *io;
-                        TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        io = (struct medusa_io *) subject;
-                        if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                                rc = monitor->poll.backend->del(monitor->poll.backend, io);
-                                if (rc != 0) {
-                                        goto bail;
-                                }
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
+        rc = medusa_timer_update_timespec_unlocked(timer, now);
+        if (rc < 0) {
+                return rc;
+        }
+        if (monitor_timer_is_coarse(monitor, timer)) {
+                if ((subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) &&
+                    !wheel_pending(&timer->_wheel)) {
+                        rc = pqueue4_del(monitor->timer.pqueue, subject);
+                        if (rc != 0) {
+                                return rc;
                         }
-                        rc = medusa_io_onevent_unlocked(io, MEDUSA_IO_EVENT_DESTROY);
-                        if (rc < 0) {
-                                goto bail;
+                }
+                rc = wheel_mod(monitor->timer.wheel, &timer->_wheel, monitor_timespec_ticks(&timer->_timespec, 1));
+                if (rc != 0) {
+                        return rc;
+                }
+        } else {
+                if ((subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) &&
+                    wheel_pending(&timer->_wheel)) {
+                        rc = wheel_del(monitor->timer.wheel, &timer->_wheel);
+                        if (rc != 0) {
+                                return rc;
                         }
-                } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_TIMER) {
-                        struct medusa_timer *timer;
-                        TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        timer = (struct medusa_timer *) subject;
-                        if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                                rc = pqueue_del(monitor->timer.pqueue, timer);
-                                if (rc != 0) {
-                                        goto bail;
-                                }
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
-                                monitor->timer.dirty = 1;
+                        subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
+                }
+                if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
+                        rc = pqueue4_mod(monitor->timer.pqueue, timer, monitor_timespec_nsec(&timer->_timespec));
+                        if (rc != 0) {
+                                return rc;
                         }
-                        rc = medusa_timer_onevent_unlocked(timer, MEDUSA_TIMER_EVENT_DESTROY);
-                        if (rc < 0) {
+                } else {
+                        rc = pqueue4_add(monitor->timer.pqueue, subject, monitor_timespec_nsec(&timer->_timespec));
+                        if (rc != 0) {
+                                return rc;
+                        }
+                }
+        }
+        monitor_subject_activate(monitor, subject);
+        subject->flags |= MEDUSA_SUBJECT_FLAG_HEAP;
+        monitor->timer.dirty = 1;
+        return 0;
+}
+
+static int monitor_timer_destroy (struct medusa_monitor *monitor, struct medusa_subject *subject)
+{
+        (void) monitor;
+        return medusa_timer_onevent_unlocked((struct medusa_timer *) subject, MEDUSA_TIMER_EVENT_DESTROY);
+}
+
+static int monitor_signal_detach (struct medusa_monitor *monitor, struct medusa_subject *subject)
+{
+        int rc;
+        if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
+                rc = monitor->signal.backend->del(monitor->signal.backend, (struct medusa_signal *) subject);
+                if (rc != 0) {
+                        return rc;
+                }
+                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
+        }
+        return 0;
+}
+
+static int monitor_signal_change (struct medusa_monitor *monitor, struct medusa_subject *subject, struct timespec *now)
+{
+        int rc;
+        struct medusa_signal *signal = (struct medusa_signal *) subject;
+        (void) now;
+        if (!medusa_signal_is_valid_unlocked(signal)) {
+                rc = monitor_signal_detach(monitor, subject);
+                if (rc != 0) {
+                        return rc;
+                }
+                monitor_subject_orphan(monitor, subject);
+                return 0;
+        }
+        if (!(subject->flags & MEDUSA_SUBJECT_FLAG_HEAP)) {
+                rc = monitor->signal.backend->add(monitor->signal.backend, signal);
+                if (rc != 0) {
+                        return rc;
+                }
+        }
+        monitor_subject_activate(monitor, subject);
+        subject->flags |= MEDUSA_SUBJECT_FLAG_HEAP;
+        return 0;
+}
+
+static int monitor_signal_destroy (struct medusa_monitor *monitor, struct medusa_subject *subject)
+{
+        (void) monitor;
+        return medusa_signal_onevent_unlocked((struct medusa_signal *) subject, MEDUSA_SIGNAL_EVENT_DESTROY);
+}
+
+static int monitor_composite_change (struct medusa_monitor *monitor, struct medusa_subject *subject, struct timespec *now)
+{
+        (void) now;
+        monitor_subject_activate(monitor, subject);
+        return 0;
+}
+
+static int monitor_tcpsocket_destroy (struct medusa_monitor *monitor, struct medusa_subject *subject)
+{
+        (void) monitor;
+        return medusa_tcpsocket_onevent_unlocked((struct medusa_tcpsocket *) subject, MEDUSA_TCPSOCKET_EVENT_DESTROY);
+}
+
+static int monitor_httprequest_destroy (struct medusa_monitor *monitor, struct medusa_subject *subject)
+{
+        (void) monitor;
+        return medusa_httprequest_onevent_unlocked((struct medusa_httprequest *) subject, MEDUSA_HTTPREQUEST_EVENT_DESTROY);
+}
+
+static int monitor_exec_destroy (struct medusa_monitor *monitor, struct medusa_subject *subject)
+{
+        (void) monitor;
+        return medusa_exec_onevent_unlocked((struct medusa_exec *) subject, MEDUSA_EXEC_EVENT_DESTROY);
+}
+
+static const struct monitor_subject_ops g_subject_ops[] = {
+        [MEDUSA_SUBJECT_TYPE_IO] = {
+                .priority       = MONITOR_SUBJECT_PRIORITY_PRIMITIVE,
+                .change         = monitor_io_change,
+                .detach         = monitor_io_detach,
+                .destroy        = monitor_io_destroy
+        },
+        [MEDUSA_SUBJECT_TYPE_TIMER] = {
+                .priority       = MONITOR_SUBJECT_PRIORITY_PRIMITIVE,
+                .change         = monitor_timer_change,
+                .detach         = monitor_timer_detach,
+                .destroy        = monitor_timer_destroy
+        },
+        [MEDUSA_SUBJECT_TYPE_SIGNAL] = {
+                .priority       = MONITOR_SUBJECT_PRIORITY_PRIMITIVE,
+                .change         = monitor_signal_change,
+                .detach         = monitor_signal_detach,
+                .destroy        = monitor_signal_destroy
+        },
+        [MEDUSA_SUBJECT_TYPE_TCPSOCKET] = {
+                .priority       = MONITOR_SUBJECT_PRIORITY_TCPSOCKET,
+                .change         = monitor_composite_change,
+                .detach         = NULL,
+                .destroy        = monitor_tcpsocket_destroy
+        },
+        [MEDUSA_SUBJECT_TYPE_HTTPREQUEST] = {
+                .priority       = MONITOR_SUBJECT_PRIORITY_HTTPREQUEST,
+                .change         = monitor_composite_change,
+                .detach         = NULL,
+                .destroy        = monitor_httprequest_destroy
+        },
+        [MEDUSA_SUBJECT_TYPE_EXEC] = {
+                .priority       = MONITOR_SUBJECT_PRIORITY_EXEC,
+                .change         = monitor_composite_change,
+                .detach         = NULL,
+                .destroy        = monitor_exec_destroy
+        },
+};
+
+static inline const struct monitor_subject_ops * monitor_subject_get_ops (const struct medusa_subject *subject)
+{
+        unsigned int type;
+        type = medusa_subject_get_type((struct medusa_subject *) subject);
+        if (type >= sizeof(g_subject_ops) / sizeof(g_subject_ops[0]) ||
+            g_subject_ops[type].destroy == NULL) {
+                return NULL;
+        }
+        return &g_subject_ops[type];
+}
+
+static int monitor_process_deletes (struct medusa_monitor *monitor, int force)
+{
+        int rc;
+        unsigned int priority;
+        struct medusa_subject *subject;
+        struct medusa_subjects pending[MONITOR_SUBJECT_PRIORITY_COUNT];
+        const struct monitor_subject_ops *ops;
+        for (priority = 0; priority < MONITOR_SUBJECT_PRIORITY_COUNT; priority++) {
+                TAILQ_INIT(&pending[priority]);
+        }
+        while (!TAILQ_EMPTY(&monitor->deletes)) {
+                while ((subject = TAILQ_FIRST(&monitor->deletes)) != NULL) {
+                        ops = monitor_subject_get_ops(subject);
+                        if (ops == NULL) {
                                 goto bail;
                         }
-                } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_SIGNAL) {
-                        struct medusa_signal *signal;
                         TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        signal = (struct medusa_signal *) subject;
-                        if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                                rc = monitor->signal.backend->del(monitor->signal.backend, signal);
-                                if (rc != 0) {
+                        TAILQ_INSERT_TAIL(&pending[ops->priority], subject, list);
+                        monitor->stats.counters.subjects.deletes -= 1;
+                }
+                for (priority = 0; priority < MONITOR_SUBJECT_PRIORITY_COUNT; priority++) {
+                        while ((subject = TAILQ_FIRST(&pending[priority])) != NULL) {
+                                TAILQ_REMOVE(&pending[priority], subject, list);
+                                ops = monitor_subject_get_ops(subject);
+                                if (ops->detach != NULL) {
+                                        rc = ops->detach(monitor, subject);
+                                        if (rc != 0 && !force) {
+                                                goto bail;
+                                        }
+                                }
+                                rc = ops->destroy(monitor, subject);
+                                if (rc < 0 && !force) {
                                         goto bail;
                                 }
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
                         }
-                        rc = medusa_signal_onevent_unlocked(signal, MEDUSA_SIGNAL_EVENT_DESTROY);
-                        if (rc < 0) {
-                                goto bail;
-                        }
-                } else {
-                        goto bail;
                 }
         }
-        if (!TAILQ_EMPTY(&monitor->deletes)) {
-                rc = monitor_signal(monitor, WAKEUP_REASON_SUBJECT_DEL);
-                if (rc < 0) {
-                        goto bail;
+        return 0;
+bail:   for (priority = 0; priority < MONITOR_SUBJECT_PRIORITY_COUNT; priority++) {
+                while ((subject = TAILQ_FIRST(&pending[priority])) != NULL) {
+                        TAILQ_REMOVE(&pending[priority], subject, list);
+                        TAILQ_INSERT_TAIL(&monitor->deletes, subject, list);
+                        monitor->stats.counters.subjects.deletes += 1;
                 }
         }
-        return 0;
-bail:   return -EIO;
+        return -EIO;
 }
 
 static int monitor_process_changes (struct medusa_monitor *monitor)
 {
         int rc;
         struct timespec now;
-        struct medusa_io *io;
-        struct medusa_timer *timer;
-        struct medusa_signal *signal;
         struct medusa_subject *subject;
         struct medusa_subject *nsubject;
-        rc = medusa_clock_monotonic(&now);
-        if (rc < 0) {
-                goto bail;
-        }
+        const struct monitor_subject_ops *ops;
+        now = monitor->clock.now;
         TAILQ_FOREACH_SAFE(subject, &monitor->changes, list, nsubject) {
-                if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_IO) {
-                        io = (struct medusa_io *) subject;
-                        if (!medusa_io_is_valid_unlocked(io)) {
-                                if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                                        rc = monitor->poll.backend->del(monitor->poll.backend, io);
-                                        if (rc != 0) {
-                                                goto bail;
-                                        }
-                                }
-                                TAILQ_REMOVE(&monitor->changes, subject, list);
-                                TAILQ_INSERT_TAIL(&monitor->rogues, subject, list);
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_MOD;
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
-                                subject->flags |= MEDUSA_SUBJECT_FLAG_ROGUE;
-                        } else {
-                                if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                                        rc = monitor->poll.backend->mod(monitor->poll.backend, io);
-                                        if (rc != 0) {
-                                                goto bail;
-                                        }
-                                } else {
-                                        rc = monitor->poll.backend->add(monitor->poll.backend, io);
-                                        if (rc != 0) {
-                                                goto bail;
-                                        }
-                                }
-                                TAILQ_REMOVE(&monitor->changes, subject, list);
-                                TAILQ_INSERT_TAIL(&monitor->actives, subject, list);
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_MOD;
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_ROGUE;
-                                subject->flags |= MEDUSA_SUBJECT_FLAG_HEAP;
-                        }
-                } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_TIMER) {
-                        timer = (struct medusa_timer *) subject;
-                        if (!medusa_timer_is_valid_unlocked(timer)) {
-                                if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                                        rc = pqueue_del(monitor->timer.pqueue, timer);
-                                        if (rc != 0) {
-                                                goto bail;
-                                        }
-                                        monitor->timer.dirty = 1;
-                                }
-                                medusa_timespec_clear(&timer->_timespec);
-                                TAILQ_REMOVE(&monitor->changes, subject, list);
-                                TAILQ_INSERT_TAIL(&monitor->rogues, subject, list);
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_MOD;
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
-                                subject->flags |= MEDUSA_SUBJECT_FLAG_ROGUE;
-                        } else {
-                                struct timespec _timespec;
-                                _timespec = timer->_timespec;
-                                rc = medusa_timer_update_timespec_unlocked(timer, &now);
-                                if (rc < 0) {
-                                        goto bail;
-                                }
-                                if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                                        rc = pqueue_mod(monitor->timer.pqueue, timer, medusa_timespec_compare(&_timespec, &timer->_timespec, >));
-                                        if (rc != 0) {
-                                                goto bail;
-                                        }
-                                } else {
-                                        rc = pqueue_add(monitor->timer.pqueue, subject);
-                                        if (rc != 0) {
-                                                goto bail;
-                                        }
-                                }
-                                TAILQ_REMOVE(&monitor->changes, subject, list);
-                                TAILQ_INSERT_TAIL(&monitor->actives, subject, list);
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_MOD;
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_ROGUE;
-                                subject->flags |= MEDUSA_SUBJECT_FLAG_HEAP;
-                                monitor->timer.dirty = 1;
-                        }
-                } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_SIGNAL) {
-                        signal = (struct medusa_signal *) subject;
-                        if (!medusa_signal_is_valid_unlocked(signal)) {
-                                if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                                        rc = monitor->signal.backend->del(monitor->signal.backend, signal);
-                                        if (rc != 0) {
-                                                goto bail;
-                                        }
-                                }
-                                TAILQ_REMOVE(&monitor->changes, subject, list);
-                                TAILQ_INSERT_TAIL(&monitor->rogues, subject, list);
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_MOD;
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
-                                subject->flags |= MEDUSA_SUBJECT_FLAG_ROGUE;
-                        } else {
-                                if (!(subject->flags & MEDUSA_SUBJECT_FLAG_HEAP)) {
-                                        rc = monitor->signal.backend->add(monitor->signal.backend, signal);
-                                        if (rc != 0) {
-                                                goto bail;
-                                        }
-                                }
-                                TAILQ_REMOVE(&monitor->changes, subject, list);
-                                TAILQ_INSERT_TAIL(&monitor->actives, subject, list);
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_MOD;
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_ROGUE;
-                                subject->flags |= MEDUSA_SUBJECT_FLAG_HEAP;
-                        }
-                } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_TCPSOCKET) {
-                        TAILQ_REMOVE(&monitor->changes, subject, list);
-                        TAILQ_INSERT_TAIL(&monitor->actives, subject, list);
-                        subject->flags &= ~MEDUSA_SUBJECT_FLAG_MOD;
-                        subject->flags &= ~MEDUSA_SUBJECT_FLAG_ROGUE;
-                } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_HTTPREQUEST) {
-                        TAILQ_REMOVE(&monitor->changes, subject, list);
-                        TAILQ_INSERT_TAIL(&monitor->actives, subject, list);
-                        subject->flags &= ~MEDUSA_SUBJECT_FLAG_MOD;
-                        subject->flags &= ~MEDUSA_SUBJECT_FLAG_ROGUE;
-                } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_EXEC) {
-                        TAILQ_REMOVE(&monitor->changes, subject, list);
-                        TAILQ_INSERT_TAIL(&monitor->actives, subject, list);
-                        subject->flags &= ~MEDUSA_SUBJECT_FLAG_MOD;
-                        subject->flags &= ~MEDUSA_SUBJECT_FLAG_ROGUE;
+                ops = monitor_subject_get_ops(subject);
+                if (ops == NULL) {
+                        continue;
+                }
+                rc = ops->change(monitor, subject, &now);
+                if (rc != 0) {
+                        goto bail;
                 }
         }
         return 0;
 bail:   return rc;
 }
 
-static int monitor_setup_timer (struct medusa_monitor *monitor)
+static int monitor_timer_next (struct medusa_monitor *monitor, struct timespec *next)
 {
         int rc;
+        unsigned long long ticks;
+        struct timespec timespec;
         struct medusa_timer *timer;
+        rc = 0;
+        timer = pqueue4_peek(monitor->timer.pqueue, NULL);
+        if (timer != NULL) {
+                *next = timer->_timespec;
+                rc = 1;
+        }
+        if (wheel_next(monitor->timer.wheel, &ticks) > 0) {
+                monitor_ticks_timespec(ticks, &timespec);
+                if (rc == 0 ||
+                    medusa_timespec_compare(&timespec, next, <)) {
+                        *next = timespec;
+                        rc = 1;
+                }
+        }
+        return rc;
+}
+
+static int monitor_setup_timer (struct medusa_monitor *monitor)
+{
+        int rc;
+        int next;
+        int precise;
+        struct timespec timespec;
+        /*
+         * without a timer backend the earliest deadline is always passed
+         * as the poll timeout, backends round it up to their granularity.
+         */
+        precise = (monitor->timer.backend == NULL) ||
+                  !!(monitor->poll.backend->flags & MEDUSA_POLL_BACKEND_FLAG_PRECISE);
+        if (monitor->timer.precise != precise) {
+                monitor->timer.precise = precise;
+                monitor->timer.dirty = 1;
+        }
         if (monitor->timer.dirty != 0) {
-                timer = pqueue_peek(monitor->timer.pqueue);
-                rc = monitor->timer.backend->set(monitor->timer.backend, (timer) ? &timer->_timespec : NULL);
+                next = 0;
+                if (monitor->timer.precise == 0) {
+                        next = monitor_timer_next(monitor, &timespec);
+                }
+                if (next != 0 &&
+                    monitor->timer.armed != 0 &&
+                    medusa_timespec_compare(&monitor->timer.deadline, &timespec, ==)) {
+                        /* coalesced timers keep the backend on the same deadline */
+                } else if (next != 0 || monitor->timer.armed != 0) {
+                        rc = monitor->timer.backend->set(monitor->timer.backend, (next) ? &timespec : NULL);
+                        if (rc != 0) {
+                                goto bail;
+                        }
+                        monitor->stats.counters.syscalls.timer += 1;
+                }
+                if (next != 0) {
+                        monitor->timer.deadline = timespec;
+                }
+                monitor->timer.armed = (next != 0);
+                monitor->timer.dirty = 0;
+        }
+        return 0;
+bail:   return -1;
+}
+
+static struct timespec * monitor_poll_timeout (struct medusa_monitor *monitor, struct timespec *timespec, struct timespec *_timespec)
+{
+        struct timespec now;
+        struct timespec next;
+        if (monitor->timer.precise == 0) {
+                return timespec;
+        }
+        if (monitor_timer_next(monitor, &next) == 0) {
+                return timespec;
+        }
+        now = monitor->clock.now;
+        if (medusa_timespec_compare(&next, &now, <=)) {
+                medusa_timespec_clear(_timespec);
+        } else {
+                medusa_timespec_sub(&next, &now, _timespec);
+        }
+        if (timespec != NULL &&
+            medusa_timespec_compare(timespec, _timespec, <)) {
+                return timespec;
+        }
+        return _timespec;
+}
+
+static int monitor_hit_timer (void *context, void *a)
+{
+        int rc;
+        struct medusa_timer *timer = a;
+        struct medusa_monitor *monitor = context;
+        monitor->stats.counters.timers.fired += 1;
+        rc = medusa_timer_onevent_unlocked(timer, MEDUSA_TIMER_EVENT_TIMEOUT);
+        if (rc != 0) {
+                goto bail;
+        }
+        rc = medusa_monitor_mod_unlocked(&timer->subject);
+        if (rc != 0) {
+                goto bail;
+        }
+        return 0;
+bail:   return -1;
+}
+
+static int monitor_wheel_expire (void *context, struct wheel_entry *entry)
+{
+        struct medusa_timer *timer;
+        timer = (struct medusa_timer *) (((char *) entry) - offsetof(struct medusa_timer, _wheel));
+        timer->subject.flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
+        return monitor_hit_timer(context, timer);
+}
+
+static int monitor_poll_run (struct medusa_monitor *monitor, struct timespec *timespec, unsigned long long *waits)
+{
+        int rc;
+        unsigned int iterations;
+        struct timespec now;
+        struct timespec zero;
+        struct timespec start;
+        struct timespec elapsed;
+        struct timespec remaining;
+        if (!medusa_timespec_isset(&monitor->busypoll.timeout) &&
+            monitor->busypoll.iterations == 0) {
+                *waits += 1;
+                return monitor->poll.backend->run(monitor->poll.backend, timespec);
+        }
+        if (timespec != NULL &&
+            !medusa_timespec_isset(timespec)) {
+                *waits += 1;
+                return monitor->poll.backend->run(monitor->poll.backend, timespec);
+        }
+        rc = medusa_clock_monotonic(&start);
+        if (rc < 0) {
+                return rc;
+        }
+        medusa_timespec_clear(&zero);
+        medusa_timespec_clear(&elapsed);
+        for (iterations = 1; ; iterations++) {
+                *waits += 1;
+                rc = monitor->poll.backend->run(monitor->poll.backend, &zero);
                 if (rc != 0) {
-                        goto bail;
+                        return rc;
+                }
+                rc = medusa_clock_monotonic(&now);
+                if (rc < 0) {
+                        return rc;
+                }
+                medusa_timespec_sub(&now, &start, &elapsed);
+                if (timespec != NULL &&
+                    medusa_timespec_compare(&elapsed, timespec, >=)) {
+                        return 0;
+                }
+                if (monitor->busypoll.iterations != 0 &&
+                    iterations >= monitor->busypoll.iterations) {
+                        break;
+                }
+                if (medusa_timespec_isset(&monitor->busypoll.timeout) &&
+                    medusa_timespec_compare(&elapsed, &monitor->busypoll.timeout, >=)) {
+                        break;
                 }
-                monitor->timer.dirty = 0;
-        }
-        return 0;
-bail:   return -1;
-}
-
-static __attribute__ ((__unused__))  int monitor_hit_timer (void *context, void *a)
-{
-        int rc;
-        struct medusa_timer *timer = a;
-        struct medusa_monitor *monitor = context;
-        (void) monitor;
-        rc = medusa_timer_onevent_unlocked(timer, MEDUSA_TIMER_EVENT_TIMEOUT);
-        if (rc != 0) {
-                goto bail;
         }
-        rc = medusa_monitor_mod_unlocked(&timer->subject);
-        if (rc != 0) {
-                goto bail;
+        if (timespec == NULL) {
+                *waits += 1;
+                return monitor->poll.backend->run(monitor->poll.backend, NULL);
         }
-        return 0;
-bail:   return -1;
+        medusa_timespec_sub(timespec, &elapsed, &remaining);
+        *waits += 1;
+        return monitor->poll.backend->run(monitor->poll.backend, &remaining);
 }
 
 static int monitor_check_timer (struct medusa_monitor *monitor)
 {
         int rc;
         struct timespec now;
-        rc = medusa_clock_monotonic(&now);
-        if (rc < 0) {
-                goto bail;
+        struct medusa_subject *subject;
+        struct medusa_subject *nsubject;
+        if (monitor->timer.fired != 0 &&
+            monitor->timer.armed != 0 &&
+            medusa_timespec_compare(&monitor->timer.deadline, &monitor->clock.now, >)) {
+                /* the backend fired, a coarse read can still be behind its deadline */
+                rc = medusa_clock_monotonic(&now);
+                if (rc < 0) {
+                        goto bail;
+                }
+                if (medusa_timespec_compare(&now, &monitor->clock.now, >)) {
+                        monitor->clock.now = now;
+                }
+        }
+        now = monitor->clock.now;
+        if (monitor->timer.fired == 0 &&
+            monitor->timer.precise != 0) {
+                unsigned long long key;
+                if (pqueue4_peek(monitor->timer.pqueue, &key) != NULL &&
+                    key <= monitor_timespec_nsec(&now)) {
+                        monitor->timer.fired = 1;
+                }
         }
         if (monitor->timer.fired != 0) {
-#if 0
+                unsigned int i;
+                unsigned int count;
                 struct medusa_timer *timer;
-                while (1) {
-                        timer = pqueue_peek(monitor->timer.pqueue);
-                        if (timer == NULL) {
-                                break;
-                        }
-                        if (medusa_timespec_compare(&timer->_timespec, &now, >)) {
-                                break;
+                void *timers[MONITOR_TIMER_BATCH];
+                do {
+                        count = pqueue4_pop_expired(monitor->timer.pqueue, monitor_timespec_nsec(&now), timers, MONITOR_TIMER_BATCH);
+                        for (i = 0; i < count; i++) {
+                                timer = timers[i];
+                                timer->subject.flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
+                                monitor->timer.dirty = 1;
                         }
-                        timer = pqueue_pop(monitor->timer.pqueue);
-                        if (timer == NULL) {
-                                break;
+                        for (i = 0; i < count; i++) {
+                                timer = timers[i];
+                                if (!medusa_subject_is_active(&timer->subject)) {
+                                        continue;
+                                }
+                                if (!medusa_timer_is_valid_unlocked(timer)) {
+                                        rc = medusa_monitor_mod_unlocked(&timer->subject);
+                                } else {
+                                        rc = monitor_hit_timer(monitor, timer);
+                                }
+                                if (rc != 0) {
+                                        while (++i < count) {
+                                                medusa_monitor_mod_unlocked(&((struct medusa_timer *) timers[i])->subject);
+                                        }
+                                        goto bail;
+                                }
                         }
-                        timer->subject.flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
-                        monitor->timer.dirty = 1;
-                        rc = medusa_timer_onevent_unlocked(timer, MEDUSA_TIMER_EVENT_TIMEOUT);
-                        if (rc != 0) {
-                                goto bail;
+                } while (count == MONITOR_TIMER_BATCH);
+                monitor->timer.fired = 0;
+                monitor->timer.armed = 0;
+        }
+        rc = wheel_advance(monitor->timer.wheel, monitor_timespec_ticks(&now, 0), monitor_wheel_expire, monitor);
+        if (rc < 0) {
+                goto bail;
+        }
+        if (rc > 0) {
+                monitor->timer.dirty = 1;
+        }
+        if (monitor->timer.dirty != 0) {
+                TAILQ_FOREACH_SAFE(subject, &monitor->changes, list, nsubject) {
+                        if (medusa_subject_get_type(subject) != MEDUSA_SUBJECT_TYPE_TIMER) {
+                                continue;
                         }
-                        rc = medusa_monitor_mod_unlocked(&timer->subject);
+                        rc = monitor_timer_change(monitor, subject, &now);
                         if (rc != 0) {
                                 goto bail;
                         }
                 }
-#else
-                struct medusa_timer tk;
-                memset(&tk, 0, sizeof(struct medusa_timer));
-                tk._timespec = now;
-                rc = pqueue_search(monitor->timer.pqueue, &tk, monitor_hit_timer, monitor);
-                if (rc != 0) {
-                        goto bail;
-                }
-#endif
-                monitor->timer.fired = 0;
         }
         return 0;
 bail:   return -1;
@@ -580,6 +1059,7 @@ __attribute__ ((visibility ("default"))) int medusa_monitor_add_unlocked (struct
                 return -EALREADY;
         }
         TAILQ_INSERT_TAIL(&monitor->changes, subject, list);
+        monitor->stats.counters.subjects.changes += 1;
         subject->monitor = monitor;
         subject->flags |= MEDUSA_SUBJECT_FLAG_MOD;
         rc = monitor_signal(monitor, WAKEUP_REASON_SUBJECT_ADD);
@@ -621,10 +1101,14 @@ __attribute__ ((visibility ("default"))) int medusa_monitor_mod_unlocked (struct
         } else if (subject->flags & MEDUSA_SUBJECT_FLAG_ROGUE) {
                 TAILQ_REMOVE(&subject->monitor->rogues, subject, list);
                 TAILQ_INSERT_TAIL(&subject->monitor->changes, subject, list);
+                subject->monitor->stats.counters.subjects.rogues -= 1;
+                subject->monitor->stats.counters.subjects.changes += 1;
                 subject->flags &= ~MEDUSA_SUBJECT_FLAG_ROGUE;
         } else {
                 TAILQ_REMOVE(&subject->monitor->actives, subject, list);
                 TAILQ_INSERT_TAIL(&subject->monitor->changes, subject, list);
+                subject->monitor->stats.counters.subjects.actives -= 1;
+                subject->monitor->stats.counters.subjects.changes += 1;
         }
         subject->flags |= MEDUSA_SUBJECT_FLAG_MOD;
         rc = 0;
@@ -637,20 +1121,18 @@ __attribute__ ((visibility ("default"))) int medusa_monitor_mod_unlocked (struct
                         if (rc < 0) {
                                 goto out;
                         }
+                        subject->monitor->stats.counters.syscalls.del += 1;
                         subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
                 }
 #if 1
         } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_TIMER) {
                 struct medusa_timer *timer;
                 timer = (struct medusa_timer *) subject;
-                if (!medusa_timer_is_valid_unlocked(timer) &&
-                    (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP)) {
-                        rc = pqueue_del(subject->monitor->timer.pqueue, timer);
+                if (!medusa_timer_is_valid_unlocked(timer)) {
+                        rc = monitor_timer_detach(subject->monitor, subject);
                         if (rc < 0) {
                                 goto out;
                         }
-                        subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
-                        subject->monitor->timer.dirty = 1;
                 }
 #endif
         } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_SIGNAL) {
@@ -690,6 +1172,7 @@ __attribute__ ((visibility ("default"))) int medusa_monitor_mod (struct medusa_s
 __attribute__ ((visibility ("default"))) int medusa_monitor_del_unlocked (struct medusa_subject *subject)
 {
         int rc;
+        const struct monitor_subject_ops *ops;
         if (MEDUSA_IS_ERR_OR_NULL(subject)) {
                 return -EINVAL;
         }
@@ -700,46 +1183,26 @@ __attribute__ ((visibility ("default"))) int medusa_monitor_del_unlocked (struct
         } else if (subject->flags & MEDUSA_SUBJECT_FLAG_MOD) {
                 TAILQ_REMOVE(&subject->monitor->changes, subject, list);
                 TAILQ_INSERT_TAIL(&subject->monitor->deletes, subject, list);
+                subject->monitor->stats.counters.subjects.changes -= 1;
+                subject->monitor->stats.counters.subjects.deletes += 1;
         } else if (subject->flags & MEDUSA_SUBJECT_FLAG_ROGUE) {
                 TAILQ_REMOVE(&subject->monitor->rogues, subject, list);
                 TAILQ_INSERT_TAIL(&subject->monitor->deletes, subject, list);
+                subject->monitor->stats.counters.subjects.rogues -= 1;
+                subject->monitor->stats.counters.subjects.deletes += 1;
                 subject->flags &= ~MEDUSA_SUBJECT_FLAG_ROGUE;
         } else {
                 TAILQ_REMOVE(&subject->monitor->actives, subject, list);
                 TAILQ_INSERT_TAIL(&subject->monitor->deletes, subject, list);
+                subject->monitor->stats.counters.subjects.actives -= 1;
+                subject->monitor->stats.counters.subjects.deletes += 1;
         }
         subject->flags |= MEDUSA_SUBJECT_FLAG_DEL;
-        rc = 0;
-        if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_IO) {
-                struct medusa_io *io;
-                io = (struct medusa_io *) subject;
-                if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                        rc = subject->monitor->poll.backend->del(subject->monitor->poll.backend, io);
-                        if (rc < 0) {
-                                goto out;
-                        }
-                        subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
-                }
-        } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_TIMER) {
-                struct medusa_timer *timer;
-                timer = (struct medusa_timer *) subject;
-                if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                        rc = pqueue_del(subject->monitor->timer.pqueue, timer);
-                        if (rc < 0) {
-                                goto out;
-                        }
-                        subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
-                        subject->monitor->timer.dirty = 1;
-                }
-        } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_SIGNAL) {
-                struct medusa_signal *signal;
-                signal = (struct medusa_signal *) subject;
-                if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                        rc = subject->monitor->signal.backend->del(subject->monitor->signal.backend, signal);
-                        if (rc < 0) {
-                                goto out;
-                        }
-                        subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
+        ops = monitor_subject_get_ops(subject);
+        if (ops != NULL && ops->detach != NULL) {
+                rc = ops->detach(subject->monitor, subject);
+                if (rc < 0) {
+                        goto out;
                 }
         }
         rc = monitor_signal(subject->monitor, WAKEUP_REASON_SUBJECT_DEL);
@@ -792,12 +1255,26 @@ __attribute__ ((visibility ("default"))) struct medusa_monitor * medusa_monitor_
         TAILQ_INIT(&monitor->deletes);
         TAILQ_INIT(&monitor->rogues);
         monitor->flags = options->flags;
+        monitor->busypoll.timeout.tv_sec  = options->busypoll.timeout / 1000000;
+        monitor->busypoll.timeout.tv_nsec = (options->busypoll.timeout % 1000000) * 1000;
+        monitor->busypoll.iterations      = options->busypoll.iterations;
+        monitor->busypoll.socket          = options->busypoll.socket;
+        monitor->watchdog.lag             = options->watchdog.lag * 1000ULL;
+        monitor->watchdog.callback        = options->watchdog.callback * 1000ULL;
         if (monitor->flags & MEDUSA_MONITOR_FLAG_THREAD_SAFE) {
                 pthread_mutex_init(&monitor->mutex, NULL);
         }
         monitor->running = 1;
         monitor->wakeup.fds[0] = -1;
         monitor->wakeup.fds[1] = -1;
+        if (monitor->watchdog.lag != 0 ||
+            monitor->watchdog.callback != 0) {
+                monitor->watchdog.size = (options->watchdog.size) ? options->watchdog.size : 64;
+                monitor->watchdog.stalls = (struct medusa_monitor_stall *) malloc(sizeof(struct medusa_monitor_stall) * monitor->watchdog.size);
+                if (monitor->watchdog.stalls == NULL) {
+                        goto bail;
+                }
+        }
         if (options->poll.type == MEDUSA_MONITOR_POLL_DEFAULT) {
                 do {
 #if defined(MEDUSA_POLL_EPOLL_ENABLE) && (MEDUSA_POLL_EPOLL_ENABLE == 1)
@@ -840,8 +1317,12 @@ __attribute__ ((visibility ("default"))) struct medusa_monitor * medusa_monitor_
 #if defined(MEDUSA_POLL_SELECT_ENABLE) && (MEDUSA_POLL_SELECT_ENABLE == 1)
         } else if (options->poll.type == MEDUSA_MONITOR_POLL_SELECT) {
                 monitor->poll.backend = medusa_monitor_select_create(NULL);
-        } else {
 #endif
+#if defined(MEDUSA_POLL_IO_URING_ENABLE) && (MEDUSA_POLL_IO_URING_ENABLE == 1)
+        } else if (options->poll.type == MEDUSA_MONITOR_POLL_IO_URING) {
+                monitor->poll.backend = medusa_monitor_io_uring_create(NULL);
+#endif
+        } else {
                 goto bail;
         }
         if (monitor->poll.backend == NULL) {
@@ -860,18 +1341,36 @@ __attribute__ ((visibility ("default"))) struct medusa_monitor * medusa_monitor_
 #if defined(MEDUSA_TIMER_TIMERFD_ENABLE) && (MEDUSA_TIMER_TIMERFD_ENABLE == 1)
         } else if (options->timer.type == MEDUSA_MONITOR_TIMER_TIMERFD) {
                 monitor->timer.backend = medusa_timer_timerfd_create(NULL);
+                if (monitor->timer.backend == NULL) {
+                        goto bail;
+                }
 #endif
+        } else if (options->timer.type == MEDUSA_MONITOR_TIMER_POLL) {
+                monitor->timer.backend = NULL;
         } else {
                 goto bail;
         }
-        if (monitor->timer.backend == NULL) {
-                goto bail;
+        if (monitor->timer.backend != NULL) {
+                monitor->timer.backend->monitor = monitor;
         }
-        monitor->timer.backend->monitor = monitor;
-        monitor->timer.pqueue = pqueue_create(0, 64, monitor_timer_subject_compare, monitor_timer_subject_set_position, monitor_timer_subject_get_position);
+        monitor->timer.pqueue = pqueue4_create(0, 64, monitor_timer_subject_set_position, monitor_timer_subject_get_position);
         if (monitor->timer.pqueue == NULL) {
                 goto bail;
         }
+        if (monitor->flags & MEDUSA_MONITOR_FLAG_CLOCK_COARSE) {
+                rc = medusa_clock_monotonic_coarse_resolution(&monitor->clock.resolution);
+                if (rc < 0) {
+                        goto bail;
+                }
+        }
+        rc = medusa_clock_monotonic(&monitor->clock.now);
+        if (rc < 0) {
+                goto bail;
+        }
+        monitor->timer.wheel = wheel_create(monitor_timespec_ticks(&monitor->clock.now, 0));
+        if (monitor->timer.wheel == NULL) {
+                goto bail;
+        }
         if (options->signal.type == MEDUSA_MONITOR_SIGNAL_DEFAULT) {
                 do {
 #if defined(MEDUSA_SIGNAL_SIGACTION_ENABLE) && (MEDUSA_SIGNAL_SIGACTION_ENABLE == 1)
@@ -892,17 +1391,23 @@ __attribute__ ((visibility ("default"))) struct medusa_monitor * medusa_monitor_
                 goto bail;
         }
         monitor->signal.backend->monitor = monitor;
-        rc = pipe(monitor->wakeup.fds);
-        if (rc != 0) {
-                goto bail;
-        }
-        rc = fd_set_blocking(monitor->wakeup.fds[0], 0);
-        if (rc != 0) {
-                goto bail;
-        }
-        rc = fd_set_blocking(monitor->wakeup.fds[1], 0);
-        if (rc != 0) {
-                goto bail;
+#if defined(__linux__)
+        monitor->wakeup.fds[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        monitor->wakeup.fds[1] = monitor->wakeup.fds[0];
+#endif
+        if (monitor->wakeup.fds[0] < 0) {
+                rc = pipe(monitor->wakeup.fds);
+                if (rc != 0) {
+                        goto bail;
+                }
+                rc = fd_set_blocking(monitor->wakeup.fds[0], 0);
+                if (rc != 0) {
+                        goto bail;
+                }
+                rc = fd_set_blocking(monitor->wakeup.fds[1], 0);
+                if (rc != 0) {
+                        goto bail;
+                }
         }
         rc = medusa_io_init(&monitor->wakeup.io, monitor, monitor->wakeup.fds[0], monitor_wakeup_io_onevent, monitor);
         if (rc < 0) {
@@ -916,17 +1421,19 @@ __attribute__ ((visibility ("default"))) struct medusa_monitor * medusa_monitor_
         if (rc < 0) {
                 goto bail;
         }
-        rc = medusa_io_init(&monitor->timer.io, monitor, monitor->timer.backend->fd(monitor->timer.backend), monitor_timer_io_onevent, monitor);
-        if (rc < 0) {
-                goto bail;
-        }
-        rc = medusa_io_set_events(&monitor->timer.io, MEDUSA_IO_EVENT_IN);
-        if (rc < 0) {
-                goto bail;
-        }
-        rc = medusa_io_set_enabled(&monitor->timer.io, 1);
-        if (rc < 0) {
-                goto bail;
+        if (monitor->timer.backend != NULL) {
+                rc = medusa_io_init(&monitor->timer.io, monitor, monitor->timer.backend->fd(monitor->timer.backend), monitor_timer_io_onevent, monitor);
+                if (rc < 0) {
+                        goto bail;
+                }
+                rc = medusa_io_set_events(&monitor->timer.io, MEDUSA_IO_EVENT_IN);
+                if (rc < 0) {
+                        goto bail;
+                }
+                rc = medusa_io_set_enabled(&monitor->timer.io, 1);
+                if (rc < 0) {
+                        goto bail;
+                }
         }
         rc = medusa_io_init(&monitor->signal.io, monitor, monitor->signal.backend->fd(monitor->signal.backend), monitor_signal_io_onevent, monitor);
         if (rc < 0) {
@@ -950,7 +1457,6 @@ bail:   if (monitor != NULL) {
 __attribute__ ((visibility ("default"))) void medusa_monitor_destroy (struct medusa_monitor *monitor)
 {
         struct medusa_subject *subject;
-        struct medusa_subject *nsubject;
         if (monitor == NULL) {
                 return;
         }
@@ -967,60 +1473,7 @@ __attribute__ ((visibility ("default"))) void medusa_monitor_destroy (struct med
                 subject = TAILQ_FIRST(&monitor->actives);
                 medusa_monitor_del_unlocked(subject);
         }
-        TAILQ_FOREACH_SAFE(subject, &monitor->deletes, list, nsubject) {
-                if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_EXEC) {
-                        struct medusa_exec *exec;
-                        TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        exec = (struct medusa_exec *) subject;
-                        medusa_exec_onevent_unlocked(exec, MEDUSA_EXEC_EVENT_DESTROY);
-                }
-        }
-        TAILQ_FOREACH_SAFE(subject, &monitor->deletes, list, nsubject) {
-                if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_HTTPREQUEST) {
-                        struct medusa_httprequest *httprequest;
-                        TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        httprequest = (struct medusa_httprequest *) subject;
-                        medusa_httprequest_onevent_unlocked(httprequest, MEDUSA_HTTPREQUEST_EVENT_DESTROY);
-                }
-        }
-        TAILQ_FOREACH_SAFE(subject, &monitor->deletes, list, nsubject) {
-                if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_TCPSOCKET) {
-                        struct medusa_tcpsocket *tcpsocket;
-                        TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        tcpsocket = (struct medusa_tcpsocket *) subject;
-                        medusa_tcpsocket_onevent_unlocked(tcpsocket, MEDUSA_TCPSOCKET_EVENT_DESTROY);
-                }
-        }
-        TAILQ_FOREACH_SAFE(subject, &monitor->deletes, list, nsubject) {
-                if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_IO) {
-                        struct medusa_io *io;
-                        TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        io = (struct medusa_io *) subject;
-                        if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                                monitor->poll.backend->del(monitor->poll.backend, io);
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
-                        }
-                        medusa_io_onevent_unlocked(io, MEDUSA_IO_EVENT_DESTROY);
-                } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_TIMER) {
-                        struct medusa_timer *timer;
-                        TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        timer = (struct medusa_timer *) subject;
-                        if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                                pqueue_del(monitor->timer.pqueue, timer);
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
-                        }
-                        medusa_timer_onevent_unlocked(timer, MEDUSA_TIMER_EVENT_DESTROY);
-                } else if (medusa_subject_get_type(subject) == MEDUSA_SUBJECT_TYPE_SIGNAL) {
-                        struct medusa_signal *signal;
-                        TAILQ_REMOVE(&monitor->deletes, subject, list);
-                        signal = (struct medusa_signal *) subject;
-                        if (subject->flags & MEDUSA_SUBJECT_FLAG_HEAP) {
-                                monitor->signal.backend->del(monitor->signal.backend, signal);
-                                subject->flags &= ~MEDUSA_SUBJECT_FLAG_HEAP;
-                        }
-                        medusa_signal_onevent_unlocked(signal, MEDUSA_SIGNAL_EVENT_DESTROY);
-                }
-        }
+        monitor_process_deletes(monitor, 1);
         if (monitor->poll.backend != NULL) {
                 monitor->poll.backend->destroy(monitor->poll.backend);
         }
@@ -1033,19 +1486,50 @@ __attribute__ ((visibility ("default"))) void medusa_monitor_destroy (struct med
         if (monitor->wakeup.fds[0] >= 0) {
                 close(monitor->wakeup.fds[0]);
         }
-        if (monitor->wakeup.fds[1] >= 0) {
+        if (monitor->wakeup.fds[1] >= 0 &&
+            monitor->wakeup.fds[1] != monitor->wakeup.fds[0]) {
                 close(monitor->wakeup.fds[1]);
         }
         if (monitor->timer.pqueue != NULL) {
-                pqueue_destroy(monitor->timer.pqueue);
+                pqueue4_destroy(monitor->timer.pqueue);
+        }
+        if (monitor->timer.wheel != NULL) {
+                wheel_destroy(monitor->timer.wheel);
         }
         medusa_monitor_unlock(monitor);
         if (monitor->flags & MEDUSA_MONITOR_FLAG_THREAD_SAFE) {
              pthread_mutex_destroy(&monitor->mutex);
         }
+        if (monitor->watchdog.stalls != NULL) {
+                free(monitor->watchdog.stalls);
+        }
         free(monitor);
 }
 
+__attribute__ ((visibility ("default"))) int medusa_monitor_now_unlocked (const struct medusa_monitor *monitor, struct timespec *now)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                return -EINVAL;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(now)) {
+                return -EINVAL;
+        }
+        *now = monitor->clock.now;
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_monitor_now (struct medusa_monitor *monitor, struct timespec *now)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(monitor);
+        rc = medusa_monitor_now_unlocked(monitor, now);
+        medusa_monitor_unlock(monitor);
+        return rc;
+}
+
 __attribute__ ((visibility ("default"))) int medusa_monitor_get_running (struct medusa_monitor *monitor)
 {
         int running;
@@ -1058,6 +1542,114 @@ __attribute__ ((visibility ("default"))) int medusa_monitor_get_running (struct
         return running;
 }
 
+__attribute__ ((visibility ("default"))) unsigned int medusa_monitor_get_busypoll_socket_unlocked (const struct medusa_monitor *monitor)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                return 0;
+        }
+        return monitor->busypoll.socket;
+}
+
+__attribute__ ((visibility ("default"))) unsigned long long medusa_monitor_get_elided (struct medusa_monitor *monitor)
+{
+        unsigned long long elided;
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                return 0;
+        }
+        medusa_monitor_lock(monitor);
+        elided = monitor->poll.elided;
+        medusa_monitor_unlock(monitor);
+        return elided;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_monitor_get_stats (struct medusa_monitor *monitor, struct medusa_monitor_stats *stats)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                return -EINVAL;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(stats)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(monitor);
+        memcpy(stats, &monitor->stats.counters, sizeof(struct medusa_monitor_stats));
+        stats->syscalls.elided = monitor->poll.elided;
+        stats->timers.count = pqueue4_count(monitor->timer.pqueue) + wheel_count(monitor->timer.wheel);
+        medusa_monitor_unlock(monitor);
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_monitor_drain_stalls (struct medusa_monitor *monitor, struct medusa_monitor_stall *stalls, unsigned int count)
+{
+        unsigned int i;
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                return -EINVAL;
+        }
+        if (stalls == NULL && count != 0) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(monitor);
+        for (i = 0; i < count && monitor->watchdog.count > 0; i++) {
+                stalls[i] = monitor->watchdog.stalls[monitor->watchdog.head];
+                monitor->watchdog.head = (monitor->watchdog.head + 1) % monitor->watchdog.size;
+                monitor->watchdog.count -= 1;
+        }
+        medusa_monitor_unlock(monitor);
+        return i;
+}
+
+__attribute__ ((visibility ("default"))) void medusa_monitor_dispatch_begin_unlocked (struct medusa_monitor *monitor, struct medusa_monitor_dispatch *dispatch, struct medusa_subject *subject, void (*onevent) (void))
+{
+        dispatch->subject = subject;
+        dispatch->type    = medusa_subject_get_type(subject);
+        dispatch->onevent = onevent;
+        medusa_timespec_clear(&dispatch->timespec);
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                return;
+        }
+        switch (dispatch->type) {
+                case MEDUSA_SUBJECT_TYPE_IO:            monitor->stats.counters.events.io += 1;          break;
+                case MEDUSA_SUBJECT_TYPE_TIMER:         monitor->stats.counters.events.timer += 1;       break;
+                case MEDUSA_SUBJECT_TYPE_SIGNAL:        monitor->stats.counters.events.signal += 1;      break;
+                case MEDUSA_SUBJECT_TYPE_TCPSOCKET:     monitor->stats.counters.events.tcpsocket += 1;   break;
+                case MEDUSA_SUBJECT_TYPE_HTTPREQUEST:   monitor->stats.counters.events.httprequest += 1; break;
+                case MEDUSA_SUBJECT_TYPE_EXEC:          monitor->stats.counters.events.exec += 1;        break;
+        }
+        if (monitor->stats.depth++ == 0 ||
+            monitor->watchdog.callback != 0) {
+                medusa_clock_fast(&dispatch->timespec);
+        }
+}
+
+__attribute__ ((visibility ("default"))) void medusa_monitor_dispatch_end_unlocked (struct medusa_monitor *monitor, struct medusa_monitor_dispatch *dispatch)
+{
+        struct timespec now;
+        struct timespec elapsed;
+        unsigned long long duration;
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                return;
+        }
+        if (monitor->stats.depth == 0) {
+                return;
+        }
+        monitor->stats.depth -= 1;
+        if (!medusa_timespec_isset(&dispatch->timespec)) {
+                return;
+        }
+        medusa_clock_fast(&now);
+        if (!medusa_timespec_compare(&now, &dispatch->timespec, >)) {
+                return;
+        }
+        medusa_timespec_sub(&now, &dispatch->timespec, &elapsed);
+        duration = monitor_timespec_nsec(&elapsed);
+        if (monitor->stats.depth == 0) {
+                monitor->stats.counters.time.callback += duration;
+        }
+        if (monitor->watchdog.callback != 0 &&
+            duration >= monitor->watchdog.callback) {
+                monitor_watchdog_record(monitor, MEDUSA_MONITOR_STALL_TYPE_CALLBACK, dispatch, duration);
+        }
+}
+
 __attribute__ ((visibility ("default"))) int medusa_monitor_break (struct medusa_monitor *monitor)
 {
         int rc;
@@ -1085,8 +1677,15 @@ __attribute__ ((visibility ("default"))) int medusa_monitor_continue (struct med
 __attribute__ ((visibility ("default"))) int medusa_monitor_run_timeout (struct medusa_monitor *monitor, double timeout)
 {
         int rc;
+        unsigned long long waits;
+        unsigned long long polled;
+        unsigned long long callback;
         struct timespec *timespec;
         struct timespec _timespec;
+        struct timespec _ptimespec;
+        struct timespec start;
+        struct timespec finish;
+        struct timespec elapsed;
 
         if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
                 return -EINVAL;
@@ -1102,7 +1701,13 @@ __attribute__ ((visibility ("default"))) int medusa_monitor_run_timeout (struct
 
         medusa_monitor_lock(monitor);
 
-        rc = monitor_process_deletes(monitor);
+        monitor->stats.counters.iterations += 1;
+
+        rc = monitor_process_deletes(monitor, 0);
+        if (rc < 0) {
+                goto bail;
+        }
+        rc = monitor_clock_refresh(monitor);
         if (rc < 0) {
                 goto bail;
         }
@@ -1114,16 +1719,49 @@ __attribute__ ((visibility ("default"))) int medusa_monitor_run_timeout (struct
         if (rc < 0) {
                 goto bail;
         }
+        timespec = monitor_poll_timeout(monitor, timespec, &_ptimespec);
+
+        monitor->wakeup.thread = pthread_self();
+        __atomic_store_n(&monitor->wakeup.polling, 1, __ATOMIC_RELEASE);
+
+        callback = monitor->stats.counters.time.callback;
 
         medusa_monitor_unlock(monitor);
 
-        rc = monitor->poll.backend->run(monitor->poll.backend, timespec);
+        waits = 0;
+        medusa_clock_fast(&start);
+        rc = monitor_poll_run(monitor, timespec, &waits);
+        medusa_clock_fast(&finish);
 
         medusa_monitor_lock(monitor);
 
+        __atomic_store_n(&monitor->wakeup.polling, 0, __ATOMIC_RELEASE);
+
+        if (monitor->watchdog.lag != 0 &&
+            monitor->watchdog.resumed != 0 &&
+            monitor_timespec_nsec(&start) > monitor->watchdog.resumed &&
+            monitor_timespec_nsec(&start) - monitor->watchdog.resumed >= monitor->watchdog.lag) {
+                monitor_watchdog_record(monitor, MEDUSA_MONITOR_STALL_TYPE_LAG, NULL, monitor_timespec_nsec(&start) - monitor->watchdog.resumed);
+        }
+        monitor->stats.counters.syscalls.wait += waits;
+        callback = monitor->stats.counters.time.callback - callback;
+        if (medusa_timespec_compare(&finish, &start, >)) {
+                medusa_timespec_sub(&finish, &start, &elapsed);
+                polled = monitor_timespec_nsec(&elapsed);
+                if (polled > callback) {
+                        monitor->stats.counters.time.poll += polled - callback;
+                }
+        }
+        monitor->watchdog.resumed = monitor_timespec_nsec(&finish) - callback;
+
+        if (rc < 0) {
+                goto bail;
+        }
+        rc = monitor_clock_update(monitor);
         if (rc < 0) {
                 goto bail;
         }
+        monitor->clock.updated = monitor_timespec_nsec(&finish);
         rc = monitor_check_timer(monitor);
         if (rc < 0) {
                 goto bail;
@@ -2,6 +2,7 @@
 #if !defined(MEDUSA_MONITOR_H)
 #define MEDUSA_MONITOR_H
 
+struct timespec;
 struct medusa_monitor;
 
 enum {
@@ -9,19 +10,23 @@ enum {
         MEDUSA_MONITOR_POLL_EPOLL,
         MEDUSA_MONITOR_POLL_KQUEUE,
         MEDUSA_MONITOR_POLL_POLL,
-        MEDUSA_MONITOR_POLL_SELECT
+        MEDUSA_MONITOR_POLL_SELECT,
+        MEDUSA_MONITOR_POLL_IO_URING
 #define MEDUSA_MONITOR_POLL_DEFAULT     MEDUSA_MONITOR_POLL_DEFAULT
 #define MEDUSA_MONITOR_POLL_EPOLL       MEDUSA_MONITOR_POLL_EPOLL
 #define MEDUSA_MONITOR_POLL_KQUEUE      MEDUSA_MONITOR_POLL_KQUEUE
 #define MEDUSA_MONITOR_POLL_POLL        MEDUSA_MONITOR_POLL_POLL
 #define MEDUSA_MONITOR_POLL_SELECT      MEDUSA_MONITOR_POLL_SELECT
+#define MEDUSA_MONITOR_POLL_IO_URING    MEDUSA_MONITOR_POLL_IO_URING
 };
 
 enum {
         MEDUSA_MONITOR_TIMER_DEFAULT,
-        MEDUSA_MONITOR_TIMER_TIMERFD
+        MEDUSA_MONITOR_TIMER_TIMERFD,
+        MEDUSA_MONITOR_TIMER_POLL
 #define MEDUSA_MONITOR_TIMER_DEFAULT    MEDUSA_MONITOR_TIMER_DEFAULT
 #define MEDUSA_MONITOR_TIMER_TIMERFD    MEDUSA_MONITOR_TIMER_TIMERFD
+#define MEDUSA_MONITOR_TIMER_POLL       MEDUSA_MONITOR_TIMER_POLL
 };
 
 enum {
@@ -32,12 +37,16 @@ enum {
 };
 
 enum {
-        MEDUSA_MONITOR_FLAG_NONE        = 0x00000000,
-        MEDUSA_MONITOR_FLAG_THREAD_SAFE = 0x00000001,
-        MEDUSA_MONITOR_FLAG_DEFAULT     = MEDUSA_MONITOR_FLAG_THREAD_SAFE
-#define MEDUSA_MONITOR_FLAG_NONE        MEDUSA_MONITOR_FLAG_NONE
-#define MEDUSA_MONITOR_FLAG_THREAD_SAFE MEDUSA_MONITOR_FLAG_THREAD_SAFE
-#define MEDUSA_MONITOR_FLAG_DEFAULT     MEDUSA_MONITOR_FLAG_DEFAULT
+        MEDUSA_MONITOR_FLAG_NONE         = 0x00000000,
+        MEDUSA_MONITOR_FLAG_THREAD_SAFE  = 0x00000001,
+        MEDUSA_MONITOR_FLAG_TIMER_WHEEL  = 0x00000002,
+        MEDUSA_MONITOR_FLAG_CLOCK_COARSE = 0x00000004,
+        MEDUSA_MONITOR_FLAG_DEFAULT      = MEDUSA_MONITOR_FLAG_THREAD_SAFE
+#define MEDUSA_MONITOR_FLAG_NONE         MEDUSA_MONITOR_FLAG_NONE
+#define MEDUSA_MONITOR_FLAG_THREAD_SAFE  MEDUSA_MONITOR_FLAG_THREAD_SAFE
+#define MEDUSA_MONITOR_FLAG_TIMER_WHEEL  MEDUSA_MONITOR_FLAG_TIMER_WHEEL
+#define MEDUSA_MONITOR_FLAG_CLOCK_COARSE MEDUSA_MONITOR_FLAG_CLOCK_COARSE
+#define MEDUSA_MONITOR_FLAG_DEFAULT      MEDUSA_MONITOR_FLAG_DEFAULT
 };
 
 struct medusa_monitor_init_options {
@@ -57,6 +66,9 @@ struct medusa_monitor_init_options {
                         struct {
 
                         } select;
+                        struct {
+
+                        } io_uring;
                 } u;
         } poll;
         struct {
@@ -75,6 +87,70 @@ struct medusa_monitor_init_options {
                         } signalfd;
                 } u;
         } signal;
+        struct {
+                unsigned int timeout;
+                unsigned int iterations;
+                unsigned int socket;
+        } busypoll;
+        struct {
+                unsigned int lag;
+                unsigned int callback;
+                unsigned int size;
+        } watchdog;
+};
+
+enum {
+        MEDUSA_MONITOR_STALL_TYPE_LAG           = 0,
+        MEDUSA_MONITOR_STALL_TYPE_CALLBACK      = 1
+#define MEDUSA_MONITOR_STALL_TYPE_LAG           MEDUSA_MONITOR_STALL_TYPE_LAG
+#define MEDUSA_MONITOR_STALL_TYPE_CALLBACK      MEDUSA_MONITOR_STALL_TYPE_CALLBACK
+};
+
+struct medusa_monitor_stall {
+        unsigned int type;
+        const char *name;
+        const void *subject;
+        void (*onevent) (void);
+        unsigned long long duration;
+};
+
+struct medusa_monitor_stats {
+        unsigned long long iterations;
+        struct {
+                unsigned long long io;
+                unsigned long long timer;
+                unsigned long long signal;
+                unsigned long long tcpsocket;
+                unsigned long long httprequest;
+                unsigned long long exec;
+        } events;
+        struct {
+                unsigned long long poll;
+                unsigned long long callback;
+        } time;
+        struct {
+                unsigned int actives;
+                unsigned int changes;
+                unsigned int deletes;
+                unsigned int rogues;
+        } subjects;
+        struct {
+                unsigned int count;
+                unsigned long long fired;
+        } timers;
+        struct {
+                unsigned long long add;
+                unsigned long long mod;
+                unsigned long long del;
+                unsigned long long wait;
+                unsigned long long elided;
+                unsigned long long timer;
+                unsigned long long wakeup;
+        } syscalls;
+        struct {
+                unsigned long long stalls;
+                unsigned long long dropped;
+        } watchdog;
 };
 
 #ifdef __cplusplus
@@ -92,6 +168,10 @@ int medusa_monitor_run_once (struct medusa_monitor *monitor);
 int medusa_monitor_run_timeout (struct medusa_monitor *monitor, double timeout);
 
 int medusa_monitor_get_running (struct medusa_monitor *monitor);
+int medusa_monitor_now (struct medusa_monitor *monitor, struct timespec *now);
+unsigned long long medusa_monitor_get_elided (struct medusa_monitor *monitor);
+int medusa_monitor_get_stats (struct medusa_monitor *monitor, struct medusa_monitor_stats *stats);
+int medusa_monitor_drain_stalls (struct medusa_monitor *monitor, struct medusa_monitor_stall *stalls, unsigned int count);
 
 int medusa_monitor_break (struct medusa_monitor *monitor);
 int medusa_monitor_continue (struct medusa_monitor *monitor);
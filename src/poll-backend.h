@@ -7,8 +7,16 @@ struct medusa_monitor;
 struct medusa_io;
 struct medusa_timespec;
 
+enum {
+        MEDUSA_POLL_BACKEND_FLAG_NONE           = 0x00000000,
+        MEDUSA_POLL_BACKEND_FLAG_PRECISE        = 0x00000001
+#define MEDUSA_POLL_BACKEND_FLAG_NONE           MEDUSA_POLL_BACKEND_FLAG_NONE
+#define MEDUSA_POLL_BACKEND_FLAG_PRECISE        MEDUSA_POLL_BACKEND_FLAG_PRECISE
+};
+
 struct medusa_poll_backend {
         const char *name;
+        unsigned int flags;
         int (*add) (struct medusa_poll_backend *backend, struct medusa_io *io);
         int (*mod) (struct medusa_poll_backend *backend, struct medusa_io *io);
         int (*del) (struct medusa_poll_backend *backend, struct medusa_io *io);
@@ -6,6 +6,7 @@
 #include <errno.h>
 
 #include <sys/epoll.h>
+#include <sys/syscall.h>
 
 #include "queue.h"
 #include "subject-struct.h"
@@ -23,10 +24,23 @@
 struct internal {
         struct medusa_poll_backend backend;
         int fd;
+        int pwait2;
         int maxevents;
         struct epoll_event *events;
 };
 
+static int internal_epoll_pwait2 (struct internal *internal, struct timespec *timespec)
+{
+#if defined(__NR_epoll_pwait2)
+        return syscall(__NR_epoll_pwait2, internal->fd, internal->events, internal->maxevents, timespec, NULL, 0);
+#else
+        (void) internal;
+        (void) timespec;
+        errno = ENOSYS;
+        return -1;
+#endif
+}
+
 static int internal_add (struct medusa_poll_backend *backend, struct medusa_io *io)
 {
         int rc;
@@ -56,6 +70,9 @@ static int internal_add (struct medusa_poll_backend *backend, struct medusa_io *
         if (events & MEDUSA_IO_EVENT_PRI) {
                 ev.events |= EPOLLPRI;
         }
+        if (medusa_io_get_edgetriggered_unlocked(io) > 0) {
+                ev.events |= EPOLLET;
+        }
         ev.data.ptr = io;
         rc = epoll_ctl(internal->fd, EPOLL_CTL_ADD, io->fd, &ev);
         if (rc < 0) {
@@ -94,6 +111,9 @@ static int internal_mod (struct medusa_poll_backend *backend, struct medusa_io *
         if (events & MEDUSA_IO_EVENT_PRI) {
                 ev.events |= EPOLLPRI;
         }
+        if (medusa_io_get_edgetriggered_unlocked(io) > 0) {
+                ev.events |= EPOLLET;
+        }
         ev.data.ptr = io;
         rc = epoll_ctl(internal->fd, EPOLL_CTL_MOD, io->fd, &ev);
         if (rc < 0) {
@@ -140,12 +160,22 @@ static int internal_run (struct medusa_poll_backend *backend, struct timespec *t
         if (internal == NULL) {
                 goto bail;
         }
-        if (timespec == NULL) {
-                timeout = -1;
-        } else {
-                timeout = timespec->tv_sec * 1000 + timespec->tv_nsec / 1000000;
+        count = -1;
+        if (internal->pwait2) {
+                count = internal_epoll_pwait2(internal, timespec);
+                if (count < 0 && errno == ENOSYS) {
+                        internal->pwait2 = 0;
+                        internal->backend.flags &= ~MEDUSA_POLL_BACKEND_FLAG_PRECISE;
+                }
+        }
+        if (!internal->pwait2) {
+                if (timespec == NULL) {
+                        timeout = -1;
+                } else {
+                        timeout = timespec->tv_sec * 1000 + (timespec->tv_nsec + 999999) / 1000000;
+                }
+                count = epoll_wait(internal->fd, internal->events, internal->maxevents, timeout);
         }
-        count = epoll_wait(internal->fd, internal->events, internal->maxevents, timeout);
         if (count == 0) {
                 goto out;
         }
@@ -229,7 +259,14 @@ struct medusa_poll_backend * medusa_monitor_epoll_create (const struct medusa_mo
         if (internal->events == NULL) {
                 goto bail;
         }
+        {
+                struct timespec timespec;
+                timespec.tv_sec  = 0;
+                timespec.tv_nsec = 0;
+                internal->pwait2 = (internal_epoll_pwait2(internal, &timespec) >= 0);
+        }
         internal->backend.name    = "epoll";
+        internal->backend.flags   = (internal->pwait2) ? MEDUSA_POLL_BACKEND_FLAG_PRECISE : MEDUSA_POLL_BACKEND_FLAG_NONE;
         internal->backend.add     = internal_add;
         internal->backend.mod     = internal_mod;
         internal->backend.del     = internal_del;
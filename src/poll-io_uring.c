@@ -0,0 +1,549 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "queue.h"
+#include "subject-struct.h"
+#include "io.h"
+#include "io-private.h"
+#include "io-struct.h"
+
+#include "poll-backend.h"
+#include "poll-io_uring.h"
+
+#define MAX(a, b)       (((a) > (b)) ? (a) : (b))
+
+#define RING_ENTRIES    (256)
+#define ENTRIES_STEP    (64)
+
+#define USER_DATA(fd, generation)       ((((uint64_t) (generation)) << 32) | ((uint32_t) (fd)))
+#define USER_DATA_FD(data)              ((int) ((data) & 0xffffffff))
+#define USER_DATA_GENERATION(data)      ((unsigned int) ((data) >> 32))
+
+struct entry {
+        struct medusa_io *io;
+        unsigned int generation;
+        unsigned int armed;
+        unsigned int events;
+        unsigned int multishot;
+};
+
+struct internal {
+        struct medusa_poll_backend backend;
+        int fd;
+        unsigned int features;
+        struct {
+                void *ring;
+                size_t ring_size;
+                unsigned int *head;
+                unsigned int *tail;
+                unsigned int *mask;
+                unsigned int *array;
+                unsigned int entries;
+                struct io_uring_sqe *sqes;
+                size_t sqes_size;
+        } sq;
+        struct {
+                void *ring;
+                size_t ring_size;
+                unsigned int *head;
+                unsigned int *tail;
+                unsigned int *mask;
+                struct io_uring_cqe *cqes;
+        } cq;
+        struct entry *entries;
+        int nentries;
+        unsigned int generation;
+        pthread_mutex_t mutex;
+};
+
+static int sys_io_uring_setup (unsigned int entries, struct io_uring_params *params)
+{
+        return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter (int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags, void *arg, size_t argsz)
+{
+        return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static unsigned int internal_sq_pending (struct internal *internal)
+{
+        return *internal->sq.tail - __atomic_load_n(internal->sq.head, __ATOMIC_ACQUIRE);
+}
+
+static int internal_sq_flush (struct internal *internal)
+{
+        int rc;
+        unsigned int pending;
+        pending = internal_sq_pending(internal);
+        if (pending == 0) {
+                return 0;
+        }
+        rc = sys_io_uring_enter(internal->fd, pending, 0, 0, NULL, 0);
+        if (rc < 0) {
+                return -errno;
+        }
+        return rc;
+}
+
+static struct io_uring_sqe * internal_sq_get (struct internal *internal)
+{
+        int rc;
+        unsigned int tail;
+        struct io_uring_sqe *sqe;
+        if (internal_sq_pending(internal) >= internal->sq.entries) {
+                rc = internal_sq_flush(internal);
+                if (rc < 0) {
+                        return NULL;
+                }
+                if (internal_sq_pending(internal) >= internal->sq.entries) {
+                        return NULL;
+                }
+        }
+        tail = *internal->sq.tail;
+        sqe = &internal->sq.sqes[tail & *internal->sq.mask];
+        memset(sqe, 0, sizeof(struct io_uring_sqe));
+        internal->sq.array[tail & *internal->sq.mask] = tail & *internal->sq.mask;
+        return sqe;
+}
+
+static void internal_sq_put (struct internal *internal)
+{
+        __atomic_store_n(internal->sq.tail, *internal->sq.tail + 1, __ATOMIC_RELEASE);
+}
+
+static int internal_arm (struct internal *internal, int fd)
+{
+        struct entry *entry;
+        struct io_uring_sqe *sqe;
+        entry = &internal->entries[fd];
+        sqe = internal_sq_get(internal);
+        if (sqe == NULL) {
+                return -EBUSY;
+        }
+        sqe->opcode        = IORING_OP_POLL_ADD;
+        sqe->fd            = fd;
+        sqe->poll32_events = entry->events;
+        sqe->len           = (entry->multishot) ? IORING_POLL_ADD_MULTI : 0;
+        sqe->user_data     = USER_DATA(fd, entry->generation);
+        internal_sq_put(internal);
+        entry->armed = 1;
+        return 0;
+}
+
+static int internal_disarm (struct internal *internal, int fd)
+{
+        struct entry *entry;
+        struct io_uring_sqe *sqe;
+        entry = &internal->entries[fd];
+        if (entry->armed == 0) {
+                return 0;
+        }
+        sqe = internal_sq_get(internal);
+        if (sqe == NULL) {
+                return -EBUSY;
+        }
+        sqe->opcode    = IORING_OP_POLL_REMOVE;
+        sqe->fd        = -1;
+        sqe->addr      = USER_DATA(fd, entry->generation);
+        sqe->user_data = 0;
+        internal_sq_put(internal);
+        entry->armed = 0;
+        return 0;
+}
+
+static unsigned int internal_next_generation (struct internal *internal)
+{
+        internal->generation += 1;
+        if (internal->generation == 0) {
+                internal->generation = 1;
+        }
+        return internal->generation;
+}
+
+static unsigned int internal_poll_events (struct medusa_io *io)
+{
+        unsigned int events;
+        unsigned int pevents;
+        events = medusa_io_get_events_unlocked(io);
+        pevents = 0;
+        if (events & MEDUSA_IO_EVENT_IN) {
+                pevents |= POLLIN;
+        }
+        if (events & MEDUSA_IO_EVENT_OUT) {
+                pevents |= POLLOUT;
+        }
+        if (events & MEDUSA_IO_EVENT_PRI) {
+                pevents |= POLLPRI;
+        }
+        return pevents;
+}
+
+static int internal_add (struct medusa_poll_backend *backend, struct medusa_io *io)
+{
+        int rc;
+        unsigned int events;
+        struct entry *entry;
+        struct internal *internal = (struct internal *) backend;
+        if (internal == NULL) {
+                goto bail;
+        }
+        if (io == NULL) {
+                goto bail;
+        }
+        if (io->fd < 0) {
+                return -EBADF;
+        }
+        events = internal_poll_events(io);
+        if (events == 0) {
+                goto bail;
+        }
+        pthread_mutex_lock(&internal->mutex);
+        if (io->fd + 1 > internal->nentries) {
+                struct entry *tmp;
+                int nentries;
+                nentries = MAX(io->fd + 1, internal->nentries + ENTRIES_STEP);
+                tmp = (struct entry *) realloc(internal->entries, sizeof(struct entry) * nentries);
+                if (tmp == NULL) {
+                        pthread_mutex_unlock(&internal->mutex);
+                        return -ENOMEM;
+                }
+                memset(tmp + internal->nentries, 0, sizeof(struct entry) * (nentries - internal->nentries));
+                internal->entries = tmp;
+                internal->nentries = nentries;
+        }
+        entry = &internal->entries[io->fd];
+        if (entry->io != NULL) {
+                pthread_mutex_unlock(&internal->mutex);
+                return -EEXIST;
+        }
+        entry->io         = io;
+        entry->events     = events;
+        entry->multishot  = (medusa_io_get_edgetriggered_unlocked(io) > 0);
+        entry->generation = internal_next_generation(internal);
+        entry->armed      = 0;
+        rc = internal_arm(internal, io->fd);
+        if (rc < 0) {
+                entry->io = NULL;
+                pthread_mutex_unlock(&internal->mutex);
+                return rc;
+        }
+        pthread_mutex_unlock(&internal->mutex);
+        return 0;
+bail:   return -1;
+}
+
+static int internal_mod (struct medusa_poll_backend *backend, struct medusa_io *io)
+{
+        int rc;
+        unsigned int events;
+        struct entry *entry;
+        struct internal *internal = (struct internal *) backend;
+        if (internal == NULL) {
+                goto bail;
+        }
+        if (io == NULL) {
+                goto bail;
+        }
+        if (io->fd < 0) {
+                return -EBADF;
+        }
+        events = internal_poll_events(io);
+        if (events == 0) {
+                goto bail;
+        }
+        pthread_mutex_lock(&internal->mutex);
+        if (io->fd >= internal->nentries ||
+            internal->entries[io->fd].io != io) {
+                pthread_mutex_unlock(&internal->mutex);
+                return -ENOENT;
+        }
+        entry = &internal->entries[io->fd];
+        rc = internal_disarm(internal, io->fd);
+        if (rc < 0) {
+                pthread_mutex_unlock(&internal->mutex);
+                return rc;
+        }
+        entry->events     = events;
+        entry->multishot  = (medusa_io_get_edgetriggered_unlocked(io) > 0);
+        entry->generation = internal_next_generation(internal);
+        rc = internal_arm(internal, io->fd);
+        if (rc < 0) {
+                pthread_mutex_unlock(&internal->mutex);
+                return rc;
+        }
+        pthread_mutex_unlock(&internal->mutex);
+        return 0;
+bail:   return -1;
+}
+
+static int internal_del (struct medusa_poll_backend *backend, struct medusa_io *io)
+{
+        int rc;
+        struct entry *entry;
+        struct internal *internal = (struct internal *) backend;
+        if (internal == NULL) {
+                goto bail;
+        }
+        if (io == NULL) {
+                goto bail;
+        }
+        if (io->fd < 0) {
+                return -EBADF;
+        }
+        pthread_mutex_lock(&internal->mutex);
+        if (io->fd >= internal->nentries ||
+            internal->entries[io->fd].io != io) {
+                pthread_mutex_unlock(&internal->mutex);
+                return -ENOENT;
+        }
+        entry = &internal->entries[io->fd];
+        rc = internal_disarm(internal, io->fd);
+        if (rc < 0) {
+                pthread_mutex_unlock(&internal->mutex);
+                return rc;
+        }
+        entry->io         = NULL;
+        entry->events     = 0;
+        entry->generation = 0;
+        pthread_mutex_unlock(&internal->mutex);
+        return 0;
+bail:   return -1;
+}
+
+static int internal_run (struct medusa_poll_backend *backend, struct timespec *timespec)
+{
+        int fd;
+        int rc;
+        int count;
+        unsigned int head;
+        unsigned int flags;
+        unsigned int events;
+        unsigned int pending;
+        unsigned int generation;
+        struct entry *entry;
+        struct medusa_io *io;
+        struct io_uring_cqe cqe;
+        struct io_uring_getevents_arg arg;
+        struct __kernel_timespec ts;
+        struct internal *internal = (struct internal *) backend;
+        if (internal == NULL) {
+                goto bail;
+        }
+        pthread_mutex_lock(&internal->mutex);
+        pending = internal_sq_pending(internal);
+        pthread_mutex_unlock(&internal->mutex);
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        memset(&arg, 0, sizeof(struct io_uring_getevents_arg));
+        if (timespec != NULL) {
+                ts.tv_sec  = timespec->tv_sec;
+                ts.tv_nsec = timespec->tv_nsec;
+                arg.ts = (uint64_t) (uintptr_t) &ts;
+        }
+        rc = sys_io_uring_enter(internal->fd, pending, 1, flags, &arg, sizeof(struct io_uring_getevents_arg));
+        if (rc < 0) {
+                if (errno == EINTR) {
+                        return 0;
+                }
+                if (errno != ETIME &&
+                    errno != EBUSY &&
+                    errno != EAGAIN) {
+                        return -errno;
+                }
+        }
+        count = 0;
+        pthread_mutex_lock(&internal->mutex);
+        while (1) {
+                head = *internal->cq.head;
+                if (head == __atomic_load_n(internal->cq.tail, __ATOMIC_ACQUIRE)) {
+                        break;
+                }
+                cqe = internal->cq.cqes[head & *internal->cq.mask];
+                __atomic_store_n(internal->cq.head, head + 1, __ATOMIC_RELEASE);
+                if (cqe.user_data == 0) {
+                        continue;
+                }
+                fd = USER_DATA_FD(cqe.user_data);
+                generation = USER_DATA_GENERATION(cqe.user_data);
+                if (fd < 0 || fd >= internal->nentries) {
+                        continue;
+                }
+                entry = &internal->entries[fd];
+                if (entry->io == NULL ||
+                    entry->generation != generation) {
+                        continue;
+                }
+                if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                        entry->armed = 0;
+                }
+                if (cqe.res == -ECANCELED) {
+                        continue;
+                }
+                events = 0;
+                if (cqe.res < 0) {
+                        events |= MEDUSA_IO_EVENT_ERR;
+                } else {
+                        if (cqe.res & POLLIN) {
+                                events |= MEDUSA_IO_EVENT_IN;
+                        }
+                        if (cqe.res & POLLOUT) {
+                                events |= MEDUSA_IO_EVENT_OUT;
+                        }
+                        if (cqe.res & POLLPRI) {
+                                events |= MEDUSA_IO_EVENT_PRI;
+                        }
+                        if (cqe.res & POLLHUP) {
+                                events |= MEDUSA_IO_EVENT_HUP;
+                        }
+                        if (cqe.res & (POLLERR | POLLNVAL)) {
+                                events |= MEDUSA_IO_EVENT_ERR;
+                        }
+                }
+                io = entry->io;
+                pthread_mutex_unlock(&internal->mutex);
+                rc = medusa_io_onevent(io, events);
+                pthread_mutex_lock(&internal->mutex);
+                if (rc < 0) {
+                        pthread_mutex_unlock(&internal->mutex);
+                        return rc;
+                }
+                count += 1;
+                entry = &internal->entries[fd];
+                if (entry->io != NULL &&
+                    entry->generation == generation &&
+                    entry->armed == 0) {
+                        rc = internal_arm(internal, fd);
+                        if (rc < 0) {
+                                pthread_mutex_unlock(&internal->mutex);
+                                return rc;
+                        }
+                }
+        }
+        pthread_mutex_unlock(&internal->mutex);
+        return count;
+bail:   return -1;
+}
+
+static void internal_destroy (struct medusa_poll_backend *backend)
+{
+        int fd;
+        unsigned int pending;
+        struct internal *internal = (struct internal *) backend;
+        if (internal == NULL) {
+                return;
+        }
+        if (internal->fd >= 0 &&
+            internal->sq.sqes != NULL &&
+            internal->sq.sqes != MAP_FAILED) {
+                for (fd = 0; fd < internal->nentries; fd++) {
+                        if (internal->entries[fd].io != NULL) {
+                                internal_disarm(internal, fd);
+                        }
+                }
+                pending = internal_sq_pending(internal);
+                if (pending > 0) {
+                        sys_io_uring_enter(internal->fd, pending, pending, IORING_ENTER_GETEVENTS, NULL, 0);
+                }
+        }
+        if (internal->sq.sqes != NULL &&
+            internal->sq.sqes != MAP_FAILED) {
+                munmap(internal->sq.sqes, internal->sq.sqes_size);
+        }
+        if (internal->cq.ring != NULL &&
+            internal->cq.ring != MAP_FAILED &&
+            internal->cq.ring != internal->sq.ring) {
+                munmap(internal->cq.ring, internal->cq.ring_size);
+        }
+        if (internal->sq.ring != NULL &&
+            internal->sq.ring != MAP_FAILED) {
+                munmap(internal->sq.ring, internal->sq.ring_size);
+        }
+        if (internal->fd >= 0) {
+                close(internal->fd);
+        }
+        if (internal->entries != NULL) {
+                free(internal->entries);
+        }
+        pthread_mutex_destroy(&internal->mutex);
+        free(internal);
+}
+
+struct medusa_poll_backend * medusa_monitor_io_uring_create (const struct medusa_monitor_io_uring_init_options *options)
+{
+        struct internal *internal;
+        struct io_uring_params params;
+        (void) options;
+        internal = (struct internal *) malloc(sizeof(struct internal));
+        if (internal == NULL) {
+                goto bail;
+        }
+        memset(internal, 0, sizeof(struct internal));
+        internal->fd = -1;
+        pthread_mutex_init(&internal->mutex, NULL);
+        memset(&params, 0, sizeof(struct io_uring_params));
+        params.flags      = IORING_SETUP_CQSIZE;
+        params.cq_entries = RING_ENTRIES * 4;
+        internal->fd = sys_io_uring_setup(RING_ENTRIES, &params);
+        if (internal->fd < 0) {
+                goto bail;
+        }
+        internal->features = params.features;
+        if (!(internal->features & IORING_FEAT_EXT_ARG)) {
+                goto bail;
+        }
+        internal->sq.ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        internal->cq.ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (internal->features & IORING_FEAT_SINGLE_MMAP) {
+                internal->sq.ring_size = MAX(internal->sq.ring_size, internal->cq.ring_size);
+                internal->cq.ring_size = internal->sq.ring_size;
+        }
+        internal->sq.ring = mmap(NULL, internal->sq.ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, internal->fd, IORING_OFF_SQ_RING);
+        if (internal->sq.ring == MAP_FAILED) {
+                goto bail;
+        }
+        if (internal->features & IORING_FEAT_SINGLE_MMAP) {
+                internal->cq.ring = internal->sq.ring;
+        } else {
+                internal->cq.ring = mmap(NULL, internal->cq.ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, internal->fd, IORING_OFF_CQ_RING);
+                if (internal->cq.ring == MAP_FAILED) {
+                        goto bail;
+                }
+        }
+        internal->sq.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        internal->sq.sqes = mmap(NULL, internal->sq.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, internal->fd, IORING_OFF_SQES);
+        if (internal->sq.sqes == MAP_FAILED) {
+                goto bail;
+        }
+        internal->sq.head    = (unsigned int *) ((char *) internal->sq.ring + params.sq_off.head);
+        internal->sq.tail    = (unsigned int *) ((char *) internal->sq.ring + params.sq_off.tail);
+        internal->sq.mask    = (unsigned int *) ((char *) internal->sq.ring + params.sq_off.ring_mask);
+        internal->sq.array   = (unsigned int *) ((char *) internal->sq.ring + params.sq_off.array);
+        internal->sq.entries = params.sq_entries;
+        internal->cq.head    = (unsigned int *) ((char *) internal->cq.ring + params.cq_off.head);
+        internal->cq.tail    = (unsigned int *) ((char *) internal->cq.ring + params.cq_off.tail);
+        internal->cq.mask    = (unsigned int *) ((char *) internal->cq.ring + params.cq_off.ring_mask);
+        internal->cq.cqes    = (struct io_uring_cqe *) ((char *) internal->cq.ring + params.cq_off.cqes);
+        internal->backend.name    = "io_uring";
+        internal->backend.flags   = MEDUSA_POLL_BACKEND_FLAG_PRECISE;
+        internal->backend.add     = internal_add;
+        internal->backend.mod     = internal_mod;
+        internal->backend.del     = internal_del;
+        internal->backend.run     = internal_run;
+        internal->backend.destroy = internal_destroy;
+        return &internal->backend;
+bail:   if (internal != NULL) {
+                internal_destroy(&internal->backend);
+        }
+        return NULL;
+}
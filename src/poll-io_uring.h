@@ -0,0 +1,11 @@
+
+#if !defined(MEDUSA_POLL_IO_URING_H)
+#define MEDUSA_POLL_IO_URING_H
+
+struct medusa_monitor_io_uring_init_options {
+
+};
+
+struct medusa_poll_backend * medusa_monitor_io_uring_create (const struct medusa_monitor_io_uring_init_options *options);
+
+#endif
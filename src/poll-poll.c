@@ -175,7 +175,7 @@ static int internal_run (struct medusa_poll_backend *backend, struct timespec *t
         if (timespec == NULL) {
                 timeout = -1;
         } else {
-                timeout = timespec->tv_sec * 1000 + timespec->tv_nsec / 1000000;
+                timeout = timespec->tv_sec * 1000 + (timespec->tv_nsec + 999999) / 1000000;
         }
         for (i = 0; i < internal->npfds; i++) {
                 internal->pfds[i].revents = 0;
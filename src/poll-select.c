@@ -150,7 +150,11 @@ static int internal_run (struct medusa_poll_backend *backend, struct timespec *t
         if (timespec != NULL) {
                 timeval = &_timeval;
                 _timeval.tv_sec = timespec->tv_sec;
-                _timeval.tv_usec = timespec->tv_nsec / 1000;
+                _timeval.tv_usec = (timespec->tv_nsec + 999) / 1000;
+                if (_timeval.tv_usec >= 1000000) {
+                        _timeval.tv_sec += 1;
+                        _timeval.tv_usec -= 1000000;
+                }
         } else {
                 timeval = NULL;
         }
@@ -218,6 +222,7 @@ struct medusa_poll_backend * medusa_monitor_select_create (const struct medusa_m
         }
         memset(internal, 0, sizeof(struct internal));
         internal->backend.name    = "select";
+        internal->backend.flags   = MEDUSA_POLL_BACKEND_FLAG_PRECISE;
         internal->backend.add     = internal_add;
         internal->backend.mod     = internal_mod;
         internal->backend.del     = internal_del;
@@ -3,18 +3,84 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
 
 #include <pthread.h>
+#include <sys/mman.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
 
 #include "queue.h"
+#include "clock.h"
 #include "pool.h"
 
+/*
+ * thread safe pools keep a small per thread magazine of entries in front of
+ * the block lists, so most allocations and frees do not take the pool mutex.
+ * an entry freed by a thread other than the one that allocated it is pushed
+ * onto the remote list of the owning magazine, which is drained by the owner
+ * once its magazine runs empty. magazines of exited threads are inactive,
+ * frees to them go straight to the block lists. remote lists are also
+ * drained when a magazine is adopted and whenever the pool is trimmed, so
+ * entries parked on an idle owner are not pinned. the bulk calls bypass the
+ * magazines and move whole runs between the caller and the block lists
+ * under one lock.
+ */
+
+#define MEDUSA_POOL_CACHE_SIZE          32
+#define MEDUSA_POOL_CACHE_BATCH         (MEDUSA_POOL_CACHE_SIZE / 2)
+
+/*
+ * with MEDUSA_POOL_FLAG_RESERVE_HEURISTIC free blocks are kept while usage
+ * is above half of the capacity, and released only after usage stayed below
+ * the moving average for the trim period, so short dips do not thrash. the
+ * average is sampled a few times per trim period, and checked on every get
+ * and put while free blocks are held, so a pool that goes idle after a spike
+ * shrinks on its next call instead of waiting for a block to empty again.
+ */
+
+#define MEDUSA_POOL_TRIM_PERIOD         1000000000ULL
+#define MEDUSA_POOL_TRIM_SAMPLES        4
+#define MEDUSA_POOL_TRIM_SAMPLES_MAX    64
+
+/*
+ * mmap backed blocks are sized to whole pages, or to whole huge pages with
+ * MEDUSA_POOL_FLAG_HUGETLB. when no huge page is reserved the block falls
+ * back to normal pages with transparent huge page advice. a numa node set
+ * with medusa_pool_set_numa_node is applied as a preferred policy before
+ * the block is first touched.
+ */
+
+#define MEDUSA_POOL_HUGEPAGE_SIZE       (2 * 1024 * 1024)
+#define MEDUSA_POOL_NUMA_NODES          256
+#define MEDUSA_POOL_MPOL_PREFERRED      1
+
+struct cache;
+
 SLIST_HEAD(entries, entry);
 struct entry {
         SLIST_ENTRY(entry) list;
+        union {
+                struct cache *cache;
+                struct entry *next;
+        } u;
         unsigned char data[0];
 };
 
+TAILQ_HEAD(caches, cache);
+struct cache {
+        struct medusa_pool *pool;
+        TAILQ_ENTRY(cache) list;
+        struct entry *remote;
+        unsigned int active;
+        unsigned int count;
+        unsigned long long mallocs;
+        struct entry *entries[MEDUSA_POOL_CACHE_SIZE];
+};
+
 TAILQ_HEAD(blocks, block);
 struct block {
         struct medusa_pool *pool;
@@ -24,7 +90,9 @@ struct block {
         unsigned char data[0];
 };
 
+TAILQ_HEAD(pools, medusa_pool);
 struct medusa_pool {
+        TAILQ_ENTRY(medusa_pool) list;
         char *name;
         struct blocks free;
         struct blocks half;
@@ -32,16 +100,42 @@ struct medusa_pool {
         unsigned int size;
         unsigned int flags;
         unsigned int page_size;
+        unsigned int block_size;
         unsigned int count;
+        int numa_node;
         unsigned int entry_capacity;
         unsigned int entry_used;
         unsigned int entry_used_average;
+        unsigned long long average_since;
+        unsigned long long trim_period;
+        unsigned long long trim_since;
+        unsigned long long mallocs;
+        unsigned long long contended;
         void (*constructor) (void *ptr, void *context);
         void (*destructor) (void *ptr, void *context);
         void *context;
         pthread_mutex_t mutex;
+        pthread_key_t key;
+        struct caches caches;
 };
 
+/*
+ * every pool is linked to a global registry so that medusa_pool_get_stats_all
+ * can report the library's internal pools. the registry lock is always taken
+ * before a pool lock.
+ */
+
+static struct pools g_pools = TAILQ_HEAD_INITIALIZER(g_pools);
+static pthread_mutex_t g_pools_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline void pool_lock (struct medusa_pool *pool)
+{
+        if (pthread_mutex_trylock(&pool->mutex) != 0) {
+                pthread_mutex_lock(&pool->mutex);
+                pool->contended += 1;
+        }
+}
+
 static inline int aligncount (unsigned int size, unsigned int count, unsigned int header, unsigned int page_size)
 {
         count *= size;
@@ -51,6 +145,51 @@ static inline int aligncount (unsigned int size, unsigned int count, unsigned in
         return count;
 }
 
+static void * block_malloc (struct medusa_pool *pool)
+{
+        void *ptr;
+#if defined(__linux__) && defined(__NR_mbind)
+        unsigned long nodemask[MEDUSA_POOL_NUMA_NODES / (sizeof(unsigned long) * 8)];
+#endif
+        if (!(pool->flags & (MEDUSA_POOL_FLAG_MMAP | MEDUSA_POOL_FLAG_HUGETLB))) {
+                return malloc(pool->block_size);
+        }
+        ptr = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+        if (pool->flags & MEDUSA_POOL_FLAG_HUGETLB) {
+                ptr = mmap(NULL, pool->block_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+#endif
+        if (ptr == MAP_FAILED) {
+                ptr = mmap(NULL, pool->block_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (ptr == MAP_FAILED) {
+                        return NULL;
+                }
+#if defined(MADV_HUGEPAGE)
+                if (pool->flags & MEDUSA_POOL_FLAG_HUGETLB) {
+                        madvise(ptr, pool->block_size, MADV_HUGEPAGE);
+                }
+#endif
+        }
+#if defined(__linux__) && defined(__NR_mbind)
+        if (pool->numa_node >= 0) {
+                memset(nodemask, 0, sizeof(nodemask));
+                nodemask[pool->numa_node / (sizeof(unsigned long) * 8)] |= 1UL << (pool->numa_node % (sizeof(unsigned long) * 8));
+                syscall(__NR_mbind, ptr, pool->block_size, MEDUSA_POOL_MPOL_PREFERRED, nodemask, MEDUSA_POOL_NUMA_NODES + 1, 0);
+        }
+#endif
+        return ptr;
+}
+
+static void block_free (struct medusa_pool *pool, void *ptr)
+{
+        if (!(pool->flags & (MEDUSA_POOL_FLAG_MMAP | MEDUSA_POOL_FLAG_HUGETLB))) {
+                free(ptr);
+                return;
+        }
+        munmap(ptr, pool->block_size);
+}
+
 static void block_destroy (struct block *block)
 {
         struct entry *entry;
@@ -66,7 +205,7 @@ static void block_destroy (struct block *block)
                 }
         }
         block->pool->entry_capacity -= block->pool->count;
-        free(block);
+        block_free(block->pool, block);
 }
 
 static struct block * block_create (struct medusa_pool *pool)
@@ -74,7 +213,7 @@ static struct block * block_create (struct medusa_pool *pool)
         unsigned int i;
         struct entry *entry;
         struct block *block;
-        block = malloc(sizeof(struct block) + pool->size * pool->count);
+        block = block_malloc(pool);
         if (block == NULL) {
                 goto bail;
         }
@@ -96,6 +235,329 @@ bail:   if (block != NULL) {
         return NULL;
 }
 
+static unsigned long long pool_clock_nsec (void)
+{
+        struct timespec now;
+        medusa_clock_monotonic_coarse(&now);
+        return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static unsigned int pool_trim_unlocked (struct medusa_pool *pool, unsigned int capacity)
+{
+        unsigned int count;
+        struct block *block;
+        count = 0;
+        while (capacity < pool->entry_capacity && !TAILQ_EMPTY(&pool->free)) {
+                block = TAILQ_LAST(&pool->free, blocks);
+                TAILQ_REMOVE(&pool->free, block, list);
+                block_destroy(block);
+                count += 1;
+        }
+        return count;
+}
+
+static void pool_release_unlocked (struct entry *entry)
+{
+        struct medusa_pool *pool;
+        struct block *block;
+        block = (struct block *) entry->list.sle_next;
+        pool = block->pool;
+        if (SLIST_EMPTY(&block->free)) {
+                TAILQ_REMOVE(&pool->full, block, list);
+        } else {
+                TAILQ_REMOVE(&pool->half, block, list);
+        }
+        SLIST_INSERT_HEAD(&block->free, entry, list);
+        block->nused -= 1;
+        pool->entry_used -= 1;
+        if (block->nused == 0) {
+                if (pool->flags & MEDUSA_POOL_FLAG_RESERVE_NONE) {
+                        block_destroy(block);
+                } else if (pool->flags & MEDUSA_POOL_FLAG_RESERVE_SINGLE) {
+                        if (TAILQ_EMPTY(&pool->free)) {
+                                TAILQ_INSERT_HEAD(&pool->free, block, list);
+                        } else {
+                                block_destroy(block);
+                        }
+                } else if (pool->flags & MEDUSA_POOL_FLAG_RESERVE_HEURISTIC) {
+                        TAILQ_INSERT_HEAD(&pool->free, block, list);
+                } else {
+                        block_destroy(block);
+                }
+        } else {
+                TAILQ_INSERT_HEAD(&pool->half, block, list);
+        }
+}
+
+static void pool_drain_unlocked (struct medusa_pool *pool)
+{
+        struct cache *cache;
+        struct entry *entry;
+        struct entry *nentry;
+        TAILQ_FOREACH(cache, &pool->caches, list) {
+                entry = __atomic_exchange_n(&cache->remote, NULL, __ATOMIC_ACQUIRE);
+                while (entry != NULL) {
+                        nentry = entry->u.next;
+                        pool_release_unlocked(entry);
+                        entry = nentry;
+                }
+        }
+}
+
+static inline int pool_reserve_pending (struct medusa_pool *pool)
+{
+        if ((pool->flags & (MEDUSA_POOL_FLAG_RESERVE_NONE | MEDUSA_POOL_FLAG_RESERVE_SINGLE | MEDUSA_POOL_FLAG_RESERVE_HEURISTIC)) != MEDUSA_POOL_FLAG_RESERVE_HEURISTIC) {
+                return 0;
+        }
+        return !TAILQ_EMPTY(&pool->free);
+}
+
+static void pool_reserve_heuristic (struct medusa_pool *pool)
+{
+        unsigned int samples;
+        unsigned long long now;
+        unsigned long long step;
+        now = pool_clock_nsec();
+        step = pool->trim_period / MEDUSA_POOL_TRIM_SAMPLES;
+        if (pool->average_since == 0 || step == 0) {
+                pool->entry_used_average = pool->entry_used;
+                pool->average_since = now;
+        }
+        /*
+         * samples missed while the pool was idle are replayed with the
+         * current usage, dating the start of the dip where it happened.
+         */
+        for (samples = 0; step != 0 && now - pool->average_since >= step; samples++) {
+                if (samples == MEDUSA_POOL_TRIM_SAMPLES_MAX) {
+                        pool->entry_used_average = pool->entry_used;
+                        pool->average_since = now;
+                        break;
+                }
+                pool->average_since += step;
+                pool->entry_used_average = pool->entry_used_average * 3 / 4 + pool->entry_used / 4;
+                if (pool->trim_since == 0 &&
+                    pool->entry_used_average * 2 < pool->entry_capacity) {
+                        pool->trim_since = pool->average_since;
+                }
+        }
+        if (pool->entry_used_average * 2 >= pool->entry_capacity) {
+                pool->trim_since = 0;
+                return;
+        }
+        if (pool->trim_since == 0) {
+                pool->trim_since = now;
+        }
+        if (now - pool->trim_since < pool->trim_period) {
+                return;
+        }
+        pool_drain_unlocked(pool);
+        pool_trim_unlocked(pool, pool->entry_used_average * 2);
+        pool->trim_since = 0;
+}
+
+static struct entry * pool_get_unlocked (struct medusa_pool *pool)
+{
+        struct entry *entry;
+        struct block *block;
+        struct blocks *rblocks;
+        struct blocks *ablocks;
+        if (!TAILQ_EMPTY(&pool->half)) {
+                rblocks = &pool->half;
+        } else if (!TAILQ_EMPTY(&pool->free)) {
+                rblocks = &pool->free;
+        } else {
+                rblocks = NULL;
+                block = block_create(pool);
+                if (block == NULL) {
+                        return NULL;
+                }
+        }
+        if (rblocks != NULL) {
+                block = TAILQ_FIRST(rblocks);
+        }
+        entry = SLIST_FIRST(&block->free);
+        SLIST_REMOVE_HEAD(&block->free, list);
+        block->nused += 1;
+        pool->entry_used += 1;
+        if (SLIST_EMPTY(&block->free)) {
+                ablocks = &pool->full;
+        } else {
+                ablocks = &pool->half;
+        }
+        if (rblocks != ablocks) {
+                if (rblocks != NULL) {
+                        TAILQ_REMOVE(rblocks, block, list);
+                }
+                TAILQ_INSERT_HEAD(ablocks, block, list);
+        }
+        entry->list.sle_next = (void *) block;
+        entry->u.cache = NULL;
+        if (pool_reserve_pending(pool)) {
+                pool_reserve_heuristic(pool);
+        }
+        return entry;
+}
+
+static void pool_put_unlocked (struct entry *entry)
+{
+        struct medusa_pool *pool;
+        pool = ((struct block *) entry->list.sle_next)->pool;
+        pool_release_unlocked(entry);
+        if (pool_reserve_pending(pool)) {
+                pool_reserve_heuristic(pool);
+        }
+}
+
+static unsigned int pool_get_bulk_unlocked (struct medusa_pool *pool, void **ptrs, unsigned int count)
+{
+        unsigned int n;
+        struct entry *entry;
+        struct block *block;
+        n = 0;
+        while (n < count) {
+                if (!TAILQ_EMPTY(&pool->half)) {
+                        block = TAILQ_FIRST(&pool->half);
+                        TAILQ_REMOVE(&pool->half, block, list);
+                } else if (!TAILQ_EMPTY(&pool->free)) {
+                        block = TAILQ_FIRST(&pool->free);
+                        TAILQ_REMOVE(&pool->free, block, list);
+                } else {
+                        block = block_create(pool);
+                        if (block == NULL) {
+                                break;
+                        }
+                }
+                while (n < count && !SLIST_EMPTY(&block->free)) {
+                        entry = SLIST_FIRST(&block->free);
+                        SLIST_REMOVE_HEAD(&block->free, list);
+                        block->nused += 1;
+                        pool->entry_used += 1;
+                        entry->list.sle_next = (void *) block;
+                        entry->u.cache = NULL;
+                        ptrs[n++] = entry->data;
+                }
+                if (SLIST_EMPTY(&block->free)) {
+                        TAILQ_INSERT_HEAD(&pool->full, block, list);
+                } else {
+                        TAILQ_INSERT_HEAD(&pool->half, block, list);
+                }
+        }
+        if (pool_reserve_pending(pool)) {
+                pool_reserve_heuristic(pool);
+        }
+        return n;
+}
+
+static void cache_flush_unlocked (struct cache *cache, unsigned int count)
+{
+        while (count-- > 0 && cache->count > 0) {
+                pool_put_unlocked(cache->entries[--cache->count]);
+        }
+}
+
+static void cache_release_unlocked (struct cache *cache)
+{
+        struct entry *entry;
+        struct entry *nentry;
+        cache_flush_unlocked(cache, cache->count);
+        entry = __atomic_exchange_n(&cache->remote, NULL, __ATOMIC_ACQUIRE);
+        while (entry != NULL) {
+                nentry = entry->u.next;
+                pool_put_unlocked(entry);
+                entry = nentry;
+        }
+}
+
+static void cache_release (void *ptr)
+{
+        struct cache *cache = (struct cache *) ptr;
+        struct medusa_pool *pool;
+        if (cache == NULL) {
+                return;
+        }
+        pool = cache->pool;
+        pool_lock(pool);
+        __atomic_store_n(&cache->active, 0, __ATOMIC_SEQ_CST);
+        cache_release_unlocked(cache);
+        pthread_mutex_unlock(&pool->mutex);
+}
+
+static struct cache * cache_get (struct medusa_pool *pool)
+{
+        struct cache *cache;
+        cache = pthread_getspecific(pool->key);
+        if (cache != NULL) {
+                return cache;
+        }
+        pool_lock(pool);
+        TAILQ_FOREACH(cache, &pool->caches, list) {
+                if (__atomic_load_n(&cache->active, __ATOMIC_RELAXED) == 0) {
+                        break;
+                }
+        }
+        if (cache == NULL) {
+                cache = malloc(sizeof(struct cache));
+                if (cache == NULL) {
+                        goto bail;
+                }
+                memset(cache, 0, sizeof(struct cache));
+                cache->pool = pool;
+                TAILQ_INSERT_TAIL(&pool->caches, cache, list);
+        }
+        if (pthread_setspecific(pool->key, cache) != 0) {
+                goto bail;
+        }
+        cache_release_unlocked(cache);
+        __atomic_store_n(&cache->active, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->mutex);
+        return cache;
+bail:   pthread_mutex_unlock(&pool->mutex);
+        return NULL;
+}
+
+static void cache_refill (struct cache *cache)
+{
+        struct entry *entry;
+        struct entry *nentry;
+        struct medusa_pool *pool = cache->pool;
+        entry = __atomic_exchange_n(&cache->remote, NULL, __ATOMIC_ACQUIRE);
+        if (entry != NULL) {
+                while (entry != NULL && cache->count < MEDUSA_POOL_CACHE_SIZE) {
+                        nentry = entry->u.next;
+                        cache->entries[cache->count++] = entry;
+                        entry = nentry;
+                }
+                if (entry != NULL) {
+                        pool_lock(pool);
+                        while (entry != NULL) {
+                                nentry = entry->u.next;
+                                pool_put_unlocked(entry);
+                                entry = nentry;
+                        }
+                        pthread_mutex_unlock(&pool->mutex);
+                }
+                return;
+        }
+        pool_lock(pool);
+        while (cache->count < MEDUSA_POOL_CACHE_BATCH) {
+                entry = pool_get_unlocked(pool);
+                if (entry == NULL) {
+                        break;
+                }
+                cache->entries[cache->count++] = entry;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+}
+
+static void cache_remote_free (struct cache *cache, struct entry *entry)
+{
+        struct entry *head;
+        head = __atomic_load_n(&cache->remote, __ATOMIC_RELAXED);
+        do {
+                entry->u.next = head;
+        } while (!__atomic_compare_exchange_n(&cache->remote, &head, entry, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
 __attribute__ ((visibility ("default"))) struct medusa_pool * medusa_pool_create (
                 const char *name,
                 unsigned int size,
@@ -121,9 +583,15 @@ __attribute__ ((visibility ("default"))) struct medusa_pool * medusa_pool_create
         TAILQ_INIT(&pool->free);
         TAILQ_INIT(&pool->half);
         TAILQ_INIT(&pool->full);
+        TAILQ_INIT(&pool->caches);
         if (flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
                 pthread_mutex_init(&pool->mutex, NULL);
+                if (pthread_key_create(&pool->key, cache_release) != 0) {
+                        pthread_mutex_destroy(&pool->mutex);
+                        goto bail;
+                }
         }
+        pool->flags = flags;
         if (name != NULL) {
                 pool->name = strdup(name);
                 if (pool->name == NULL) {
@@ -132,12 +600,23 @@ __attribute__ ((visibility ("default"))) struct medusa_pool * medusa_pool_create
         }
         pool->size = sizeof(struct entry) + size;
         pool->size = (pool->size + align - 1) & ~(align - 1);
-        pool->flags = flags;
         pool->constructor = constructor;
         pool->destructor = destructor;
         pool->context = context;
         pool->page_size = getpagesize();
+        if (flags & MEDUSA_POOL_FLAG_HUGETLB) {
+                pool->page_size = MEDUSA_POOL_HUGEPAGE_SIZE;
+        }
+        pool->numa_node = -1;
+        pool->trim_period = MEDUSA_POOL_TRIM_PERIOD;
         pool->count = aligncount(pool->size, count, sizeof(struct block), pool->page_size);
+        pool->block_size = sizeof(struct block) + pool->size * pool->count;
+        if (flags & (MEDUSA_POOL_FLAG_MMAP | MEDUSA_POOL_FLAG_HUGETLB)) {
+                pool->block_size = (pool->block_size + pool->page_size - 1) & ~(pool->page_size - 1);
+        }
+        pthread_mutex_lock(&g_pools_mutex);
+        TAILQ_INSERT_TAIL(&g_pools, pool, list);
+        pthread_mutex_unlock(&g_pools_mutex);
         return pool;
 bail:   if (pool != NULL) {
                 medusa_pool_destroy(pool);
@@ -149,9 +628,21 @@ __attribute__ ((visibility ("default"))) void medusa_pool_destroy (struct medusa
 {
         struct block *block;
         struct block *nblock;
+        struct cache *cache;
+        struct cache *ncache;
         if (pool == NULL) {
                 return;
         }
+        if (pool->list.tqe_prev != NULL) {
+                pthread_mutex_lock(&g_pools_mutex);
+                TAILQ_REMOVE(&g_pools, pool, list);
+                pthread_mutex_unlock(&g_pools_mutex);
+        }
+        TAILQ_FOREACH_SAFE(cache, &pool->caches, list, ncache) {
+                TAILQ_REMOVE(&pool->caches, cache, list);
+                cache_release_unlocked(cache);
+                free(cache);
+        }
         if (pool->name != NULL) {
                 free(pool->name);
         }
@@ -168,6 +659,7 @@ __attribute__ ((visibility ("default"))) void medusa_pool_destroy (struct medusa
                 block_destroy(block);
         }
         if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pthread_key_delete(pool->key);
                 pthread_mutex_destroy(&pool->mutex);
         }
         free(pool);
@@ -176,55 +668,37 @@ __attribute__ ((visibility ("default"))) void medusa_pool_destroy (struct medusa
 __attribute__ ((visibility ("default"))) void * medusa_pool_malloc (struct medusa_pool *pool)
 {
         struct entry *entry;
-        struct block *block;
-        struct blocks *rblocks;
-        struct blocks *ablocks;
+        struct cache *cache;
         if (pool == NULL) {
-                goto bail;
+                return NULL;
         }
         if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
-                pthread_mutex_lock(&pool->mutex);
-        }
-        if (!TAILQ_EMPTY(&pool->half)) {
-                rblocks = &pool->half;
-        } else if (!TAILQ_EMPTY(&pool->free)) {
-                rblocks = &pool->free;
-        } else {
-                rblocks = NULL;
-                block = block_create(pool);
-                if (block == NULL) {
-                        goto bail;
+                cache = cache_get(pool);
+                if (cache != NULL) {
+                        if (cache->count == 0) {
+                                cache_refill(cache);
+                                if (cache->count == 0) {
+                                        return NULL;
+                                }
+                        }
+                        entry = cache->entries[--cache->count];
+                        entry->u.cache = cache;
+                        __atomic_store_n(&cache->mallocs, cache->mallocs + 1, __ATOMIC_RELAXED);
+                        return entry->data;
                 }
+                pool_lock(pool);
         }
-        if (rblocks != NULL) {
-                block = TAILQ_FIRST(rblocks);
+        entry = pool_get_unlocked(pool);
+        if (entry != NULL) {
+                pool->mallocs += 1;
         }
-        entry = SLIST_FIRST(&block->free);
-        SLIST_REMOVE_HEAD(&block->free, list);
-        block->nused += 1;
-        pool->entry_used += 1;
-        if (SLIST_EMPTY(&block->free)) {
-                ablocks = &pool->full;
-        } else {
-                ablocks = &pool->half;
-        }
-        if (rblocks != ablocks) {
-                if (rblocks != NULL) {
-                        TAILQ_REMOVE(rblocks, block, list);
-                }
-                TAILQ_INSERT_HEAD(ablocks, block, list);
-        }
-        entry->list.sle_next = (void *) block;
         if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
                 pthread_mutex_unlock(&pool->mutex);
         }
-        return entry->data;
-bail:   if (pool != NULL) {
-                if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
-                        pthread_mutex_unlock(&pool->mutex);
-                }
+        if (entry == NULL) {
+                return NULL;
         }
-        return NULL;
+        return entry->data;
 }
 
 __attribute__ ((visibility ("default"))) void medusa_pool_free (void *ptr)
@@ -232,6 +706,8 @@ __attribute__ ((visibility ("default"))) void medusa_pool_free (void *ptr)
         struct medusa_pool *pool;
         struct block *block;
         struct entry *entry;
+        struct cache *cache;
+        struct cache *owner;
         if (ptr == NULL) {
                 return;
         }
@@ -239,44 +715,235 @@ __attribute__ ((visibility ("default"))) void medusa_pool_free (void *ptr)
         block = (struct block *) entry->list.sle_next;
         pool = block->pool;
         if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
-                pthread_mutex_lock(&pool->mutex);
+                if (entry->u.cache != NULL) {
+                        cache = pthread_getspecific(pool->key);
+                        if (cache == entry->u.cache) {
+                                if (cache->count == MEDUSA_POOL_CACHE_SIZE) {
+                                        pool_lock(pool);
+                                        cache_flush_unlocked(cache, MEDUSA_POOL_CACHE_BATCH);
+                                        pthread_mutex_unlock(&pool->mutex);
+                                }
+                                cache->entries[cache->count++] = entry;
+                                return;
+                        }
+                        owner = entry->u.cache;
+                        if (__atomic_load_n(&owner->active, __ATOMIC_SEQ_CST) != 0) {
+                                cache_remote_free(owner, entry);
+                                if (__atomic_load_n(&owner->active, __ATOMIC_SEQ_CST) != 0) {
+                                        return;
+                                }
+                                pool_lock(pool);
+                                if (__atomic_load_n(&owner->active, __ATOMIC_SEQ_CST) == 0) {
+                                        cache_release_unlocked(owner);
+                                }
+                                pthread_mutex_unlock(&pool->mutex);
+                                return;
+                        }
+                }
+                pool_lock(pool);
         }
-        if (SLIST_EMPTY(&block->free)) {
-                TAILQ_REMOVE(&pool->full, block, list);
+        pool_put_unlocked(entry);
+        if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pthread_mutex_unlock(&pool->mutex);
+        }
+}
+
+__attribute__ ((visibility ("default"))) int medusa_pool_set_trim_period (struct medusa_pool *pool, double period)
+{
+        if (pool == NULL) {
+                return -EINVAL;
+        }
+        if (period < 0) {
+                return -EINVAL;
+        }
+        if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pool_lock(pool);
+        }
+        pool->trim_period = (unsigned long long) (period * 1e9);
+        pool->average_since = 0;
+        pool->trim_since = 0;
+        if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pthread_mutex_unlock(&pool->mutex);
+        }
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_pool_trim (struct medusa_pool *pool)
+{
+        int rc;
+        struct cache *cache;
+        if (pool == NULL) {
+                return -EINVAL;
+        }
+        if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pool_lock(pool);
+                cache = pthread_getspecific(pool->key);
+                if (cache != NULL) {
+                        cache_release_unlocked(cache);
+                }
+                pool_drain_unlocked(pool);
+        }
+        rc = pool_trim_unlocked(pool, 0);
+        pool->entry_used_average = pool->entry_used;
+        pool->average_since = 0;
+        pool->trim_since = 0;
+        if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pthread_mutex_unlock(&pool->mutex);
+        }
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_pool_malloc_bulk (struct medusa_pool *pool, void **ptrs, unsigned int count)
+{
+        unsigned int n;
+        if (pool == NULL) {
+                return -EINVAL;
+        }
+        if (ptrs == NULL) {
+                return -EINVAL;
+        }
+        if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pool_lock(pool);
+        }
+        n = pool_get_bulk_unlocked(pool, ptrs, count);
+        if (n != count) {
+                while (n-- > 0) {
+                        pool_put_unlocked((struct entry *) (((unsigned char *) ptrs[n]) - sizeof(struct entry)));
+                        ptrs[n] = NULL;
+                }
         } else {
-                TAILQ_REMOVE(&pool->half, block, list);
+                pool->mallocs += count;
         }
-        SLIST_INSERT_HEAD(&block->free, entry, list);
-        block->nused -= 1;
-        pool->entry_used -= 1;
-        if (block->nused == 0) {
-                if (pool->flags & MEDUSA_POOL_FLAG_RESERVE_NONE) {
-                        block_destroy(block);
-                } else if (pool->flags & MEDUSA_POOL_FLAG_RESERVE_SINGLE) {
-                        if (TAILQ_EMPTY(&pool->free)) {
-                                TAILQ_INSERT_HEAD(&pool->free, block, list);
-                        } else {
-                                block_destroy(block);
+        if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pthread_mutex_unlock(&pool->mutex);
+        }
+        return (n == count) ? 0 : -ENOMEM;
+}
+
+__attribute__ ((visibility ("default"))) void medusa_pool_free_bulk (void **ptrs, unsigned int count)
+{
+        unsigned int i;
+        struct medusa_pool *pool;
+        struct medusa_pool *locked;
+        struct block *block;
+        struct entry *entry;
+        if (ptrs == NULL) {
+                return;
+        }
+        locked = NULL;
+        for (i = 0; i < count; i++) {
+                if (ptrs[i] == NULL) {
+                        continue;
+                }
+                entry = (struct entry *) (((unsigned char *) ptrs[i]) - sizeof(struct entry));
+                block = (struct block *) entry->list.sle_next;
+                pool = block->pool;
+                if (pool != locked) {
+                        if (locked != NULL &&
+                            locked->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                                pthread_mutex_unlock(&locked->mutex);
                         }
-                } else if (pool->flags & MEDUSA_POOL_FLAG_RESERVE_HEURISTIC) {
-                        TAILQ_INSERT_HEAD(&pool->free, block, list);
-                        if (pool->entry_used_average == 0) {
-                                pool->entry_used_average = pool->entry_used;
+                        if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                                pool_lock(pool);
                         }
-                        pool->entry_used_average = pool->entry_used_average * 3 / 4 + pool->entry_used / 4;
-                        while (pool->entry_used_average * 2 < pool->entry_capacity && !TAILQ_EMPTY(&pool->free)) {
-                                block = TAILQ_LAST(&pool->free, blocks);
-                                TAILQ_REMOVE(&pool->free, block, list);
-                                block_destroy(block);
-                        }
-
-                } else {
-                        block_destroy(block);
+                        locked = pool;
                 }
-        } else {
-                TAILQ_INSERT_HEAD(&pool->half, block, list);
+                pool_put_unlocked(entry);
+        }
+        if (locked != NULL &&
+            locked->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pthread_mutex_unlock(&locked->mutex);
+        }
+}
+
+__attribute__ ((visibility ("default"))) int medusa_pool_set_numa_node (struct medusa_pool *pool, int node)
+{
+        if (pool == NULL) {
+                return -EINVAL;
+        }
+        if (node < -1 || node >= MEDUSA_POOL_NUMA_NODES) {
+                return -EINVAL;
+        }
+        if (!(pool->flags & (MEDUSA_POOL_FLAG_MMAP | MEDUSA_POOL_FLAG_HUGETLB))) {
+                return -EINVAL;
+        }
+#if defined(__linux__) && defined(__NR_mbind)
+        if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pool_lock(pool);
+        }
+        pool->numa_node = node;
+        if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pthread_mutex_unlock(&pool->mutex);
+        }
+        return 0;
+#else
+        return (node == -1) ? 0 : -ENOTSUP;
+#endif
+}
+
+static void pool_get_stats_unlocked (struct medusa_pool *pool, struct medusa_pool_stats *stats)
+{
+        struct block *block;
+        struct cache *cache;
+        memset(stats, 0, sizeof(struct medusa_pool_stats));
+        if (pool->name != NULL) {
+                snprintf(stats->name, sizeof(stats->name), "%s", pool->name);
+        }
+        stats->size = pool->size - sizeof(struct entry);
+        stats->count = pool->count;
+        TAILQ_FOREACH(block, &pool->free, list) {
+                stats->blocks.free += 1;
+        }
+        TAILQ_FOREACH(block, &pool->half, list) {
+                stats->blocks.half += 1;
+        }
+        TAILQ_FOREACH(block, &pool->full, list) {
+                stats->blocks.full += 1;
+        }
+        stats->entries.capacity = pool->entry_capacity;
+        stats->entries.used = pool->entry_used;
+        stats->bytes.reserved = (unsigned long long) pool->block_size * (stats->blocks.free + stats->blocks.half + stats->blocks.full);
+        stats->bytes.used = (unsigned long long) pool->size * pool->entry_used;
+        stats->mallocs = pool->mallocs;
+        TAILQ_FOREACH(cache, &pool->caches, list) {
+                stats->mallocs += __atomic_load_n(&cache->mallocs, __ATOMIC_RELAXED);
+        }
+        stats->contended = pool->contended;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_pool_get_stats (struct medusa_pool *pool, struct medusa_pool_stats *stats)
+{
+        if (pool == NULL) {
+                return -EINVAL;
+        }
+        if (stats == NULL) {
+                return -EINVAL;
+        }
+        if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
+                pool_lock(pool);
         }
+        pool_get_stats_unlocked(pool, stats);
         if (pool->flags & MEDUSA_POOL_FLAG_THREAD_SAFE) {
                 pthread_mutex_unlock(&pool->mutex);
         }
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_pool_get_stats_all (struct medusa_pool_stats *stats, unsigned int count)
+{
+        int rc;
+        struct medusa_pool *pool;
+        if (stats == NULL && count > 0) {
+                return -EINVAL;
+        }
+        rc = 0;
+        pthread_mutex_lock(&g_pools_mutex);
+        TAILQ_FOREACH(pool, &g_pools, list) {
+                if ((unsigned int) rc < count) {
+                        medusa_pool_get_stats(pool, &stats[rc]);
+                }
+                rc += 1;
+        }
+        pthread_mutex_unlock(&g_pools_mutex);
+        return rc;
 }
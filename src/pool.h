@@ -12,6 +12,8 @@ enum {
         MEDUSA_POOL_FLAG_RESERVE_SINGLE         = 0x00000008,
         MEDUSA_POOL_FLAG_RESERVE_HEURISTIC      = 0x00000010,
         MEDUSA_POOL_FLAG_THREAD_SAFE            = 0x00000020,
+        MEDUSA_POOL_FLAG_MMAP                   = 0x00000040,
+        MEDUSA_POOL_FLAG_HUGETLB                = 0x00000080,
         MEDUSA_POOL_FLAG_DEFAULT                = MEDUSA_POOL_FLAG_RESERVE_HEURISTIC
 #define MEDUSA_POOL_FLAG_NONE                   MEDUSA_POOL_FLAG_NONE
 #define MEDUSA_POOL_FLAG_POISON                 MEDUSA_POOL_FLAG_POISON
@@ -20,9 +22,32 @@ enum {
 #define MEDUSA_POOL_FLAG_RESERVE_SINGLE         MEDUSA_POOL_FLAG_RESERVE_SINGLE
 #define MEDUSA_POOL_FLAG_RESERVE_HEURISTIC      MEDUSA_POOL_FLAG_RESERVE_HEURISTIC
 #define MEDUSA_POOL_FLAG_THREAD_SAFE            MEDUSA_POOL_FLAG_THREAD_SAFE
+#define MEDUSA_POOL_FLAG_MMAP                   MEDUSA_POOL_FLAG_MMAP
+#define MEDUSA_POOL_FLAG_HUGETLB                MEDUSA_POOL_FLAG_HUGETLB
 #define MEDUSA_POOL_FLAG_DEFAULT                MEDUSA_POOL_FLAG_DEFAULT
 };
 
+struct medusa_pool_stats {
+        char name[64];
+        unsigned int size;
+        unsigned int count;
+        struct {
+                unsigned int free;
+                unsigned int half;
+                unsigned int full;
+        } blocks;
+        struct {
+                unsigned int capacity;
+                unsigned int used;
+        } entries;
+        struct {
+                unsigned long long reserved;
+                unsigned long long used;
+        } bytes;
+        unsigned long long mallocs;
+        unsigned long long contended;
+};
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -42,6 +67,17 @@ void medusa_pool_destroy (struct medusa_pool *pool);
 void * medusa_pool_malloc (struct medusa_pool *pool);
 void medusa_pool_free (void *ptr);
 
+int medusa_pool_malloc_bulk (struct medusa_pool *pool, void **ptrs, unsigned int count);
+void medusa_pool_free_bulk (void **ptrs, unsigned int count);
+
+int medusa_pool_set_trim_period (struct medusa_pool *pool, double period);
+int medusa_pool_trim (struct medusa_pool *pool);
+
+int medusa_pool_set_numa_node (struct medusa_pool *pool, int node);
+
+int medusa_pool_get_stats (struct medusa_pool *pool, struct medusa_pool_stats *stats);
+int medusa_pool_get_stats_all (struct medusa_pool_stats *stats, unsigned int count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -194,6 +194,21 @@ void * pqueue_pop (struct pqueue_head *head)
         return e;
 }
 
+unsigned int pqueue_pop_expired (struct pqueue_head *head, void *key, void **out, unsigned int max)
+{
+        unsigned int count;
+        for (count = 0; count < max; count++) {
+                if (head->count == 1) {
+                        break;
+                }
+                if (head->compare(head->entries[1], key) > 0) {
+                        break;
+                }
+                out[count] = pqueue_pop(head);
+        }
+        return count;
+}
+
 static int pqueue_search_actual (struct pqueue_head *head, void *key, int (*callback) (void *context, void *entry), void *context, unsigned int pos)
 {
         int rc;
@@ -267,3 +282,267 @@ int pqueue_verify (struct pqueue_head *head)
 {
         return pqueue_is_valid_actual(head, 1);
 }
+
+/*
+ * 4-ary heap keyed by an unsigned 64 bit value, the key is stored next to
+ * the entry pointer, so sifting never dereferences the entries themselves.
+ * additions are appended and ordered lazily on the next access, so a burst
+ * of additions costs one heapify instead of one sift per entry.
+ */
+
+#define pqueue4_child(i)        ((4 * (i)) + 1)
+#define pqueue4_parent(i)       (((i) - 1) / 4)
+
+struct pqueue4_node {
+        unsigned long long key;
+        void *entry;
+};
+
+struct pqueue4_head {
+        struct pqueue4_node *nodes;
+        unsigned int count;
+        unsigned int sorted;
+        unsigned int size;
+        unsigned int step;
+        void (*setpos) (void *entry, unsigned int position);
+        unsigned int (*getpos) (void *entry);
+};
+
+struct pqueue4_head * pqueue4_create (
+        unsigned int size, unsigned int step,
+        void (*setpos) (void *entry, unsigned int position),
+        unsigned int (*getpos) (void *entry))
+{
+        struct pqueue4_head *head;
+        head = malloc(sizeof(struct pqueue4_head));
+        if (head == NULL) {
+                goto bail;
+        }
+        memset(head, 0, sizeof(struct pqueue4_head));
+        head->size = size;
+        head->step = step ? step : 1;
+        head->setpos = setpos;
+        head->getpos = getpos;
+        head->count = 0;
+        if (head->size > 0) {
+                head->nodes = (struct pqueue4_node *) malloc(sizeof(struct pqueue4_node) * head->size);
+                if (head->nodes == NULL) {
+                        goto bail;
+                }
+        }
+        return head;
+bail:   if (head != NULL) {
+                pqueue4_destroy(head);
+        }
+        return NULL;
+}
+
+void pqueue4_destroy (struct pqueue4_head *head)
+{
+        if (head == NULL) {
+                return;
+        }
+        if (head->nodes != NULL) {
+                free(head->nodes);
+        }
+        free(head);
+}
+
+unsigned int pqueue4_count (struct pqueue4_head *head)
+{
+        return head->count;
+}
+
+static inline void pqueue4_shift_up (struct pqueue4_head *head, unsigned int i)
+{
+        unsigned int p;
+        struct pqueue4_node n;
+        n = head->nodes[i];
+        while (i > 0) {
+                p = pqueue4_parent(i);
+                if (!(head->nodes[p].key > n.key)) {
+                        break;
+                }
+                head->nodes[i] = head->nodes[p];
+                head->setpos(head->nodes[i].entry, i);
+                i = p;
+        }
+        head->nodes[i] = n;
+        head->setpos(n.entry, i);
+}
+
+static inline void pqueue4_shift_down (struct pqueue4_head *head, unsigned int i)
+{
+        unsigned int c;
+        unsigned int m;
+        unsigned int e;
+        struct pqueue4_node n;
+        n = head->nodes[i];
+        while (1) {
+                c = pqueue4_child(i);
+                if (c >= head->count) {
+                        break;
+                }
+                e = (c + 4 < head->count) ? c + 4 : head->count;
+                for (m = c++; c < e; c++) {
+                        if (head->nodes[c].key < head->nodes[m].key) {
+                                m = c;
+                        }
+                }
+                if (!(n.key > head->nodes[m].key)) {
+                        break;
+                }
+                head->nodes[i] = head->nodes[m];
+                head->setpos(head->nodes[i].entry, i);
+                i = m;
+        }
+        head->nodes[i] = n;
+        head->setpos(n.entry, i);
+}
+
+static void pqueue4_fixup (struct pqueue4_head *head)
+{
+        unsigned int i;
+        if (head->sorted == head->count) {
+                return;
+        }
+        if (head->count - head->sorted > head->sorted) {
+                for (i = (head->count + 2) / 4; i-- > 0; ) {
+                        pqueue4_shift_down(head, i);
+                }
+        } else {
+                for (i = head->sorted; i < head->count; i++) {
+                        pqueue4_shift_up(head, i);
+                }
+        }
+        head->sorted = head->count;
+}
+
+int pqueue4_add (struct pqueue4_head *head, void *entry, unsigned long long key)
+{
+        unsigned int i;
+        if (head->count + 1 > head->size) {
+                struct pqueue4_node *tmp;
+                unsigned int size;
+                size = MAX(head->count + 1, head->size + head->step);
+                tmp = (struct pqueue4_node *) realloc(head->nodes, sizeof(struct pqueue4_node) * size);
+                if (tmp == NULL) {
+                        goto bail;
+                }
+                head->nodes = tmp;
+                head->size = size;
+        }
+        i = head->count++;
+        head->nodes[i].key = key;
+        head->nodes[i].entry = entry;
+        head->setpos(entry, i);
+        return 0;
+bail:   return -1;
+}
+
+int pqueue4_mod (struct pqueue4_head *head, void *entry, unsigned long long key)
+{
+        unsigned int i;
+        unsigned long long okey;
+        pqueue4_fixup(head);
+        i = head->getpos(entry);
+        if (i >= head->count) {
+                goto bail;
+        }
+        okey = head->nodes[i].key;
+        head->nodes[i].key = key;
+        if (okey > key) {
+                pqueue4_shift_up(head, i);
+        } else {
+                pqueue4_shift_down(head, i);
+        }
+        return 0;
+bail:   return -1;
+}
+
+int pqueue4_del (struct pqueue4_head *head, void *entry)
+{
+        unsigned int i;
+        unsigned long long okey;
+        pqueue4_fixup(head);
+        i = head->getpos(entry);
+        if (i >= head->count) {
+                goto bail;
+        }
+        okey = head->nodes[i].key;
+        head->nodes[i] = head->nodes[--head->count];
+        head->sorted = head->count;
+        if (i < head->count) {
+                if (okey > head->nodes[i].key) {
+                        pqueue4_shift_up(head, i);
+                } else {
+                        pqueue4_shift_down(head, i);
+                }
+        }
+        head->setpos(entry, -1);
+        return 0;
+bail:   return -1;
+}
+
+void * pqueue4_peek (struct pqueue4_head *head, unsigned long long *key)
+{
+        pqueue4_fixup(head);
+        if (head->count == 0) {
+                return NULL;
+        }
+        if (key != NULL) {
+                *key = head->nodes[0].key;
+        }
+        return head->nodes[0].entry;
+}
+
+void * pqueue4_pop (struct pqueue4_head *head, unsigned long long *key)
+{
+        void *e;
+        pqueue4_fixup(head);
+        if (head->count == 0) {
+                return NULL;
+        }
+        e = head->nodes[0].entry;
+        if (key != NULL) {
+                *key = head->nodes[0].key;
+        }
+        head->nodes[0] = head->nodes[--head->count];
+        head->sorted = head->count;
+        if (head->count > 0) {
+                pqueue4_shift_down(head, 0);
+        }
+        head->setpos(e, -1);
+        return e;
+}
+
+unsigned int pqueue4_pop_expired (struct pqueue4_head *head, unsigned long long key, void **out, unsigned int max)
+{
+        unsigned int count;
+        pqueue4_fixup(head);
+        for (count = 0; count < max; count++) {
+                if (head->count == 0) {
+                        break;
+                }
+                if (head->nodes[0].key > key) {
+                        break;
+                }
+                out[count] = pqueue4_pop(head, NULL);
+        }
+        return count;
+}
+
+int pqueue4_verify (struct pqueue4_head *head)
+{
+        unsigned int i;
+        pqueue4_fixup(head);
+        for (i = 1; i < head->count; i++) {
+                if (head->nodes[pqueue4_parent(i)].key > head->nodes[i].key) {
+                        return 0;
+                }
+                if (head->getpos(head->nodes[i].entry) != i) {
+                        return 0;
+                }
+        }
+        return 1;
+}
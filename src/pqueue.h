@@ -20,6 +20,26 @@ int pqueue_verify (struct pqueue_head *head);
 
 void * pqueue_peek (struct pqueue_head *head);
 void * pqueue_pop (struct pqueue_head *head);
+unsigned int pqueue_pop_expired (struct pqueue_head *head, void *key, void **out, unsigned int max);
 int pqueue_search (struct pqueue_head *head, void *key, int (*callback) (void *context, void *entry), void *context);
 
+struct pqueue4_head;
+
+struct pqueue4_head * pqueue4_create (
+        unsigned int size, unsigned int step,
+        void (*setpos) (void *entry, unsigned int position),
+        unsigned int (*getpos) (void *entry));
+void pqueue4_destroy (struct pqueue4_head *head);
+
+unsigned int pqueue4_count (struct pqueue4_head *head);
+
+int pqueue4_add (struct pqueue4_head *head, void *entry, unsigned long long key);
+int pqueue4_mod (struct pqueue4_head *head, void *entry, unsigned long long key);
+int pqueue4_del (struct pqueue4_head *head, void *entry);
+int pqueue4_verify (struct pqueue4_head *head);
+
+void * pqueue4_peek (struct pqueue4_head *head, unsigned long long *key);
+void * pqueue4_pop (struct pqueue4_head *head, unsigned long long *key);
+unsigned int pqueue4_pop_expired (struct pqueue4_head *head, unsigned long long key, void **out, unsigned int max);
+
 #endif
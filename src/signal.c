@@ -455,6 +455,7 @@ __attribute__ ((visibility ("default"))) int medusa_signal_onevent_unlocked (str
 {
         int rc;
         struct medusa_monitor *monitor;
+        struct medusa_monitor_dispatch dispatch;
         rc = 0;
         monitor = signal->subject.monitor;
         if (events & MEDUSA_SIGNAL_EVENT_FIRED) {
@@ -468,9 +469,11 @@ __attribute__ ((visibility ("default"))) int medusa_signal_onevent_unlocked (str
         if (signal->onevent != NULL) {
                 if ((medusa_subject_is_active(&signal->subject)) ||
                     (events & MEDUSA_SIGNAL_EVENT_DESTROY)) {
+                        medusa_monitor_dispatch_begin_unlocked(monitor, &dispatch, &signal->subject, (void (*) (void)) signal->onevent);
                         medusa_monitor_unlock(monitor);
                         rc = signal->onevent(signal, events, signal->context);
                         medusa_monitor_lock(monitor);
+                        medusa_monitor_dispatch_end_unlocked(monitor, &dispatch);
                 }
         }
         if (events & MEDUSA_SIGNAL_EVENT_FIRED) {
@@ -4,11 +4,13 @@
 
 enum {
         MEDUSA_SUBJECT_FLAG_ALLOC               = 0x00000001,
+        MEDUSA_SUBJECT_FLAG_EMBEDDED            = 0x00000002,
         MEDUSA_SUBJECT_FLAG_MOD                 = 0x00000100,
         MEDUSA_SUBJECT_FLAG_DEL                 = 0x00000200,
         MEDUSA_SUBJECT_FLAG_ROGUE               = 0x00000400,
         MEDUSA_SUBJECT_FLAG_HEAP                = 0x00010000,
 #define MEDUSA_SUBJECT_FLAG_ALLOC               MEDUSA_SUBJECT_FLAG_ALLOC
+#define MEDUSA_SUBJECT_FLAG_EMBEDDED            MEDUSA_SUBJECT_FLAG_EMBEDDED
 #define MEDUSA_SUBJECT_FLAG_MOD                 MEDUSA_SUBJECT_FLAG_MOD
 #define MEDUSA_SUBJECT_FLAG_DEL                 MEDUSA_SUBJECT_FLAG_DEL
 #define MEDUSA_SUBJECT_FLAG_ROGUE               MEDUSA_SUBJECT_FLAG_ROGUE
@@ -27,6 +27,12 @@ int medusa_tcpsocket_get_enabled_unlocked (const struct medusa_tcpsocket *tcpsoc
 int medusa_tcpsocket_set_buffered_unlocked (struct medusa_tcpsocket *tcpsocket, int enabled);
 int medusa_tcpsocket_get_buffered_unlocked (const struct medusa_tcpsocket *tcpsocket);
 
+int medusa_tcpsocket_set_edgetriggered_unlocked (struct medusa_tcpsocket *tcpsocket, int enabled);
+int medusa_tcpsocket_get_edgetriggered_unlocked (const struct medusa_tcpsocket *tcpsocket);
+
+int medusa_tcpsocket_set_budget_unlocked (struct medusa_tcpsocket *tcpsocket, int budget);
+int medusa_tcpsocket_get_budget_unlocked (const struct medusa_tcpsocket *tcpsocket);
+
 int medusa_tcpsocket_set_nonblocking_unlocked (struct medusa_tcpsocket *tcpsocket, int enabled);
 int medusa_tcpsocket_get_nonblocking_unlocked (const struct medusa_tcpsocket *tcpsocket);
 
@@ -6,6 +6,7 @@ struct medusa_tcpsocket {
         struct medusa_subject subject;
         unsigned int flags;
         int backlog;
+        int budget;
         int (*onevent) (struct medusa_tcpsocket *tcpsocket, unsigned int events, void *context, ...);
         void *context;
         struct medusa_io *io;
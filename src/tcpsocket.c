@@ -20,11 +20,19 @@
 #include "pool.h"
 #include "queue.h"
 #include "buffer.h"
+#include "buffer-struct.h"
+#include "buffer-simple.h"
+#include "buffer-simple-struct.h"
+#include "buffer-chunked.h"
+#include "buffer-chunked-struct.h"
 #include "subject-struct.h"
 #include "io.h"
 #include "io-private.h"
+#include "io-struct.h"
+#include "wheel.h"
 #include "timer.h"
 #include "timer-private.h"
+#include "timer-struct.h"
 #include "tcpsocket.h"
 #include "tcpsocket-private.h"
 #include "tcpsocket-struct.h"
@@ -33,9 +41,11 @@
 #define MIN(a, b)                               (((a) < (b)) ? (a) : (b))
 
 #define MEDUSA_TCPSOCKET_USE_POOL               1
+#define MEDUSA_TCPSOCKET_USE_COMPOSITE          1
 
 #define MEDUSA_TCPSOCKET_DEFAULT_BACKLOG        128
-#define MEDUSA_TCPSOCKET_DEFAULT_IOVECS         4
+#define MEDUSA_TCPSOCKET_DEFAULT_IOVECS         16
+#define MEDUSA_TCPSOCKET_DEFAULT_BUDGET         (256 * 1024)
 
 enum {
         MEDUSA_TCPSOCKET_FLAG_NONE              = 0x00000000,
@@ -45,7 +55,8 @@ enum {
         MEDUSA_TCPSOCKET_FLAG_NODELAY           = 0x00000008,
         MEDUSA_TCPSOCKET_FLAG_REUSEADDR         = 0x00000010,
         MEDUSA_TCPSOCKET_FLAG_REUSEPORT         = 0x00000020,
-        MEDUSA_TCPSOCKET_FLAG_BACKLOG           = 0x00000040
+        MEDUSA_TCPSOCKET_FLAG_BACKLOG           = 0x00000040,
+        MEDUSA_TCPSOCKET_FLAG_EDGETRIGGERED     = 0x00000080
 #define MEDUSA_TCPSOCKET_FLAG_NONE              MEDUSA_TCPSOCKET_FLAG_NONE
 #define MEDUSA_TCPSOCKET_FLAG_ENABLED           MEDUSA_TCPSOCKET_FLAG_ENABLED
 #define MEDUSA_TCPSOCKET_FLAG_BUFFERED          MEDUSA_TCPSOCKET_FLAG_BUFFERED
@@ -54,6 +65,7 @@ enum {
 #define MEDUSA_TCPSOCKET_FLAG_REUSEADDR         MEDUSA_TCPSOCKET_FLAG_REUSEADDR
 #define MEDUSA_TCPSOCKET_FLAG_REUSEPORT         MEDUSA_TCPSOCKET_FLAG_REUSEPORT
 #define MEDUSA_TCPSOCKET_FLAG_BACKLOG           MEDUSA_TCPSOCKET_FLAG_BACKLOG
+#define MEDUSA_TCPSOCKET_FLAG_EDGETRIGGERED     MEDUSA_TCPSOCKET_FLAG_EDGETRIGGERED
 };
 
 #define MEDUSA_TCPSOCKET_FLAG_MASK              0xff
@@ -66,6 +78,22 @@ enum {
 static struct medusa_pool *g_pool;
 #endif
 
+/*
+ * sockets created by the library carry their io, buffers and timers in one
+ * object, hottest members first, and the socket subject is marked embedded.
+ * the monitor destroys primitives after sockets, so every embedded subject
+ * holds a reference on the object, and the last one destroyed releases it.
+ */
+struct tcpsocket_composite {
+        struct medusa_tcpsocket tcpsocket;
+        struct medusa_io io;
+        struct medusa_buffer_simple rbuffer;
+        struct medusa_buffer_chunked wbuffer;
+        struct medusa_timer rtimer;
+        struct medusa_timer ctimer;
+        unsigned int refs;
+};
+
 static inline void tcpsocket_set_flag (struct medusa_tcpsocket *tcpsocket, unsigned int flag)
 {
         tcpsocket->flags = (tcpsocket->flags & ~(MEDUSA_TCPSOCKET_FLAG_MASK << MEDUSA_TCPSOCKET_FLAG_SHIFT)) |
@@ -87,6 +115,102 @@ static inline int tcpsocket_has_flag (const struct medusa_tcpsocket *tcpsocket,
         return !!(tcpsocket->flags & ((flag & MEDUSA_TCPSOCKET_FLAG_MASK) << MEDUSA_TCPSOCKET_FLAG_SHIFT));
 }
 
+static inline struct tcpsocket_composite * tcpsocket_get_composite (struct medusa_tcpsocket *tcpsocket)
+{
+        if (tcpsocket->subject.flags & MEDUSA_SUBJECT_FLAG_EMBEDDED) {
+                return (struct tcpsocket_composite *) tcpsocket;
+        }
+        return NULL;
+}
+
+static void tcpsocket_composite_put (struct tcpsocket_composite *composite)
+{
+        if (--composite->refs > 0) {
+                return;
+        }
+#if defined(MEDUSA_TCPSOCKET_USE_POOL) && (MEDUSA_TCPSOCKET_USE_POOL == 1)
+        medusa_pool_free(composite);
+#else
+        free(composite);
+#endif
+}
+
+static struct medusa_io * tcpsocket_io_create (struct medusa_tcpsocket *tcpsocket, const struct medusa_io_init_options *options)
+{
+        int rc;
+        struct tcpsocket_composite *composite;
+        composite = tcpsocket_get_composite(tcpsocket);
+        if (composite == NULL ||
+            composite->io.subject.monitor != NULL) {
+                return medusa_io_create_with_options_unlocked(options);
+        }
+        rc = medusa_io_init_with_options_unlocked(&composite->io, options);
+        composite->io.subject.flags |= MEDUSA_SUBJECT_FLAG_EMBEDDED;
+        composite->refs += 1;
+        if (rc < 0) {
+                medusa_io_uninit_unlocked(&composite->io);
+                return MEDUSA_ERR_PTR(rc);
+        }
+        return &composite->io;
+}
+
+static struct medusa_timer * tcpsocket_timer_create (struct medusa_tcpsocket *tcpsocket, struct medusa_timer *timer, int (*onevent) (struct medusa_timer *timer, unsigned int events, void *context, ...))
+{
+        int rc;
+        struct tcpsocket_composite *composite;
+        composite = tcpsocket_get_composite(tcpsocket);
+        if (timer == NULL ||
+            timer->subject.monitor != NULL) {
+                return medusa_timer_create_unlocked(tcpsocket->subject.monitor, onevent, tcpsocket);
+        }
+        rc = medusa_timer_init_unlocked(timer, tcpsocket->subject.monitor, onevent, tcpsocket);
+        timer->subject.flags |= MEDUSA_SUBJECT_FLAG_EMBEDDED;
+        composite->refs += 1;
+        if (rc < 0) {
+                medusa_timer_uninit_unlocked(timer);
+                return MEDUSA_ERR_PTR(rc);
+        }
+        return timer;
+}
+
+static struct medusa_buffer * tcpsocket_rbuffer_create (struct medusa_buffer_simple *simple)
+{
+        int rc;
+        struct medusa_buffer_simple_init_options options;
+        if (simple == NULL ||
+            simple->buffer.backend != NULL) {
+                return medusa_buffer_create(MEDUSA_BUFFER_TYPE_DEFAULT);
+        }
+        rc = medusa_buffer_simple_init_options_default(&options);
+        if (rc < 0) {
+                return MEDUSA_ERR_PTR(rc);
+        }
+        rc = medusa_buffer_simple_init_with_options(simple, &options);
+        if (rc < 0) {
+                return MEDUSA_ERR_PTR(rc);
+        }
+        return &simple->buffer;
+}
+
+static struct medusa_buffer * tcpsocket_wbuffer_create (struct medusa_buffer_chunked *chunked)
+{
+        int rc;
+        struct medusa_buffer_chunked_init_options options;
+        if (chunked == NULL ||
+            chunked->buffer.backend != NULL) {
+                return medusa_buffer_create(MEDUSA_BUFFER_TYPE_CHUNKED);
+        }
+        rc = medusa_buffer_chunked_init_options_default(&options);
+        if (rc < 0) {
+                return MEDUSA_ERR_PTR(rc);
+        }
+        rc = medusa_buffer_chunked_init_with_options(chunked, &options);
+        if (rc < 0) {
+                return MEDUSA_ERR_PTR(rc);
+        }
+        return &chunked->buffer;
+}
+
 static inline unsigned int tcpsocket_get_state (const struct medusa_tcpsocket *tcpsocket)
 {
         return (tcpsocket->flags >> MEDUSA_TCPSOCKET_STATE_SHIFT) & MEDUSA_TCPSOCKET_STATE_MASK;
@@ -97,6 +221,28 @@ static inline unsigned int tcpsocket_get_buffered (const struct medusa_tcpsocket
         return tcpsocket_has_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_BUFFERED);
 }
 
+static inline int tcpsocket_get_budget (const struct medusa_tcpsocket *tcpsocket)
+{
+        return (tcpsocket->budget > 0) ? tcpsocket->budget : MEDUSA_TCPSOCKET_DEFAULT_BUDGET;
+}
+
+static inline int tcpsocket_can_drain (struct medusa_tcpsocket *tcpsocket, const struct medusa_io *io)
+{
+        if (tcpsocket->io != io) {
+                return 0;
+        }
+        if (!medusa_subject_is_active(&tcpsocket->subject)) {
+                return 0;
+        }
+        if (tcpsocket_get_state(tcpsocket) != MEDUSA_TCPSOCKET_STATE_CONNECTED) {
+                return 0;
+        }
+        if (medusa_io_get_enabled_unlocked(io) <= 0) {
+                return 0;
+        }
+        return medusa_io_get_edgetriggered_unlocked(io) > 0;
+}
+
 static inline int tcpsocket_set_state (struct medusa_tcpsocket *tcpsocket, unsigned int state)
 {
         int rc;
@@ -162,24 +308,56 @@ static inline int tcpsocket_set_state (struct medusa_tcpsocket *tcpsocket, unsig
         return 0;
 }
 
+static inline void tcpsocket_set_busypoll (struct medusa_tcpsocket *tcpsocket, int fd)
+{
+#if defined(SO_BUSY_POLL)
+        int value;
+        value = medusa_monitor_get_busypoll_socket_unlocked(tcpsocket->subject.monitor);
+        if (value > 0) {
+                setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value));
+        }
+#else
+        (void) tcpsocket;
+        (void) fd;
+#endif
+}
+
 static int tcpsocket_ctimer_onevent (struct medusa_timer *timer, unsigned int events, void *context, ...)
 {
+        struct medusa_monitor *monitor;
         struct medusa_tcpsocket *tcpsocket = (struct medusa_tcpsocket *) context;
-        (void) timer;
         if (events & MEDUSA_TIMER_EVENT_TIMEOUT) {
                 return medusa_tcpsocket_onevent(tcpsocket, MEDUSA_TCPSOCKET_EVENT_CONNECT_TIMEOUT);
         }
+        if (events & MEDUSA_TIMER_EVENT_DESTROY) {
+                if (timer->subject.flags & MEDUSA_SUBJECT_FLAG_EMBEDDED) {
+                        monitor = medusa_timer_get_monitor_unlocked(timer);
+                        medusa_monitor_lock(monitor);
+                        memset(timer, 0, sizeof(struct medusa_timer));
+                        tcpsocket_composite_put((struct tcpsocket_composite *) tcpsocket);
+                        medusa_monitor_unlock(monitor);
+                }
+        }
 
         return 0;
 }
 
 static int tcpsocket_rtimer_onevent (struct medusa_timer *timer, unsigned int events, void *context, ...)
 {
+        struct medusa_monitor *monitor;
         struct medusa_tcpsocket *tcpsocket = (struct medusa_tcpsocket *) context;
-        (void) timer;
         if (events & MEDUSA_TIMER_EVENT_TIMEOUT) {
                 return medusa_tcpsocket_onevent(tcpsocket, MEDUSA_TCPSOCKET_EVENT_BUFFERED_READ_TIMEOUT);
         }
+        if (events & MEDUSA_TIMER_EVENT_DESTROY) {
+                if (timer->subject.flags & MEDUSA_SUBJECT_FLAG_EMBEDDED) {
+                        monitor = medusa_timer_get_monitor_unlocked(timer);
+                        medusa_monitor_lock(monitor);
+                        memset(timer, 0, sizeof(struct medusa_timer));
+                        tcpsocket_composite_put((struct tcpsocket_composite *) tcpsocket);
+                        medusa_monitor_unlock(monitor);
+                }
+        }
 
         return 0;
 }
@@ -227,22 +405,31 @@ static int tcpsocket_io_onevent (struct medusa_io *io, unsigned int events, void
                                         goto bail;
                                 }
                         } else {
+                                int budget;
                                 int64_t blength;
                                 int64_t wlength;
                                 int64_t clength;
                                 int64_t niovecs;
-                                struct iovec iovec;
+                                struct msghdr msghdr;
+                                struct iovec iovecs[MEDUSA_TCPSOCKET_DEFAULT_IOVECS];
+                                budget = tcpsocket_get_budget(tcpsocket);
                                 while (1) {
-                                        niovecs = medusa_buffer_queryv(tcpsocket->wbuffer, 0, -1, &iovec, 1);
+                                        niovecs = medusa_buffer_queryv(tcpsocket->wbuffer, 0, -1, iovecs, MEDUSA_TCPSOCKET_DEFAULT_IOVECS);
                                         if (niovecs < 0) {
                                                 goto bail;
                                         }
                                         if (niovecs == 0) {
                                                 break;
                                         }
-                                        wlength = send(medusa_io_get_fd_unlocked(io), iovec.iov_base, iovec.iov_len, 0);
+                                        memset(&msghdr, 0, sizeof(struct msghdr));
+                                        msghdr.msg_iov    = iovecs;
+                                        msghdr.msg_iovlen = niovecs;
+                                        wlength = sendmsg(medusa_io_get_fd_unlocked(io), &msghdr, 0);
                                         if (wlength < 0) {
                                                 if (errno == EINTR) {
+                                                        if (tcpsocket_can_drain(tcpsocket, io)) {
+                                                                continue;
+                                                        }
                                                         break;
                                                 } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
                                                         break;
@@ -275,6 +462,16 @@ static int tcpsocket_io_onevent (struct medusa_io *io, unsigned int events, void
                                                 if (rc < 0) {
                                                         goto bail;
                                                 }
+                                                if (tcpsocket_can_drain(tcpsocket, io)) {
+                                                        budget -= wlength;
+                                                        if (budget > 0) {
+                                                                continue;
+                                                        }
+                                                        rc = medusa_io_rearm_unlocked(io);
+                                                        if (rc < 0) {
+                                                                goto bail;
+                                                        }
+                                                }
                                         }
                                         break;
                                 }
@@ -319,17 +516,23 @@ static int tcpsocket_io_onevent (struct medusa_io *io, unsigned int events, void
                                 }
                         } else {
                                 int n;
+                                int budget;
+                                int64_t rlength;
                                 int64_t clength;
                                 int64_t niovecs;
                                 struct iovec iovec;
                                 n = 4096;
                                 rc = ioctl(medusa_io_get_fd_unlocked(io), FIONREAD, &n);
-                                if (rc < 0) {
+                                if (rc < 0 || n == 0) {
                                         n = 4096;
                                 }
                                 if (n < 0) {
                                         goto bail;
                                 }
+                                budget = tcpsocket_get_budget(tcpsocket);
+                                if (medusa_io_get_edgetriggered_unlocked(io) > 0) {
+                                        n = MIN(n, budget);
+                                }
                                 while (1) {
                                         niovecs = medusa_buffer_reservev(tcpsocket->rbuffer, n, &iovec, 1);
                                         if (niovecs < 0) {
@@ -343,9 +546,12 @@ static int tcpsocket_io_onevent (struct medusa_io *io, unsigned int events, void
                                                 }
                                                 break;
                                         }
-                                        rc = recv(medusa_io_get_fd_unlocked(io), iovec.iov_base, iovec.iov_len, 0);
-                                        if (rc < 0) {
+                                        rlength = recv(medusa_io_get_fd_unlocked(io), iovec.iov_base, iovec.iov_len, 0);
+                                        if (rlength < 0) {
                                                 if (errno == EINTR) {
+                                                        if (tcpsocket_can_drain(tcpsocket, io)) {
+                                                                continue;
+                                                        }
                                                         break;
                                                 } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
                                                         break;
@@ -359,7 +565,7 @@ static int tcpsocket_io_onevent (struct medusa_io *io, unsigned int events, void
                                                 } else {
                                                         goto bail;
                                                 }
-                                        } else if (rc == 0) {
+                                        } else if (rlength == 0) {
                                                 tcpsocket_set_state(tcpsocket, MEDUSA_TCPSOCKET_STATE_DISCONNECTED);
                                                 rc = medusa_tcpsocket_onevent_unlocked(tcpsocket, MEDUSA_TCPSOCKET_EVENT_DISCONNECTED);
                                                 if (rc < 0) {
@@ -367,7 +573,7 @@ static int tcpsocket_io_onevent (struct medusa_io *io, unsigned int events, void
                                                 }
                                                 break;
                                         } else {
-                                                iovec.iov_len = rc;
+                                                iovec.iov_len = rlength;
                                                 clength = medusa_buffer_commitv(tcpsocket->rbuffer, &iovec, 1);
                                                 if (clength < 0) {
                                                         goto bail;
@@ -390,6 +596,21 @@ static int tcpsocket_io_onevent (struct medusa_io *io, unsigned int events, void
                                                 if (rc < 0) {
                                                         goto bail;
                                                 }
+                                                if (tcpsocket_can_drain(tcpsocket, io)) {
+                                                        budget -= rlength;
+                                                        if (budget > 0) {
+                                                                rc = ioctl(medusa_io_get_fd_unlocked(io), FIONREAD, &n);
+                                                                if (rc < 0 || n <= 0) {
+                                                                        n = 4096;
+                                                                }
+                                                                n = MIN(n, budget);
+                                                                continue;
+                                                        }
+                                                        rc = medusa_io_rearm_unlocked(io);
+                                                        if (rc < 0) {
+                                                                goto bail;
+                                                        }
+                                                }
                                         }
                                         break;
                                  }
@@ -411,6 +632,10 @@ static int tcpsocket_io_onevent (struct medusa_io *io, unsigned int events, void
                 if (fd >= 0) {
                         close(fd);
                 }
+                if (io->subject.flags & MEDUSA_SUBJECT_FLAG_EMBEDDED) {
+                        memset(io, 0, sizeof(struct medusa_io));
+                        tcpsocket_composite_put((struct tcpsocket_composite *) tcpsocket);
+                }
         }
         medusa_monitor_unlock(monitor);
         return 0;
@@ -456,7 +681,7 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_init (struct medus
         return rc;
 }
 
-__attribute__ ((visibility ("default"))) int medusa_tcpsocket_init_with_options_unlocked (struct medusa_tcpsocket *tcpsocket, const struct medusa_tcpsocket_init_options *options)
+static int tcpsocket_init_with_options (struct medusa_tcpsocket *tcpsocket, const struct medusa_tcpsocket_init_options *options, unsigned int flags)
 {
         int rc;
         if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
@@ -473,6 +698,7 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_init_with_options_
         }
         memset(tcpsocket, 0, sizeof(struct medusa_tcpsocket));
         medusa_subject_set_type(&tcpsocket->subject, MEDUSA_SUBJECT_TYPE_TCPSOCKET);
+        tcpsocket->subject.flags |= flags;
         tcpsocket->subject.monitor = NULL;
         tcpsocket_set_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_NONE);
         tcpsocket_set_state(tcpsocket, MEDUSA_TCPSOCKET_STATE_DISCONNECTED);
@@ -502,6 +728,14 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_init_with_options_
         if (rc < 0) {
                 return rc;
         }
+        rc = medusa_tcpsocket_set_edgetriggered_unlocked(tcpsocket, options->edgetriggered);
+        if (rc < 0) {
+                return rc;
+        }
+        rc = medusa_tcpsocket_set_budget_unlocked(tcpsocket, options->budget);
+        if (rc < 0) {
+                return rc;
+        }
         rc = medusa_tcpsocket_set_enabled_unlocked(tcpsocket, options->enabled);
         if (rc < 0) {
                 return rc;
@@ -513,6 +747,11 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_init_with_options_
         return 0;
 }
 
+__attribute__ ((visibility ("default"))) int medusa_tcpsocket_init_with_options_unlocked (struct medusa_tcpsocket *tcpsocket, const struct medusa_tcpsocket_init_options *options)
+{
+        return tcpsocket_init_with_options(tcpsocket, options, 0);
+}
+
 __attribute__ ((visibility ("default"))) int medusa_tcpsocket_init_with_options (struct medusa_tcpsocket *tcpsocket, const struct medusa_tcpsocket_init_options *options)
 {
         int rc;
@@ -587,6 +826,9 @@ __attribute__ ((visibility ("default"))) struct medusa_tcpsocket * medusa_tcpsoc
 {
         int rc;
         struct medusa_tcpsocket *tcpsocket;
+#if defined(MEDUSA_TCPSOCKET_USE_COMPOSITE) && (MEDUSA_TCPSOCKET_USE_COMPOSITE == 1)
+        struct tcpsocket_composite *composite;
+#endif
         if (MEDUSA_IS_ERR_OR_NULL(options)) {
                 return MEDUSA_ERR_PTR(-EINVAL);
         }
@@ -596,6 +838,20 @@ __attribute__ ((visibility ("default"))) struct medusa_tcpsocket * medusa_tcpsoc
         if (MEDUSA_IS_ERR_OR_NULL(options->onevent)) {
                 return MEDUSA_ERR_PTR(-EINVAL);
         }
+#if defined(MEDUSA_TCPSOCKET_USE_COMPOSITE) && (MEDUSA_TCPSOCKET_USE_COMPOSITE == 1)
+#if defined(MEDUSA_TCPSOCKET_USE_POOL) && (MEDUSA_TCPSOCKET_USE_POOL == 1)
+        composite = medusa_pool_malloc(g_pool);
+#else
+        composite = malloc(sizeof(struct tcpsocket_composite));
+#endif
+        if (MEDUSA_IS_ERR_OR_NULL(composite)) {
+                return MEDUSA_ERR_PTR(-ENOMEM);
+        }
+        memset(composite, 0, sizeof(struct tcpsocket_composite));
+        composite->refs = 1;
+        tcpsocket = &composite->tcpsocket;
+        rc = tcpsocket_init_with_options(tcpsocket, options, MEDUSA_SUBJECT_FLAG_EMBEDDED);
+#else
 #if defined(MEDUSA_TCPSOCKET_USE_POOL) && (MEDUSA_TCPSOCKET_USE_POOL == 1)
         tcpsocket = medusa_pool_malloc(g_pool);
 #else
@@ -605,7 +861,8 @@ __attribute__ ((visibility ("default"))) struct medusa_tcpsocket * medusa_tcpsoc
                 return MEDUSA_ERR_PTR(-ENOMEM);
         }
         memset(tcpsocket, 0, sizeof(struct medusa_tcpsocket));
-        rc = medusa_tcpsocket_init_with_options_unlocked(tcpsocket, options);
+        rc = tcpsocket_init_with_options(tcpsocket, options, 0);
+#endif
         if (rc < 0) {
                 medusa_tcpsocket_destroy_unlocked(tcpsocket);
                 return MEDUSA_ERR_PTR(rc);
@@ -732,13 +989,15 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_disable (struct me
 __attribute__ ((visibility ("default"))) int medusa_tcpsocket_set_buffered_unlocked (struct medusa_tcpsocket *tcpsocket, int enabled)
 {
         int rc;
+        struct tcpsocket_composite *composite;
         if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
                 return -EINVAL;
         }
+        composite = tcpsocket_get_composite(tcpsocket);
         if (enabled) {
                 tcpsocket_add_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_BUFFERED);
                 if (MEDUSA_IS_ERR_OR_NULL(tcpsocket->wbuffer)) {
-                        tcpsocket->wbuffer = medusa_buffer_create(MEDUSA_BUFFER_TYPE_DEFAULT);
+                        tcpsocket->wbuffer = tcpsocket_wbuffer_create((composite != NULL) ? &composite->wbuffer : NULL);
                         if (MEDUSA_IS_ERR_OR_NULL(tcpsocket->wbuffer)) {
                                 return MEDUSA_PTR_ERR(tcpsocket->wbuffer);
                         }
@@ -749,7 +1008,7 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_set_buffered_unloc
                         }
                 }
                 if (MEDUSA_IS_ERR_OR_NULL(tcpsocket->rbuffer)) {
-                        tcpsocket->rbuffer = medusa_buffer_create(MEDUSA_BUFFER_TYPE_DEFAULT);
+                        tcpsocket->rbuffer = tcpsocket_rbuffer_create((composite != NULL) ? &composite->rbuffer : NULL);
                         if (MEDUSA_IS_ERR_OR_NULL(tcpsocket->rbuffer)) {
                                 return MEDUSA_PTR_ERR(tcpsocket->rbuffer);
                         }
@@ -805,6 +1064,103 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_get_buffered (cons
         return rc;
 }
 
+__attribute__ ((visibility ("default"))) int medusa_tcpsocket_set_edgetriggered_unlocked (struct medusa_tcpsocket *tcpsocket, int enabled)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
+                return -EINVAL;
+        }
+        if (enabled) {
+                tcpsocket_add_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_EDGETRIGGERED);
+        } else {
+                tcpsocket_del_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_EDGETRIGGERED);
+        }
+        if (!MEDUSA_IS_ERR_OR_NULL(tcpsocket->io)) {
+                if (tcpsocket_get_state(tcpsocket) == MEDUSA_TCPSOCKET_STATE_BINDING ||
+                    tcpsocket_get_state(tcpsocket) == MEDUSA_TCPSOCKET_STATE_BOUND ||
+                    tcpsocket_get_state(tcpsocket) == MEDUSA_TCPSOCKET_STATE_LISTENING) {
+                        return 0;
+                }
+                return medusa_io_set_edgetriggered_unlocked(tcpsocket->io, tcpsocket_has_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_EDGETRIGGERED));
+        }
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_tcpsocket_set_edgetriggered (struct medusa_tcpsocket *tcpsocket, int enabled)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(tcpsocket->subject.monitor);
+        rc = medusa_tcpsocket_set_edgetriggered_unlocked(tcpsocket, enabled);
+        medusa_monitor_unlock(tcpsocket->subject.monitor);
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_tcpsocket_get_edgetriggered_unlocked (const struct medusa_tcpsocket *tcpsocket)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
+                return -EINVAL;
+        }
+        return tcpsocket_has_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_EDGETRIGGERED);
+}
+
+__attribute__ ((visibility ("default"))) int medusa_tcpsocket_get_edgetriggered (const struct medusa_tcpsocket *tcpsocket)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(tcpsocket->subject.monitor);
+        rc = medusa_tcpsocket_get_edgetriggered_unlocked(tcpsocket);
+        medusa_monitor_unlock(tcpsocket->subject.monitor);
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_tcpsocket_set_budget_unlocked (struct medusa_tcpsocket *tcpsocket, int budget)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
+                return -EINVAL;
+        }
+        if (budget < 0) {
+                return -EINVAL;
+        }
+        tcpsocket->budget = budget;
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_tcpsocket_set_budget (struct medusa_tcpsocket *tcpsocket, int budget)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(tcpsocket->subject.monitor);
+        rc = medusa_tcpsocket_set_budget_unlocked(tcpsocket, budget);
+        medusa_monitor_unlock(tcpsocket->subject.monitor);
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_tcpsocket_get_budget_unlocked (const struct medusa_tcpsocket *tcpsocket)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
+                return -EINVAL;
+        }
+        return tcpsocket_get_budget(tcpsocket);
+}
+
+__attribute__ ((visibility ("default"))) int medusa_tcpsocket_get_budget (const struct medusa_tcpsocket *tcpsocket)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(tcpsocket->subject.monitor);
+        rc = medusa_tcpsocket_get_budget_unlocked(tcpsocket);
+        medusa_monitor_unlock(tcpsocket->subject.monitor);
+        return rc;
+}
+
 __attribute__ ((visibility ("default"))) int medusa_tcpsocket_set_nonblocking_unlocked (struct medusa_tcpsocket *tcpsocket, int enabled)
 {
         if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
@@ -1084,6 +1440,7 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_get_backlog (const
 __attribute__ ((visibility ("default"))) int medusa_tcpsocket_set_read_timeout_unlocked (struct medusa_tcpsocket *tcpsocket, double timeout)
 {
         int rc;
+        struct tcpsocket_composite *composite;
         if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
                 return -EINVAL;
         }
@@ -1094,10 +1451,15 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_set_read_timeout_u
                 }
         } else {
                 if (MEDUSA_IS_ERR_OR_NULL(tcpsocket->rtimer)) {
-                        tcpsocket->rtimer = medusa_timer_create_unlocked(tcpsocket->subject.monitor, tcpsocket_rtimer_onevent, tcpsocket);
+                        composite = tcpsocket_get_composite(tcpsocket);
+                        tcpsocket->rtimer = tcpsocket_timer_create(tcpsocket, (composite != NULL) ? &composite->rtimer : NULL, tcpsocket_rtimer_onevent);
                         if (MEDUSA_IS_ERR_OR_NULL(tcpsocket->rtimer)) {
                                 return MEDUSA_PTR_ERR(tcpsocket->rtimer);
                         }
+                        rc = medusa_timer_set_coarse_unlocked(tcpsocket->rtimer, 1);
+                        if (rc < 0) {
+                                return rc;
+                        }
                 }
                 rc = medusa_timer_set_interval_unlocked(tcpsocket->rtimer, timeout);
                 if (rc < 0) {
@@ -1155,6 +1517,7 @@ __attribute__ ((visibility ("default"))) double medusa_tcpsocket_get_read_timeou
 __attribute__ ((visibility ("default"))) int medusa_tcpsocket_set_connect_timeout_unlocked (struct medusa_tcpsocket *tcpsocket, double timeout)
 {
         int rc;
+        struct tcpsocket_composite *composite;
         if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
                 return -EINVAL;
         }
@@ -1165,10 +1528,15 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_set_connect_timeou
                 }
         } else {
                 if (MEDUSA_IS_ERR_OR_NULL(tcpsocket->ctimer)) {
-                        tcpsocket->ctimer = medusa_timer_create_unlocked(tcpsocket->subject.monitor, tcpsocket_ctimer_onevent, tcpsocket);
+                        composite = tcpsocket_get_composite(tcpsocket);
+                        tcpsocket->ctimer = tcpsocket_timer_create(tcpsocket, (composite != NULL) ? &composite->ctimer : NULL, tcpsocket_ctimer_onevent);
                         if (MEDUSA_IS_ERR_OR_NULL(tcpsocket->ctimer)) {
                                 return MEDUSA_PTR_ERR(tcpsocket->ctimer);
                         }
+                        rc = medusa_timer_set_coarse_unlocked(tcpsocket->ctimer, 1);
+                        if (rc < 0) {
+                                return rc;
+                        }
                 }
                 rc = medusa_timer_set_interval_unlocked(tcpsocket->ctimer, timeout);
                 if (rc < 0) {
@@ -1588,7 +1956,7 @@ ipv6:
         io_init_options.onevent = tcpsocket_io_onevent;
         io_init_options.context = tcpsocket;
         io_init_options.enabled = tcpsocket_has_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_ENABLED);
-        tcpsocket->io = medusa_io_create_with_options_unlocked(&io_init_options);
+        tcpsocket->io = tcpsocket_io_create(tcpsocket, &io_init_options);
         if (MEDUSA_IS_ERR_OR_NULL(tcpsocket->io)) {
                 ret = MEDUSA_PTR_ERR(tcpsocket->io);
                 goto bail;
@@ -1785,12 +2153,14 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_connect_unlocked (
                 io_init_options.events  = MEDUSA_IO_EVENT_IN;
                 io_init_options.onevent = tcpsocket_io_onevent;
                 io_init_options.context = tcpsocket;
+                io_init_options.edgetriggered = tcpsocket_has_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_EDGETRIGGERED);
                 io_init_options.enabled = tcpsocket_has_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_ENABLED);
-                tcpsocket->io = medusa_io_create_with_options_unlocked(&io_init_options);
+                tcpsocket->io = tcpsocket_io_create(tcpsocket, &io_init_options);
                 if (MEDUSA_IS_ERR_OR_NULL(tcpsocket->io)) {
                         ret = MEDUSA_PTR_ERR(tcpsocket->io);
                         goto bail;
                 }
+                tcpsocket_set_busypoll(tcpsocket, medusa_io_get_fd_unlocked(tcpsocket->io));
                 {
                         int rc;
                         int flags;
@@ -1920,12 +2290,14 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_attach_unlocked (s
         io_init_options.events  = MEDUSA_IO_EVENT_IN;
         io_init_options.onevent = tcpsocket_io_onevent;
         io_init_options.context = tcpsocket;
+        io_init_options.edgetriggered = tcpsocket_has_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_EDGETRIGGERED);
         io_init_options.enabled = tcpsocket_has_flag(tcpsocket, MEDUSA_TCPSOCKET_FLAG_ENABLED);
-        tcpsocket->io = medusa_io_create_with_options_unlocked(&io_init_options);
+        tcpsocket->io = tcpsocket_io_create(tcpsocket, &io_init_options);
         if (MEDUSA_IS_ERR_OR_NULL(tcpsocket->io)) {
                 ret = MEDUSA_PTR_ERR(tcpsocket->io);
                 goto bail;
         }
+        tcpsocket_set_busypoll(tcpsocket, medusa_io_get_fd_unlocked(tcpsocket->io));
         {
                 int rc;
                 int flags;
@@ -2072,6 +2444,8 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_accept_init_with_o
         accepted_options.nodelay     = options->nodelay;
         accepted_options.enabled     = options->enabled;
         accepted_options.buffered    = options->buffered;
+        accepted_options.edgetriggered = options->edgetriggered;
+        accepted_options.budget      = options->budget;
         rc = medusa_tcpsocket_init_with_options_unlocked(accepted, &accepted_options);
         if (rc < 0) {
                 close(fd);
@@ -2082,13 +2456,15 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_accept_init_with_o
         io_init_options.events  = MEDUSA_IO_EVENT_IN;
         io_init_options.onevent = tcpsocket_io_onevent;
         io_init_options.context = accepted;
+        io_init_options.edgetriggered = tcpsocket_has_flag(accepted, MEDUSA_TCPSOCKET_FLAG_EDGETRIGGERED);
         io_init_options.enabled = tcpsocket_has_flag(accepted, MEDUSA_TCPSOCKET_FLAG_ENABLED);
-        accepted->io = medusa_io_create_with_options_unlocked(&io_init_options);
+        accepted->io = tcpsocket_io_create(accepted, &io_init_options);
         if (MEDUSA_IS_ERR_OR_NULL(accepted->io)) {
                 rc = MEDUSA_PTR_ERR(accepted->io);
                 medusa_tcpsocket_destroy_unlocked(accepted);
                 return rc;
         }
+        tcpsocket_set_busypoll(accepted, medusa_io_get_fd_unlocked(accepted->io));
         {
                 int rc;
                 int flags;
@@ -2185,6 +2561,8 @@ __attribute__ ((visibility ("default"))) struct medusa_tcpsocket * medusa_tcpsoc
         accepted_options.nodelay     = options->nodelay;
         accepted_options.enabled     = options->enabled;
         accepted_options.buffered    = options->buffered;
+        accepted_options.edgetriggered = options->edgetriggered;
+        accepted_options.budget      = options->budget;
         accepted = medusa_tcpsocket_create_with_options_unlocked(&accepted_options);
         if (MEDUSA_IS_ERR_OR_NULL(accepted)) {
                 close(fd);
@@ -2195,13 +2573,15 @@ __attribute__ ((visibility ("default"))) struct medusa_tcpsocket * medusa_tcpsoc
         io_init_options.events  = MEDUSA_IO_EVENT_IN;
         io_init_options.onevent = tcpsocket_io_onevent;
         io_init_options.context = accepted;
+        io_init_options.edgetriggered = tcpsocket_has_flag(accepted, MEDUSA_TCPSOCKET_FLAG_EDGETRIGGERED);
         io_init_options.enabled = tcpsocket_has_flag(accepted, MEDUSA_TCPSOCKET_FLAG_ENABLED);
-        accepted->io = medusa_io_create_with_options_unlocked(&io_init_options);
+        accepted->io = tcpsocket_io_create(accepted, &io_init_options);
         if (MEDUSA_IS_ERR_OR_NULL(accepted->io)) {
                 rc = MEDUSA_PTR_ERR(accepted->io);
                 medusa_tcpsocket_destroy_unlocked(accepted);
                 return MEDUSA_ERR_PTR(rc);
         }
+        tcpsocket_set_busypoll(accepted, medusa_io_get_fd_unlocked(accepted->io));
         {
                 int rc;
                 int flags;
@@ -2260,17 +2640,22 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_onevent_unlocked (
 {
         int ret;
         struct medusa_monitor *monitor;
+        struct medusa_monitor_dispatch dispatch;
+        struct tcpsocket_composite *composite;
         ret = 0;
         monitor = tcpsocket->subject.monitor;
         if (tcpsocket->onevent != NULL) {
                 if ((medusa_subject_is_active(&tcpsocket->subject)) ||
                     (events & MEDUSA_TCPSOCKET_EVENT_DESTROY)) {
+                        medusa_monitor_dispatch_begin_unlocked(monitor, &dispatch, &tcpsocket->subject, (void (*) (void)) tcpsocket->onevent);
                         medusa_monitor_unlock(monitor);
                         ret = tcpsocket->onevent(tcpsocket, events, tcpsocket->context);
                         medusa_monitor_lock(monitor);
+                        medusa_monitor_dispatch_end_unlocked(monitor, &dispatch);
                 }
         }
         if (events & MEDUSA_TCPSOCKET_EVENT_DESTROY) {
+                composite = tcpsocket_get_composite(tcpsocket);
                 if (!MEDUSA_IS_ERR_OR_NULL(tcpsocket->ctimer)) {
                         medusa_timer_destroy_unlocked(tcpsocket->ctimer);
                         tcpsocket->ctimer = NULL;
@@ -2291,7 +2676,10 @@ __attribute__ ((visibility ("default"))) int medusa_tcpsocket_onevent_unlocked (
                         medusa_buffer_destroy(tcpsocket->rbuffer);
                         tcpsocket->rbuffer = NULL;
                 }
-                if (tcpsocket->subject.flags & MEDUSA_SUBJECT_FLAG_ALLOC) {
+                if (composite != NULL) {
+                        memset(tcpsocket, 0, sizeof(struct medusa_tcpsocket));
+                        tcpsocket_composite_put(composite);
+                } else if (tcpsocket->subject.flags & MEDUSA_SUBJECT_FLAG_ALLOC) {
 #if defined(MEDUSA_TCPSOCKET_USE_POOL) && (MEDUSA_TCPSOCKET_USE_POOL == 1)
                         medusa_pool_free(tcpsocket);
 #else
@@ -2433,8 +2821,12 @@ __attribute__ ((visibility ("default"))) const char * medusa_tcpsocket_event_str
 __attribute__ ((constructor)) static void tcpsocket_constructor (void)
 {
 #if defined(MEDUSA_TCPSOCKET_USE_POOL) && (MEDUSA_TCPSOCKET_USE_POOL == 1)
+#if defined(MEDUSA_TCPSOCKET_USE_COMPOSITE) && (MEDUSA_TCPSOCKET_USE_COMPOSITE == 1)
+        g_pool = medusa_pool_create("medusa-tcpsocket", sizeof(struct tcpsocket_composite), 0, 0, MEDUSA_POOL_FLAG_DEFAULT | MEDUSA_POOL_FLAG_THREAD_SAFE, NULL, NULL, NULL);
+#else
         g_pool = medusa_pool_create("medusa-tcpsocket", sizeof(struct medusa_tcpsocket), 0, 0, MEDUSA_POOL_FLAG_DEFAULT | MEDUSA_POOL_FLAG_THREAD_SAFE, NULL, NULL, NULL);
 #endif
+#endif
 }
 
 __attribute__ ((destructor)) static void tcpsocket_destructor (void)
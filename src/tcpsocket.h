@@ -88,6 +88,8 @@ struct medusa_tcpsocket_init_options {
         int backlog;
         int nodelay;
         int buffered;
+        int edgetriggered;
+        int budget;
         int enabled;
 };
 
@@ -97,6 +99,8 @@ struct medusa_tcpsocket_accept_options {
         int nonblocking;
         int nodelay;
         int buffered;
+        int edgetriggered;
+        int budget;
         int enabled;
 };
 
@@ -122,6 +126,12 @@ int medusa_tcpsocket_disable (struct medusa_tcpsocket *tcpsocket);
 int medusa_tcpsocket_set_buffered (struct medusa_tcpsocket *tcpsocket, int enabled);
 int medusa_tcpsocket_get_buffered (const struct medusa_tcpsocket *tcpsocket);
 
+int medusa_tcpsocket_set_edgetriggered (struct medusa_tcpsocket *tcpsocket, int enabled);
+int medusa_tcpsocket_get_edgetriggered (const struct medusa_tcpsocket *tcpsocket);
+
+int medusa_tcpsocket_set_budget (struct medusa_tcpsocket *tcpsocket, int budget);
+int medusa_tcpsocket_get_budget (const struct medusa_tcpsocket *tcpsocket);
+
 int medusa_tcpsocket_set_nonblocking (struct medusa_tcpsocket *tcpsocket, int enabled);
 int medusa_tcpsocket_get_nonblocking (const struct medusa_tcpsocket *tcpsocket);
 
@@ -13,6 +13,7 @@ int medusa_timer_create_singleshot_timespec_unlocked (struct medusa_monitor *mon
 
 struct medusa_timer * medusa_timer_create_unlocked (struct medusa_monitor *monitor, int (*onevent) (struct medusa_timer *timer, unsigned int events, void *context, ...), void *context);
 struct medusa_timer * medusa_timer_create_with_options_unlocked (const struct medusa_timer_init_options *options);
+int medusa_timer_create_bulk_unlocked (const struct medusa_timer_init_options *options, unsigned int count, struct medusa_timer **timers);
 
 void medusa_timer_uninit_unlocked (struct medusa_timer *timer);
 void medusa_timer_destroy_unlocked (struct medusa_timer *timer);
@@ -25,6 +26,7 @@ double medusa_timer_get_initial_unlocked (const struct medusa_timer *timer);
 int medusa_timer_set_interval_unlocked (struct medusa_timer *timer, double interval);
 int medusa_timer_set_interval_timeval_unlocked (struct medusa_timer *timer, const struct timeval *interval);
 int medusa_timer_set_interval_timespec_unlocked (struct medusa_timer *timer, const struct timespec *interval);
+int medusa_timer_set_interval_bulk_unlocked (struct medusa_timer **timers, unsigned int count, double interval);
 double medusa_timer_get_interval_unlocked (const struct medusa_timer *timer);
 
 double medusa_timer_get_remaining_time_unlocked (const struct medusa_timer *timer);
@@ -37,6 +39,12 @@ int medusa_timer_get_singleshot_unlocked (const struct medusa_timer *timer);
 int medusa_timer_set_resolution_unlocked (struct medusa_timer *timer, unsigned int resolution);
 unsigned int medusa_timer_get_resolution_unlocked (const struct medusa_timer *timer);
 
+int medusa_timer_set_slack_unlocked (struct medusa_timer *timer, double slack);
+double medusa_timer_get_slack_unlocked (const struct medusa_timer *timer);
+
+int medusa_timer_set_coarse_unlocked (struct medusa_timer *timer, int coarse);
+int medusa_timer_get_coarse_unlocked (const struct medusa_timer *timer);
+
 int medusa_timer_set_enabled_unlocked (struct medusa_timer *timer, int enabled);
 int medusa_timer_get_enabled_unlocked (const struct medusa_timer *timer);
 
@@ -12,11 +12,14 @@ struct medusa_timer {
 
         struct timespec initial;
         struct timespec interval;
+        struct timespec slack;
         int (*onevent) (struct medusa_timer *timer, unsigned int events, void *context, ...);
         void *context;
 
+        struct timespec _deadline;
         struct timespec _timespec;
         unsigned int _position;
+        struct wheel_entry _wheel;
 };
 
 int medusa_timer_init (struct medusa_timer *timer, struct medusa_monitor *monitor, int (*onevent) (struct medusa_timer *timer, unsigned int events, void *context, ...), void *context);
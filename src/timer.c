@@ -9,6 +9,7 @@
 #include "error.h"
 #include "pool.h"
 #include "queue.h"
+#include "wheel.h"
 #include "monitor.h"
 #include "monitor-private.h"
 #include "subject-struct.h"
@@ -33,6 +34,7 @@ enum {
         MEDUSA_TIMER_FLAG_FIRED         = 0x00000080,
         MEDUSA_TIMER_FLAG_INITIAL       = 0x00000100,
         MEDUSA_TIMER_FLAG_INTERVAL      = 0x00000200,
+        MEDUSA_TIMER_FLAG_COARSE        = 0x00000400,
 #define MEDUSA_TIMER_FLAG_ENABLED       MEDUSA_TIMER_FLAG_ENABLED
 #define MEDUSA_TIMER_FLAG_SINGLE_SHOT   MEDUSA_TIMER_FLAG_SINGLE_SHOT
 #define MEDUSA_TIMER_FLAG_AUTO_DESTROY  MEDUSA_TIMER_FLAG_AUTO_DESTROY
@@ -43,6 +45,7 @@ enum {
 #define MEDUSA_TIMER_FLAG_FIRED         MEDUSA_TIMER_FLAG_FIRED
 #define MEDUSA_TIMER_FLAG_INITIAL       MEDUSA_TIMER_FLAG_INITIAL
 #define MEDUSA_TIMER_FLAG_INTERVAL      MEDUSA_TIMER_FLAG_INTERVAL
+#define MEDUSA_TIMER_FLAG_COARSE        MEDUSA_TIMER_FLAG_COARSE
 };
 
 static int timer_set_initial_timespec (struct medusa_timer *timer, const struct timespec *initial)
@@ -137,6 +140,57 @@ static int timer_set_resolution (struct medusa_timer *timer, unsigned int resolu
         return 0;
 }
 
+static int timer_set_slack (struct medusa_timer *timer, double slack)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                return -EINVAL;
+        }
+        if (slack < 0) {
+                return -EINVAL;
+        }
+        timer->slack.tv_sec = (long long) slack;
+        timer->slack.tv_nsec = (long long) ((slack - timer->slack.tv_sec) * 1e9);
+        return 0;
+}
+
+static void timer_apply_slack (struct medusa_timer *timer)
+{
+        unsigned long long mask;
+        unsigned long long limit;
+        unsigned long long expires;
+        if (!medusa_timespec_isset(&timer->slack)) {
+                return;
+        }
+        /*
+         * pick the value with the most trailing zero bits inside
+         * [expires, expires + slack], so that timers with overlapping
+         * windows end up on the very same deadline.
+         */
+        expires = timer->_timespec.tv_sec * 1000000000ull + timer->_timespec.tv_nsec;
+        limit = expires + timer->slack.tv_sec * 1000000000ull + timer->slack.tv_nsec;
+        mask = expires ^ limit;
+        if (mask == 0) {
+                return;
+        }
+        mask = (1ull << (63 - __builtin_clzll(mask))) - 1;
+        limit &= ~mask;
+        timer->_timespec.tv_sec = limit / 1000000000ull;
+        timer->_timespec.tv_nsec = limit % 1000000000ull;
+}
+
+static int timer_set_coarse (struct medusa_timer *timer, int coarse)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                return -EINVAL;
+        }
+        if (coarse) {
+                timer->flags |= MEDUSA_TIMER_FLAG_COARSE;
+        } else {
+                timer->flags &= ~MEDUSA_TIMER_FLAG_COARSE;
+        }
+        return 0;
+}
+
 static int timer_set_enabled (struct medusa_timer *timer, int enabled)
 {
         if (MEDUSA_IS_ERR_OR_NULL(timer)) {
@@ -211,7 +265,9 @@ __attribute__ ((visibility ("default"))) int medusa_timer_init_with_options_unlo
         timer_set_initial(timer, options->initial);
         timer_set_interval(timer, options->interval);
         timer_set_resolution(timer, options->resolution);
+        timer_set_slack(timer, options->slack);
         timer_set_singleshot(timer, options->singleshot);
+        timer_set_coarse(timer, options->coarse);
         timer_set_enabled(timer, options->enabled);
         medusa_subject_set_type(&timer->subject, MEDUSA_SUBJECT_TYPE_TIMER);
         timer->subject.monitor = NULL;
@@ -418,6 +474,79 @@ __attribute__ ((visibility ("default"))) struct medusa_timer * medusa_timer_crea
         return rc;
 }
 
+__attribute__ ((visibility ("default"))) int medusa_timer_create_bulk_unlocked (const struct medusa_timer_init_options *options, unsigned int count, struct medusa_timer **timers)
+{
+        int rc;
+        unsigned int i;
+#if !defined(MEDUSA_TIMER_USE_POOL) || (MEDUSA_TIMER_USE_POOL == 0)
+        struct medusa_timer *timer;
+#endif
+        if (MEDUSA_IS_ERR_OR_NULL(options)) {
+                return -EINVAL;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(timers)) {
+                return -EINVAL;
+        }
+        for (i = 0; i < count; i++) {
+                if (MEDUSA_IS_ERR_OR_NULL(options[i].monitor)) {
+                        return -EINVAL;
+                }
+                if (options[i].monitor != options[0].monitor) {
+                        return -EINVAL;
+                }
+                if (MEDUSA_IS_ERR_OR_NULL(options[i].onevent)) {
+                        return -EINVAL;
+                }
+        }
+#if defined(MEDUSA_TIMER_USE_POOL) && (MEDUSA_TIMER_USE_POOL == 1)
+        rc = medusa_pool_malloc_bulk(g_pool, (void **) timers, count);
+        if (rc < 0) {
+                return rc;
+        }
+        for (i = 0; i < count; i++) {
+                rc = medusa_timer_init_with_options_unlocked(timers[i], &options[i]);
+                if (rc < 0) {
+                        /* timers[i] is not attached to the monitor, hand it back raw with the rest */
+                        medusa_pool_free_bulk((void **) &timers[i], count - i);
+                        goto bail;
+                }
+                timers[i]->subject.flags |= MEDUSA_SUBJECT_FLAG_ALLOC;
+        }
+        return 0;
+#else
+        for (i = 0; i < count; i++) {
+                timer = medusa_timer_create_with_options_unlocked(&options[i]);
+                if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                        rc = MEDUSA_PTR_ERR(timer);
+                        goto bail;
+                }
+                timers[i] = timer;
+        }
+        return 0;
+#endif
+bail:   memset(&timers[i], 0, sizeof(struct medusa_timer *) * (count - i));
+        while (i-- > 0) {
+                medusa_timer_destroy_unlocked(timers[i]);
+                timers[i] = NULL;
+        }
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_timer_create_bulk (const struct medusa_timer_init_options *options, unsigned int count, struct medusa_timer **timers)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(options)) {
+                return -EINVAL;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(options->monitor)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(options->monitor);
+        rc = medusa_timer_create_bulk_unlocked(options, count, timers);
+        medusa_monitor_unlock(options->monitor);
+        return rc;
+}
+
 __attribute__ ((visibility ("default"))) void medusa_timer_destroy_unlocked (struct medusa_timer *timer)
 {
         if (MEDUSA_IS_ERR_OR_NULL(timer)) {
@@ -565,6 +694,59 @@ __attribute__ ((visibility ("default"))) int medusa_timer_set_interval (struct m
         return rc;
 }
 
+/*
+ * every entry is checked before any timer is changed, so an invalid batch
+ * leaves all timers untouched. past that only an internal monitor error can
+ * stop the loop, the timers before the failing one keep their new interval.
+ */
+__attribute__ ((visibility ("default"))) int medusa_timer_set_interval_bulk_unlocked (struct medusa_timer **timers, unsigned int count, double interval)
+{
+        int rc;
+        unsigned int i;
+        if (MEDUSA_IS_ERR_OR_NULL(timers)) {
+                return -EINVAL;
+        }
+        if (interval < 0) {
+                return -EINVAL;
+        }
+        for (i = 0; i < count; i++) {
+                if (MEDUSA_IS_ERR_OR_NULL(timers[i])) {
+                        return -EINVAL;
+                }
+                if (MEDUSA_IS_ERR_OR_NULL(timers[i]->subject.monitor)) {
+                        return -EINVAL;
+                }
+                if (timers[i]->subject.monitor != timers[0]->subject.monitor) {
+                        return -EINVAL;
+                }
+        }
+        for (i = 0; i < count; i++) {
+                rc = medusa_timer_set_interval_unlocked(timers[i], interval);
+                if (rc < 0) {
+                        return rc;
+                }
+        }
+        return 0;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_timer_set_interval_bulk (struct medusa_timer **timers, unsigned int count, double interval)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(timers)) {
+                return -EINVAL;
+        }
+        if (count == 0) {
+                return 0;
+        }
+        if (MEDUSA_IS_ERR_OR_NULL(timers[0])) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(timers[0]->subject.monitor);
+        rc = medusa_timer_set_interval_bulk_unlocked(timers, count, interval);
+        medusa_monitor_unlock(timers[0]->subject.monitor);
+        return rc;
+}
+
 __attribute__ ((visibility ("default"))) int medusa_timer_set_interval_timeval_unlocked (struct medusa_timer *timer, const struct timeval *interval)
 {
         struct timespec timespec;
@@ -842,6 +1024,99 @@ __attribute__ ((visibility ("default"))) unsigned int medusa_timer_get_resolutio
         return rc;
 }
 
+__attribute__ ((visibility ("default"))) int medusa_timer_set_slack_unlocked (struct medusa_timer *timer, double slack)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                return -EINVAL;
+        }
+        rc = timer_set_slack(timer, slack);
+        if (rc < 0) {
+                return rc;
+        }
+        return medusa_monitor_mod_unlocked(&timer->subject);
+}
+
+__attribute__ ((visibility ("default"))) int medusa_timer_set_slack (struct medusa_timer *timer, double slack)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(timer->subject.monitor);
+        rc = medusa_timer_set_slack_unlocked(timer, slack);
+        medusa_monitor_unlock(timer->subject.monitor);
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) double medusa_timer_get_slack_unlocked (const struct medusa_timer *timer)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                return -EINVAL;
+        }
+        return timer->slack.tv_sec + timer->slack.tv_nsec * 1e-9;
+}
+
+__attribute__ ((visibility ("default"))) double medusa_timer_get_slack (const struct medusa_timer *timer)
+{
+        double rc;
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(timer->subject.monitor);
+        rc = medusa_timer_get_slack_unlocked(timer);
+        medusa_monitor_unlock(timer->subject.monitor);
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_timer_set_coarse_unlocked (struct medusa_timer *timer, int coarse)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                return -EINVAL;
+        }
+        if (!!(timer->flags & MEDUSA_TIMER_FLAG_COARSE) == !!coarse) {
+                return 0;
+        }
+        rc = timer_set_coarse(timer, coarse);
+        if (rc < 0) {
+                return rc;
+        }
+        return medusa_monitor_mod_unlocked(&timer->subject);
+}
+
+__attribute__ ((visibility ("default"))) int medusa_timer_set_coarse (struct medusa_timer *timer, int coarse)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(timer->subject.monitor);
+        rc = medusa_timer_set_coarse_unlocked(timer, coarse);
+        medusa_monitor_unlock(timer->subject.monitor);
+        return rc;
+}
+
+__attribute__ ((visibility ("default"))) int medusa_timer_get_coarse_unlocked (const struct medusa_timer *timer)
+{
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                return -EINVAL;
+        }
+        return !!(timer->flags & MEDUSA_TIMER_FLAG_COARSE);
+}
+
+__attribute__ ((visibility ("default"))) int medusa_timer_get_coarse (const struct medusa_timer *timer)
+{
+        int rc;
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                return -EINVAL;
+        }
+        medusa_monitor_lock(timer->subject.monitor);
+        rc = medusa_timer_get_coarse_unlocked(timer);
+        medusa_monitor_unlock(timer->subject.monitor);
+        return rc;
+}
+
 __attribute__ ((visibility ("default"))) int medusa_timer_set_enabled_unlocked (struct medusa_timer *timer, int enabled)
 {
         int rc;
@@ -912,22 +1187,23 @@ __attribute__ ((visibility ("default"))) int medusa_timer_update_timespec_unlock
         unsigned int resolution;
         if (timer->flags & MEDUSA_TIMER_FLAG_FIRED) {
                 if (timer->flags & MEDUSA_TIMER_FLAG_INTERVAL) {
-                        medusa_timespec_add(&timer->interval, now, &timer->_timespec);
+                        medusa_timespec_add(&timer->interval, now, &timer->_deadline);
                 } else {
-                        medusa_timespec_add(&timer->_timespec, &timer->interval, &timer->_timespec);
+                        medusa_timespec_add(&timer->_deadline, &timer->interval, &timer->_deadline);
                 }
         } else {
                 if (medusa_timespec_isset(&timer->initial)) {
-                        medusa_timespec_add(&timer->initial, now, &timer->_timespec);
+                        medusa_timespec_add(&timer->initial, now, &timer->_deadline);
                 } else {
-                        medusa_timespec_add(&timer->interval, now, &timer->_timespec);
+                        medusa_timespec_add(&timer->interval, now, &timer->_deadline);
                 }
         }
         timer->flags &= ~MEDUSA_TIMER_FLAG_INITIAL;
         timer->flags &= ~MEDUSA_TIMER_FLAG_INTERVAL;
-        if (!medusa_timespec_isset(&timer->_timespec)) {
+        if (!medusa_timespec_isset(&timer->_deadline)) {
                 return -EIO;
         }
+        timer->_timespec = timer->_deadline;
         resolution = medusa_timer_get_resolution_unlocked(timer);
         if (resolution == MEDUSA_TIMER_RESOLUTION_NANOSECOMDS) {
         } else if (resolution == MEDUSA_TIMER_RESOLUTION_MICROSECONDS) {
@@ -947,6 +1223,7 @@ __attribute__ ((visibility ("default"))) int medusa_timer_update_timespec_unlock
                 timer->_timespec.tv_sec++;
                 timer->_timespec.tv_nsec -= 1000000000;
         }
+        timer_apply_slack(timer);
         return 0;
 }
 
@@ -973,8 +1250,11 @@ __attribute__ ((visibility ("default"))) struct medusa_monitor * medusa_timer_ge
 __attribute__ ((visibility ("default"))) int medusa_timer_onevent_unlocked (struct medusa_timer *timer, unsigned int events)
 {
         int rc;
+        unsigned int flags;
         struct medusa_monitor *monitor;
+        struct medusa_monitor_dispatch dispatch;
         rc = 0;
+        flags = timer->subject.flags;
         monitor = timer->subject.monitor;
         if (events & MEDUSA_TIMER_EVENT_TIMEOUT) {
                 timer->flags |= MEDUSA_TIMER_FLAG_FIRED;
@@ -989,9 +1269,11 @@ __attribute__ ((visibility ("default"))) int medusa_timer_onevent_unlocked (stru
         if (timer->onevent != NULL) {
                 if ((medusa_subject_is_active(&timer->subject)) ||
                     (events & MEDUSA_TIMER_EVENT_DESTROY)) {
+                        medusa_monitor_dispatch_begin_unlocked(monitor, &dispatch, &timer->subject, (void (*) (void)) timer->onevent);
                         medusa_monitor_unlock(monitor);
                         rc = timer->onevent(timer, events, timer->context);
                         medusa_monitor_lock(monitor);
+                        medusa_monitor_dispatch_end_unlocked(monitor, &dispatch);
                 }
         }
         if (events & MEDUSA_TIMER_EVENT_TIMEOUT) {
@@ -1000,13 +1282,13 @@ __attribute__ ((visibility ("default"))) int medusa_timer_onevent_unlocked (stru
                 }
         }
         if (events & MEDUSA_TIMER_EVENT_DESTROY) {
-                if (timer->subject.flags & MEDUSA_SUBJECT_FLAG_ALLOC) {
+                if (flags & MEDUSA_SUBJECT_FLAG_ALLOC) {
 #if defined(MEDUSA_TIMER_USE_POOL) && (MEDUSA_TIMER_USE_POOL == 1)
                         medusa_pool_free(timer);
 #else
                         free(timer);
 #endif
-                } else {
+                } else if (!(flags & MEDUSA_SUBJECT_FLAG_EMBEDDED)) {
                         memset(timer, 0, sizeof(struct medusa_timer));
                 }
         }
@@ -35,6 +35,8 @@ struct medusa_timer_init_options {
         double interval;
         int singleshot;
         unsigned int resolution;
+        double slack;
+        int coarse;
         int enabled;
 };
 
@@ -51,6 +53,7 @@ int medusa_timer_create_singleshot_timespec (struct medusa_monitor *monitor, con
 
 struct medusa_timer * medusa_timer_create (struct medusa_monitor *monitor, int (*onevent) (struct medusa_timer *timer, unsigned int events, void *context, ...), void *context);
 struct medusa_timer * medusa_timer_create_with_options (const struct medusa_timer_init_options *options);
+int medusa_timer_create_bulk (const struct medusa_timer_init_options *options, unsigned int count, struct medusa_timer **timers);
 void medusa_timer_destroy (struct medusa_timer *timer);
 
 int medusa_timer_set_initial (struct medusa_timer *timer, double initial);
@@ -61,6 +64,7 @@ double medusa_timer_get_initial (const struct medusa_timer *timer);
 int medusa_timer_set_interval (struct medusa_timer *timer, double interval);
 int medusa_timer_set_interval_timeval (struct medusa_timer *timer, const struct timeval *interval);
 int medusa_timer_set_interval_timespec (struct medusa_timer *timer, const struct timespec *interval);
+int medusa_timer_set_interval_bulk (struct medusa_timer **timers, unsigned int count, double interval);
 double medusa_timer_get_interval (const struct medusa_timer *timer);
 
 double medusa_timer_get_remaining_time (const struct medusa_timer *timer);
@@ -73,6 +77,12 @@ int medusa_timer_get_singleshot (const struct medusa_timer *timer);
 int medusa_timer_set_resolution (struct medusa_timer *timer, unsigned int resolution);
 unsigned int medusa_timer_get_resolution (const struct medusa_timer *timer);
 
+int medusa_timer_set_slack (struct medusa_timer *timer, double slack);
+double medusa_timer_get_slack (const struct medusa_timer *timer);
+
+int medusa_timer_set_coarse (struct medusa_timer *timer, int coarse);
+int medusa_timer_get_coarse (const struct medusa_timer *timer);
+
 int medusa_timer_set_enabled (struct medusa_timer *timer, int enabled);
 int medusa_timer_get_enabled (const struct medusa_timer *timer);
 
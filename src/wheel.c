@@ -0,0 +1,304 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "queue.h"
+#include "wheel.h"
+
+#define WHEEL_ROOT_BITS         8
+#define WHEEL_ROOT_SIZE         (1 << WHEEL_ROOT_BITS)
+#define WHEEL_ROOT_MASK         (WHEEL_ROOT_SIZE - 1)
+#define WHEEL_LEVEL_BITS        6
+#define WHEEL_LEVEL_SIZE        (1 << WHEEL_LEVEL_BITS)
+#define WHEEL_LEVEL_MASK        (WHEEL_LEVEL_SIZE - 1)
+#define WHEEL_LEVELS            4
+
+#define wheel_level_shift(l)    (WHEEL_ROOT_BITS + ((l) * WHEEL_LEVEL_BITS))
+#define WHEEL_MAX_INTERVAL      ((1ULL << wheel_level_shift(WHEEL_LEVELS)) - 1)
+
+struct wheel_head {
+        unsigned long long current;
+        unsigned int count;
+        uint64_t rmap[WHEEL_ROOT_SIZE / 64];
+        uint64_t lmap[WHEEL_LEVELS];
+        struct wheel_list root[WHEEL_ROOT_SIZE];
+        struct wheel_list levels[WHEEL_LEVELS][WHEEL_LEVEL_SIZE];
+};
+
+struct wheel_head * wheel_create (unsigned long long now)
+{
+        unsigned int i;
+        unsigned int l;
+        struct wheel_head *head;
+        head = malloc(sizeof(struct wheel_head));
+        if (head == NULL) {
+                goto bail;
+        }
+        memset(head, 0, sizeof(struct wheel_head));
+        head->current = now;
+        for (i = 0; i < WHEEL_ROOT_SIZE; i++) {
+                TAILQ_INIT(&head->root[i]);
+        }
+        for (l = 0; l < WHEEL_LEVELS; l++) {
+                for (i = 0; i < WHEEL_LEVEL_SIZE; i++) {
+                        TAILQ_INIT(&head->levels[l][i]);
+                }
+        }
+        return head;
+bail:   return NULL;
+}
+
+void wheel_destroy (struct wheel_head *head)
+{
+        if (head == NULL) {
+                return;
+        }
+        free(head);
+}
+
+unsigned int wheel_count (struct wheel_head *head)
+{
+        return head->count;
+}
+
+static inline void wheel_map_set (struct wheel_head *head, struct wheel_list *list)
+{
+        unsigned int i;
+        if (list >= &head->root[0] && list < &head->root[WHEEL_ROOT_SIZE]) {
+                i = list - &head->root[0];
+                head->rmap[i / 64] |= (1ULL << (i % 64));
+        } else if (list >= &head->levels[0][0] && list < &head->levels[0][0] + (WHEEL_LEVELS * WHEEL_LEVEL_SIZE)) {
+                i = list - &head->levels[0][0];
+                head->lmap[i / WHEEL_LEVEL_SIZE] |= (1ULL << (i % WHEEL_LEVEL_SIZE));
+        }
+}
+
+static inline void wheel_map_clear (struct wheel_head *head, struct wheel_list *list)
+{
+        unsigned int i;
+        if (list >= &head->root[0] && list < &head->root[WHEEL_ROOT_SIZE]) {
+                i = list - &head->root[0];
+                head->rmap[i / 64] &= ~(1ULL << (i % 64));
+        } else if (list >= &head->levels[0][0] && list < &head->levels[0][0] + (WHEEL_LEVELS * WHEEL_LEVEL_SIZE)) {
+                i = list - &head->levels[0][0];
+                head->lmap[i / WHEEL_LEVEL_SIZE] &= ~(1ULL << (i % WHEEL_LEVEL_SIZE));
+        }
+}
+
+static inline unsigned int wheel_root_find (struct wheel_head *head, unsigned int index)
+{
+        unsigned int w;
+        uint64_t bits;
+        for (w = index / 64; w < WHEEL_ROOT_SIZE / 64; w++) {
+                bits = head->rmap[w];
+                if (w == index / 64) {
+                        bits &= ~0ULL << (index % 64);
+                }
+                if (bits != 0) {
+                        return w * 64 + __builtin_ctzll(bits);
+                }
+        }
+        return WHEEL_ROOT_SIZE;
+}
+
+static inline struct wheel_list * wheel_slot (struct wheel_head *head, unsigned long long expires)
+{
+        unsigned int l;
+        unsigned long long interval;
+        if (expires < head->current) {
+                return &head->root[head->current & WHEEL_ROOT_MASK];
+        }
+        interval = expires - head->current;
+        if (interval < WHEEL_ROOT_SIZE) {
+                return &head->root[expires & WHEEL_ROOT_MASK];
+        }
+        if (interval > WHEEL_MAX_INTERVAL) {
+                expires = head->current + WHEEL_MAX_INTERVAL;
+                interval = WHEEL_MAX_INTERVAL;
+        }
+        for (l = 0; l < WHEEL_LEVELS - 1; l++) {
+                if (interval < (1ULL << wheel_level_shift(l + 1))) {
+                        break;
+                }
+        }
+        return &head->levels[l][(expires >> wheel_level_shift(l)) & WHEEL_LEVEL_MASK];
+}
+
+static inline void wheel_link (struct wheel_head *head, struct wheel_entry *entry)
+{
+        struct wheel_list *list;
+        list = wheel_slot(head, entry->expires);
+        TAILQ_INSERT_TAIL(list, entry, list);
+        entry->head = list;
+        wheel_map_set(head, list);
+}
+
+static inline void wheel_unlink (struct wheel_head *head, struct wheel_entry *entry)
+{
+        TAILQ_REMOVE(entry->head, entry, list);
+        if (TAILQ_EMPTY(entry->head)) {
+                wheel_map_clear(head, entry->head);
+        }
+        entry->head = NULL;
+}
+
+int wheel_add (struct wheel_head *head, struct wheel_entry *entry, unsigned long long expires)
+{
+        if (entry->head != NULL) {
+                goto bail;
+        }
+        entry->expires = expires;
+        wheel_link(head, entry);
+        head->count += 1;
+        return 0;
+bail:   return -1;
+}
+
+int wheel_mod (struct wheel_head *head, struct wheel_entry *entry, unsigned long long expires)
+{
+        if (entry->head == NULL) {
+                return wheel_add(head, entry, expires);
+        }
+        if (entry->expires == expires) {
+                return 0;
+        }
+        wheel_unlink(head, entry);
+        entry->expires = expires;
+        wheel_link(head, entry);
+        return 0;
+}
+
+int wheel_del (struct wheel_head *head, struct wheel_entry *entry)
+{
+        if (entry->head == NULL) {
+                goto bail;
+        }
+        wheel_unlink(head, entry);
+        head->count -= 1;
+        return 0;
+bail:   return -1;
+}
+
+int wheel_pending (const struct wheel_entry *entry)
+{
+        return entry->head != NULL;
+}
+
+int wheel_next (struct wheel_head *head, unsigned long long *next)
+{
+        unsigned int l;
+        unsigned int s;
+        unsigned int index;
+        unsigned int position;
+        unsigned long long base;
+        unsigned long long expires;
+        uint64_t bits;
+        if (head->count == 0) {
+                return 0;
+        }
+        *next = ~0ULL;
+        index = head->current & WHEEL_ROOT_MASK;
+        position = wheel_root_find(head, index);
+        if (position < WHEEL_ROOT_SIZE) {
+                *next = head->current + (position - index);
+        } else {
+                position = wheel_root_find(head, 0);
+                if (position < WHEEL_ROOT_SIZE) {
+                        *next = head->current + WHEEL_ROOT_SIZE - index + position;
+                }
+        }
+        for (l = 0; l < WHEEL_LEVELS; l++) {
+                if (head->lmap[l] == 0) {
+                        continue;
+                }
+                base = (head->current + (1ULL << wheel_level_shift(l)) - 1) >> wheel_level_shift(l);
+                s = base & WHEEL_LEVEL_MASK;
+                bits = (head->lmap[l] >> s) | ((s != 0) ? (head->lmap[l] << (WHEEL_LEVEL_SIZE - s)) : 0);
+                expires = (base + __builtin_ctzll(bits)) << wheel_level_shift(l);
+                if (expires < *next) {
+                        *next = expires;
+                }
+        }
+        return 1;
+}
+
+static unsigned int wheel_cascade (struct wheel_head *head, unsigned int level, unsigned int index)
+{
+        unsigned int count;
+        struct wheel_list work;
+        struct wheel_entry *entry;
+        TAILQ_INIT(&work);
+        while ((entry = TAILQ_FIRST(&head->levels[level][index])) != NULL) {
+                TAILQ_REMOVE(&head->levels[level][index], entry, list);
+                TAILQ_INSERT_TAIL(&work, entry, list);
+        }
+        head->lmap[level] &= ~(1ULL << index);
+        count = 0;
+        while ((entry = TAILQ_FIRST(&work)) != NULL) {
+                TAILQ_REMOVE(&work, entry, list);
+                wheel_link(head, entry);
+                count += 1;
+        }
+        return count;
+}
+
+int wheel_advance (struct wheel_head *head, unsigned long long now, int (*callback) (void *context, struct wheel_entry *entry), void *context)
+{
+        int rc;
+        int processed;
+        unsigned int l;
+        unsigned int index;
+        unsigned int position;
+        unsigned long long target;
+        struct wheel_list work;
+        struct wheel_entry *entry;
+        processed = 0;
+        TAILQ_INIT(&work);
+        while (head->current <= now) {
+                if (head->count == 0) {
+                        head->current = now + 1;
+                        break;
+                }
+                index = head->current & WHEEL_ROOT_MASK;
+                if (index == 0) {
+                        for (l = 0; l < WHEEL_LEVELS; l++) {
+                                position = (head->current >> wheel_level_shift(l)) & WHEEL_LEVEL_MASK;
+                                processed += wheel_cascade(head, l, position);
+                                if (position != 0) {
+                                        break;
+                                }
+                        }
+                }
+                position = wheel_root_find(head, index);
+                if (position != index) {
+                        target = head->current + (position - index);
+                        head->current = (target > now + 1) ? now + 1 : target;
+                        continue;
+                }
+                while ((entry = TAILQ_FIRST(&head->root[index])) != NULL) {
+                        TAILQ_REMOVE(&head->root[index], entry, list);
+                        TAILQ_INSERT_TAIL(&work, entry, list);
+                        entry->head = &work;
+                }
+                wheel_map_clear(head, &head->root[index]);
+                head->current += 1;
+                while ((entry = TAILQ_FIRST(&work)) != NULL) {
+                        TAILQ_REMOVE(&work, entry, list);
+                        entry->head = NULL;
+                        head->count -= 1;
+                        processed += 1;
+                        rc = callback(context, entry);
+                        if (rc < 0) {
+                                goto bail;
+                        }
+                }
+        }
+        return processed;
+bail:   while ((entry = TAILQ_FIRST(&work)) != NULL) {
+                TAILQ_REMOVE(&work, entry, list);
+                wheel_link(head, entry);
+        }
+        return rc;
+}
@@ -0,0 +1,28 @@
+
+#if !defined(MEDUSA_WHEEL_H)
+#define MEDUSA_WHEEL_H
+
+struct wheel_list;
+struct wheel_head;
+
+struct wheel_entry {
+        TAILQ_ENTRY(wheel_entry) list;
+        struct wheel_list *head;
+        unsigned long long expires;
+};
+TAILQ_HEAD(wheel_list, wheel_entry);
+
+struct wheel_head * wheel_create (unsigned long long now);
+void wheel_destroy (struct wheel_head *head);
+
+unsigned int wheel_count (struct wheel_head *head);
+
+int wheel_add (struct wheel_head *head, struct wheel_entry *entry, unsigned long long expires);
+int wheel_mod (struct wheel_head *head, struct wheel_entry *entry, unsigned long long expires);
+int wheel_del (struct wheel_head *head, struct wheel_entry *entry);
+int wheel_pending (const struct wheel_entry *entry);
+
+int wheel_next (struct wheel_head *head, unsigned long long *next);
+int wheel_advance (struct wheel_head *head, unsigned long long now, int (*callback) (void *context, struct wheel_entry *entry), void *context);
+
+#endif
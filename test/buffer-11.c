@@ -0,0 +1,204 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/uio.h>
+
+#include "medusa/error.h"
+#include "medusa/buffer.h"
+
+#define TEST_ROUNDS     20000
+#define TEST_LENGTH     (64 * 1024)
+#define TEST_IOVECS     64
+
+#define MIN(a, b)       (((a) < (b)) ? (a) : (b))
+
+static const unsigned int g_types[] = {
+        MEDUSA_BUFFER_TYPE_DEFAULT,
+        MEDUSA_BUFFER_TYPE_SIMPLE,
+        MEDUSA_BUFFER_TYPE_CHUNKED,
+};
+
+static int test_compare (struct medusa_buffer *buffer, const unsigned char *model, int64_t mlength)
+{
+        int64_t i;
+        int64_t j;
+        int64_t niovecs;
+        struct iovec iovecs[TEST_IOVECS];
+        if (medusa_buffer_get_length(buffer) != mlength) {
+                fprintf(stderr, "length mismatch: %lld != %lld\n", (long long) medusa_buffer_get_length(buffer), (long long) mlength);
+                return -1;
+        }
+        j = 0;
+        while (j < mlength) {
+                niovecs = medusa_buffer_queryv(buffer, j, -1, iovecs, TEST_IOVECS);
+                if (niovecs <= 0) {
+                        return -1;
+                }
+                for (i = 0; i < niovecs; i++) {
+                        if (memcmp(model + j, iovecs[i].iov_base, iovecs[i].iov_len) != 0) {
+                                fprintf(stderr, "data mismatch @ %lld\n", (long long) j);
+                                return -1;
+                        }
+                        j += iovecs[i].iov_len;
+                }
+        }
+        return 0;
+}
+
+static int test_buffer (unsigned int type)
+{
+        int rc;
+        unsigned int r;
+        int64_t i;
+        int64_t n;
+        int64_t offset;
+        int64_t length;
+        int64_t mlength;
+        int64_t niovecs;
+        unsigned char *data;
+        unsigned char *model;
+        unsigned char *linear;
+        struct iovec iovecs[TEST_IOVECS];
+        struct medusa_buffer *buffer;
+
+        data = malloc(TEST_LENGTH);
+        model = malloc(TEST_LENGTH * 2);
+        buffer = medusa_buffer_create(type);
+        if (data == NULL || model == NULL || MEDUSA_IS_ERR_OR_NULL(buffer)) {
+                fprintf(stderr, "create failed\n");
+                return -1;
+        }
+        mlength = 0;
+
+        for (r = 0; r < TEST_ROUNDS; r++) {
+                length = rand() % ((rand() % 8 == 0) ? TEST_LENGTH / 4 : 256);
+                for (i = 0; i < length; i++) {
+                        data[i] = rand();
+                }
+                switch (rand() % 7) {
+                        case 0:
+                        case 1:
+                                if (mlength + length > TEST_LENGTH) {
+                                        break;
+                                }
+                                offset = (rand() % 2) ? mlength : rand() % (mlength + 1);
+                                rc = medusa_buffer_insert(buffer, offset, data, length);
+                                if (rc != length) {
+                                        fprintf(stderr, "insert failed: %d\n", rc);
+                                        return -1;
+                                }
+                                memmove(model + offset + length, model + offset, mlength - offset);
+                                memcpy(model + offset, data, length);
+                                mlength += length;
+                                break;
+                        case 2:
+                                if (mlength + length > TEST_LENGTH) {
+                                        break;
+                                }
+                                niovecs = medusa_buffer_reservev(buffer, length, NULL, 0);
+                                if (niovecs < 0 || niovecs > TEST_IOVECS) {
+                                        fprintf(stderr, "reservev failed: %lld\n", (long long) niovecs);
+                                        return -1;
+                                }
+                                niovecs = medusa_buffer_reservev(buffer, length, iovecs, (rand() % 2) ? niovecs : 1);
+                                if (niovecs < 0) {
+                                        fprintf(stderr, "reservev failed: %lld\n", (long long) niovecs);
+                                        return -1;
+                                }
+                                n = rand() % (length + 1);
+                                for (i = 0; i < niovecs; i++) {
+                                        iovecs[i].iov_len = (iovecs[i].iov_len < (size_t) n) ? iovecs[i].iov_len : (size_t) n;
+                                        memcpy(iovecs[i].iov_base, data + length - n, iovecs[i].iov_len);
+                                        memcpy(model + mlength, data + length - n, iovecs[i].iov_len);
+                                        mlength += iovecs[i].iov_len;
+                                        n -= iovecs[i].iov_len;
+                                }
+                                rc = medusa_buffer_commitv(buffer, iovecs, niovecs);
+                                if (rc != niovecs) {
+                                        fprintf(stderr, "commitv failed: %d\n", rc);
+                                        return -1;
+                                }
+                                break;
+                        case 3:
+                        case 4:
+                                offset = (rand() % 2) ? 0 : rand() % (mlength + 1);
+                                length = MIN(length, mlength - offset);
+                                rc = medusa_buffer_choke(buffer, offset, length);
+                                if (rc != length) {
+                                        fprintf(stderr, "choke failed: %d\n", rc);
+                                        return -1;
+                                }
+                                memmove(model + offset, model + offset + length, mlength - offset - length);
+                                mlength -= length;
+                                break;
+                        case 5:
+                                offset = rand() % (mlength + 1);
+                                length = MIN(length, mlength - offset);
+                                linear = medusa_buffer_linearize(buffer, offset, length);
+                                if (length > 0 && MEDUSA_IS_ERR_OR_NULL(linear)) {
+                                        fprintf(stderr, "linearize failed\n");
+                                        return -1;
+                                }
+                                if (length > 0 && memcmp(linear, model + offset, length) != 0) {
+                                        fprintf(stderr, "linearize mismatch\n");
+                                        return -1;
+                                }
+                                break;
+                        case 6:
+                                if (mlength + 32 > TEST_LENGTH) {
+                                        break;
+                                }
+                                rc = medusa_buffer_appendf(buffer, "%08x", r);
+                                if (rc != 8) {
+                                        fprintf(stderr, "appendf failed: %d\n", rc);
+                                        return -1;
+                                }
+                                snprintf((char *) model + mlength, 9, "%08x", r);
+                                mlength += 8;
+                                break;
+                }
+                if (medusa_buffer_get_size(buffer) < mlength) {
+                        fprintf(stderr, "size mismatch\n");
+                        return -1;
+                }
+                if (r % 16 == 0 && test_compare(buffer, model, mlength) != 0) {
+                        fprintf(stderr, "round: %d\n", r);
+                        return -1;
+                }
+        }
+        if (test_compare(buffer, model, mlength) != 0) {
+                return -1;
+        }
+        rc = medusa_buffer_reset(buffer);
+        if (rc != 0 || medusa_buffer_get_length(buffer) != 0) {
+                return -1;
+        }
+
+        medusa_buffer_destroy(buffer);
+        free(model);
+        free(data);
+        return 0;
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+        (void) argc;
+        (void) argv;
+        srand(time(NULL));
+        for (i = 0; i < sizeof(g_types) / sizeof(g_types[0]); i++) {
+                fprintf(stderr, "type: %d\n", g_types[i]);
+                rc = test_buffer(g_types[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "fail\n");
+                        return -1;
+                }
+        }
+        fprintf(stderr, "success\n");
+        return 0;
+}
@@ -0,0 +1,73 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+#include "medusa/clock.h"
+
+#define SAMPLE_COUNT            120
+#define SAMPLE_INTERVAL         10000
+#define SAMPLE_DEVIATION        0.001
+
+static double timespec_diff (const struct timespec *a, const struct timespec *b)
+{
+        return (a->tv_sec - b->tv_sec) + (a->tv_nsec - b->tv_nsec) * 1e-9;
+}
+
+static void alarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int i;
+        int j;
+        int rc;
+        double diff;
+        struct timespec fast;
+        struct timespec last;
+        struct timespec monotonic;
+
+        (void) argc;
+        (void) argv;
+
+        signal(SIGALRM, alarm_handler);
+        alarm(5);
+
+        rc = medusa_clock_fast(NULL);
+        if (rc == 0) {
+                return -1;
+        }
+
+        rc = medusa_clock_fast(&last);
+        if (rc != 0) {
+                return -1;
+        }
+        for (i = 0; i < SAMPLE_COUNT; i++) {
+                for (j = 0; j < 1000; j++) {
+                        rc = medusa_clock_fast(&fast);
+                        if (rc != 0) {
+                                return -1;
+                        }
+                        if (medusa_timespec_compare(&fast, &last, <)) {
+                                fprintf(stderr, "clock went backwards: %.9f\n", timespec_diff(&fast, &last));
+                                return -1;
+                        }
+                        last = fast;
+                }
+                medusa_clock_monotonic(&monotonic);
+                diff = timespec_diff(&fast, &monotonic);
+                if (diff < -SAMPLE_DEVIATION || diff > SAMPLE_DEVIATION) {
+                        fprintf(stderr, "clock deviates: %.9f\n", diff);
+                        return -1;
+                }
+                usleep(SAMPLE_INTERVAL);
+        }
+        fprintf(stderr, "last deviation: %.9f\n", diff);
+
+        return 0;
+}
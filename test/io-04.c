@@ -0,0 +1,160 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <errno.h>
+
+#include "medusa/error.h"
+#include "medusa/io.h"
+#include "medusa/monitor.h"
+
+static const unsigned int g_polls[] = {
+        MEDUSA_MONITOR_POLL_DEFAULT,
+#if defined(__LINUX__)
+        MEDUSA_MONITOR_POLL_EPOLL,
+        MEDUSA_MONITOR_POLL_IO_URING,
+#endif
+#if defined(__APPLE__)
+        MEDUSA_MONITOR_POLL_KQUEUE,
+#endif
+        MEDUSA_MONITOR_POLL_POLL,
+        MEDUSA_MONITOR_POLL_SELECT
+};
+
+static int io_onevent (struct medusa_io *io, unsigned int events, void *context, ...)
+{
+        unsigned int *ievents = (unsigned int *) context;
+        (void) io;
+        *ievents |= events;
+        return 0;
+}
+
+static int test_poll (unsigned int poll)
+{
+        int rc;
+        int fds[2];
+
+        struct medusa_monitor *monitor;
+        struct medusa_monitor_init_options options;
+
+        unsigned int ievents;
+        unsigned long long elided;
+        struct medusa_io *io;
+
+        monitor = NULL;
+        fds[0] = -1;
+        fds[1] = -1;
+
+        rc = pipe(fds);
+        if (rc < 0) {
+                goto bail;
+        }
+
+        medusa_monitor_init_options_default(&options);
+        options.poll.type = poll;
+
+        monitor = medusa_monitor_create(&options);
+        if (monitor == NULL) {
+                goto bail;
+        }
+
+        ievents = 0;
+        io = medusa_io_create(monitor, fds[0], io_onevent, &ievents);
+        if (MEDUSA_IS_ERR_OR_NULL(io)) {
+                goto bail;
+        }
+        rc = medusa_io_set_events(io, MEDUSA_IO_EVENT_IN);
+        if (rc < 0) {
+                goto bail;
+        }
+        rc = medusa_io_set_enabled(io, 1);
+        if (rc < 0) {
+                goto bail;
+        }
+        rc = medusa_monitor_run_timeout(monitor, 0.01);
+        if (rc < 0) {
+                goto bail;
+        }
+
+        elided = medusa_monitor_get_elided(monitor);
+        rc = medusa_io_add_events(io, MEDUSA_IO_EVENT_OUT);
+        if (rc < 0) {
+                goto bail;
+        }
+        rc = medusa_io_del_events(io, MEDUSA_IO_EVENT_OUT);
+        if (rc < 0) {
+                goto bail;
+        }
+        rc = medusa_monitor_run_timeout(monitor, 0.01);
+        if (rc < 0) {
+                goto bail;
+        }
+        if (medusa_monitor_get_elided(monitor) != elided + 1) {
+                fprintf(stderr, "elided: %llu is invalid\n", medusa_monitor_get_elided(monitor));
+                goto bail;
+        }
+
+        rc = write(fds[1], "a", 1);
+        if (rc != 1) {
+                goto bail;
+        }
+        rc = medusa_monitor_run_timeout(monitor, 1.0);
+        if (rc < 0) {
+                goto bail;
+        }
+        if (ievents != (MEDUSA_IO_EVENT_IN)) {
+                fprintf(stderr, "ievents: 0x%08x is invalid\n", ievents);
+                goto bail;
+        }
+
+        medusa_monitor_destroy(monitor);
+        monitor = NULL;
+
+        close(fds[0]);
+        close(fds[1]);
+        return 0;
+bail:   if (monitor != NULL) {
+                medusa_monitor_destroy(monitor);
+        }
+        if (fds[0] >= 0) {
+                close(fds[0]);
+        }
+        if (fds[1] >= 0) {
+                close(fds[1]);
+        }
+        return -1;
+}
+
+static void alarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+
+        (void) argc;
+        (void) argv;
+
+        srand(time(NULL));
+        signal(SIGALRM, alarm_handler);
+
+        for (i = 0; i < sizeof(g_polls) / sizeof(g_polls[0]); i++) {
+                alarm(5);
+
+                fprintf(stderr, "testing poll: %d\n", g_polls[i]);
+                rc = test_poll(g_polls[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "  failed\n");
+                        return -1;
+                }
+                fprintf(stderr, "success\n");
+        }
+        return 0;
+}
@@ -0,0 +1,213 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "medusa/error.h"
+#include "medusa/tcpsocket.h"
+#include "medusa/monitor.h"
+#include "medusa/monitor-group.h"
+
+#define GROUP_COUNT             4
+#define CONNECTION_COUNT        64
+
+static const unsigned int g_polls[] = {
+        MEDUSA_MONITOR_POLL_DEFAULT,
+#if defined(__LINUX__)
+        MEDUSA_MONITOR_POLL_EPOLL,
+#endif
+#if defined(__APPLE__)
+        MEDUSA_MONITOR_POLL_KQUEUE,
+#endif
+        MEDUSA_MONITOR_POLL_POLL,
+        MEDUSA_MONITOR_POLL_SELECT
+};
+
+static int tcpsocket_server_onevent (struct medusa_tcpsocket *tcpsocket, unsigned int events, void *context, ...)
+{
+        (void) tcpsocket;
+        (void) events;
+        (void) context;
+        return 0;
+}
+
+static int tcpsocket_listener_onevent (struct medusa_tcpsocket *tcpsocket, unsigned int events, void *context, ...)
+{
+        struct medusa_tcpsocket *accepted;
+        (void) context;
+        if (events & MEDUSA_TCPSOCKET_EVENT_CONNECTION) {
+                accepted = medusa_tcpsocket_accept(tcpsocket, tcpsocket_server_onevent, NULL);
+                if (MEDUSA_IS_ERR_OR_NULL(accepted)) {
+                        return MEDUSA_PTR_ERR(accepted);
+                }
+                medusa_tcpsocket_destroy(accepted);
+        }
+        return 0;
+}
+
+static int test_poll (unsigned int poll)
+{
+        int i;
+        int rc;
+        int fds[CONNECTION_COUNT];
+
+        unsigned short port;
+        struct sockaddr_in sockaddr_in;
+
+        struct medusa_monitor_group *group;
+        struct medusa_monitor_group_stats stats;
+        struct medusa_monitor_group_init_options group_init_options;
+        struct medusa_monitor_init_options monitor_init_options;
+        struct medusa_tcpsocket_init_options tcpsocket_init_options;
+
+        group = NULL;
+        for (i = 0; i < CONNECTION_COUNT; i++) {
+                fds[i] = -1;
+        }
+
+        medusa_monitor_init_options_default(&monitor_init_options);
+        monitor_init_options.poll.type = poll;
+
+        medusa_monitor_group_init_options_default(&group_init_options);
+        group_init_options.count   = GROUP_COUNT;
+        group_init_options.monitor = &monitor_init_options;
+
+        group = medusa_monitor_group_create_with_options(&group_init_options);
+        if (MEDUSA_IS_ERR_OR_NULL(group)) {
+                group = NULL;
+                goto bail;
+        }
+        if (medusa_monitor_group_get_count(group) != GROUP_COUNT) {
+                goto bail;
+        }
+
+        medusa_tcpsocket_init_options_default(&tcpsocket_init_options);
+        tcpsocket_init_options.onevent     = tcpsocket_listener_onevent;
+        tcpsocket_init_options.context     = NULL;
+        tcpsocket_init_options.nonblocking = 1;
+        tcpsocket_init_options.reuseaddr   = 0;
+        tcpsocket_init_options.backlog     = CONNECTION_COUNT;
+        tcpsocket_init_options.enabled     = 1;
+        for (port = 12345; port < 65535; port++) {
+                rc = medusa_monitor_group_bind(group, &tcpsocket_init_options, MEDUSA_TCPSOCKET_PROTOCOL_IPV4, "127.0.0.1", port);
+                if (rc == 0) {
+                        break;
+                }
+        }
+        if (port >= 65535) {
+                fprintf(stderr, "  medusa_monitor_group_bind failed\n");
+                goto bail;
+        }
+        fprintf(stderr, "port: %d\n", port);
+
+        rc = medusa_monitor_group_start(group);
+        if (rc < 0) {
+                fprintf(stderr, "  medusa_monitor_group_start failed\n");
+                goto bail;
+        }
+
+        memset(&sockaddr_in, 0, sizeof(struct sockaddr_in));
+        sockaddr_in.sin_family = AF_INET;
+        sockaddr_in.sin_port = htons(port);
+        inet_pton(AF_INET, "127.0.0.1", &sockaddr_in.sin_addr);
+        for (i = 0; i < CONNECTION_COUNT; i++) {
+                fds[i] = socket(AF_INET, SOCK_STREAM, 0);
+                if (fds[i] < 0) {
+                        goto bail;
+                }
+                rc = connect(fds[i], (struct sockaddr *) &sockaddr_in, sizeof(struct sockaddr_in));
+                if (rc < 0) {
+                        fprintf(stderr, "  connect failed: %d\n", errno);
+                        goto bail;
+                }
+        }
+
+        while (1) {
+                rc = medusa_monitor_group_get_stats(group, &stats);
+                if (rc < 0) {
+                        goto bail;
+                }
+                if (stats.connections >= CONNECTION_COUNT) {
+                        break;
+                }
+                usleep(1000);
+        }
+        fprintf(stderr, "monitors: %u, running: %u, listeners: %u, iterations: %llu, connections: %llu\n", stats.monitors, stats.running, stats.listeners, stats.iterations, stats.connections);
+        if (stats.monitors != GROUP_COUNT ||
+            stats.running != GROUP_COUNT ||
+            stats.listeners != GROUP_COUNT ||
+            stats.connections != CONNECTION_COUNT) {
+                goto bail;
+        }
+
+        rc = medusa_monitor_group_break(group);
+        if (rc < 0) {
+                goto bail;
+        }
+        rc = medusa_monitor_group_wait(group);
+        if (rc < 0) {
+                goto bail;
+        }
+        rc = medusa_monitor_group_get_stats(group, &stats);
+        if (rc < 0) {
+                goto bail;
+        }
+        if (stats.running != 0) {
+                goto bail;
+        }
+
+        for (i = 0; i < CONNECTION_COUNT; i++) {
+                close(fds[i]);
+        }
+        medusa_monitor_group_destroy(group);
+        return 0;
+bail:   for (i = 0; i < CONNECTION_COUNT; i++) {
+                if (fds[i] >= 0) {
+                        close(fds[i]);
+                }
+        }
+        if (group != NULL) {
+                medusa_monitor_group_destroy(group);
+        }
+        return -1;
+}
+
+static void sigalarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+
+        (void) argc;
+        (void) argv;
+
+        srand(time(NULL));
+        signal(SIGALRM, sigalarm_handler);
+
+        for (i = 0; i < sizeof(g_polls) / sizeof(g_polls[0]); i++) {
+                alarm(5);
+
+                fprintf(stderr, "testing poll: %d\n", g_polls[i]);
+                rc = test_poll(g_polls[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "  failed\n");
+                        return -1;
+                }
+                fprintf(stderr, "success\n");
+        }
+        return 0;
+}
@@ -0,0 +1,253 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+
+#include "medusa/error.h"
+#include "medusa/io.h"
+#include "medusa/timer.h"
+#include "medusa/monitor.h"
+
+#define TICK_INTERVAL   0.001
+#define TICK_COUNT      10
+
+static const unsigned int g_polls[] = {
+        MEDUSA_MONITOR_POLL_DEFAULT,
+#if defined(__LINUX__)
+        MEDUSA_MONITOR_POLL_EPOLL,
+        MEDUSA_MONITOR_POLL_IO_URING,
+#endif
+#if defined(__APPLE__)
+        MEDUSA_MONITOR_POLL_KQUEUE,
+#endif
+        MEDUSA_MONITOR_POLL_POLL,
+        MEDUSA_MONITOR_POLL_SELECT
+};
+
+static int io_onevent (struct medusa_io *io, unsigned int events, void *context, ...)
+{
+        char c;
+        int *count = (int *) context;
+        if (events & MEDUSA_IO_EVENT_IN) {
+                if (read(medusa_io_get_fd(io), &c, sizeof(c)) != sizeof(c)) {
+                        return -EIO;
+                }
+                *count += 1;
+        }
+        return 0;
+}
+
+static int timer_onevent (struct medusa_timer *timer, unsigned int events, void *context, ...)
+{
+        int *count = (int *) context;
+        if (events & MEDUSA_TIMER_EVENT_TIMEOUT) {
+                *count += 1;
+                if (*count == TICK_COUNT) {
+                        return medusa_monitor_break(medusa_timer_get_monitor(timer));
+                }
+        }
+        return 0;
+}
+
+static int test_poll (unsigned int poll)
+{
+        int rc;
+        int fds[2];
+        int icount;
+        int tcount;
+        unsigned int subjects;
+
+        struct medusa_io *io;
+        struct medusa_timer *timer;
+        struct medusa_monitor *monitor;
+        struct medusa_monitor_stats stats;
+        struct medusa_monitor_init_options options;
+
+        fds[0] = -1;
+        fds[1] = -1;
+        icount = 0;
+        tcount = 0;
+        monitor = NULL;
+
+        medusa_monitor_init_options_default(&options);
+        options.poll.type = poll;
+
+        monitor = medusa_monitor_create(&options);
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                fprintf(stderr, "medusa_monitor_create failed\n");
+                goto bail;
+        }
+
+        rc = medusa_monitor_get_stats(monitor, &stats);
+        if (rc < 0) {
+                goto bail;
+        }
+        if (stats.iterations != 0 ||
+            stats.events.io != 0 ||
+            stats.events.timer != 0 ||
+            stats.timers.fired != 0) {
+                fprintf(stderr, "stats are not clean\n");
+                goto bail;
+        }
+        subjects = stats.subjects.actives + stats.subjects.changes + stats.subjects.rogues;
+
+        rc = pipe(fds);
+        if (rc < 0) {
+                goto bail;
+        }
+        io = medusa_io_create(monitor, fds[0], io_onevent, &icount);
+        if (MEDUSA_IS_ERR_OR_NULL(io)) {
+                goto bail;
+        }
+        rc  = medusa_io_set_events(io, MEDUSA_IO_EVENT_IN);
+        rc |= medusa_io_set_enabled(io, 1);
+        if (rc < 0) {
+                goto bail;
+        }
+
+        timer = medusa_timer_create(monitor, timer_onevent, &tcount);
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                goto bail;
+        }
+        rc  = medusa_timer_set_interval(timer, TICK_INTERVAL);
+        rc |= medusa_timer_set_enabled(timer, 1);
+        if (rc < 0) {
+                goto bail;
+        }
+
+        rc = medusa_monitor_get_stats(monitor, &stats);
+        if (rc < 0) {
+                goto bail;
+        }
+        if (stats.subjects.changes < 2 ||
+            stats.timers.count != 0) {
+                fprintf(stderr, "invalid pending changes: %u, timers: %u\n", stats.subjects.changes, stats.timers.count);
+                goto bail;
+        }
+
+        if (write(fds[1], "a", 1) != 1) {
+                goto bail;
+        }
+
+        rc = medusa_monitor_run(monitor);
+        if (rc != 0) {
+                fprintf(stderr, "can not run monitor\n");
+                goto bail;
+        }
+
+        rc = medusa_monitor_get_stats(monitor, &stats);
+        if (rc < 0) {
+                goto bail;
+        }
+        fprintf(stderr, "iterations: %llu, io: %llu, timer: %llu, fired: %llu, timers: %u, actives: %u, poll: %llu, callback: %llu, add: %llu, wait: %llu\n",
+                stats.iterations,
+                stats.events.io,
+                stats.events.timer,
+                stats.timers.fired,
+                stats.timers.count,
+                stats.subjects.actives,
+                stats.time.poll,
+                stats.time.callback,
+                stats.syscalls.add,
+                stats.syscalls.wait);
+        if (icount != 1 ||
+            tcount != TICK_COUNT) {
+                goto bail;
+        }
+        if (stats.iterations == 0 ||
+            stats.syscalls.wait < stats.iterations ||
+            stats.syscalls.add == 0) {
+                fprintf(stderr, "invalid loop stats\n");
+                goto bail;
+        }
+        if (stats.events.timer < TICK_COUNT ||
+            stats.timers.fired != TICK_COUNT ||
+            stats.timers.count != 1) {
+                fprintf(stderr, "invalid timer stats\n");
+                goto bail;
+        }
+        if (stats.events.io < 1 ||
+            stats.subjects.actives < 1) {
+                fprintf(stderr, "invalid io stats\n");
+                goto bail;
+        }
+        if (stats.time.poll == 0 ||
+            stats.time.callback == 0) {
+                fprintf(stderr, "invalid time stats\n");
+                goto bail;
+        }
+
+        medusa_io_destroy(io);
+        medusa_timer_destroy(timer);
+        rc = medusa_monitor_get_stats(monitor, &stats);
+        if (rc < 0) {
+                goto bail;
+        }
+        if (stats.subjects.deletes != 2) {
+                fprintf(stderr, "invalid pending deletes: %u\n", stats.subjects.deletes);
+                goto bail;
+        }
+        rc = medusa_monitor_run_timeout(monitor, 0.01);
+        if (rc < 0) {
+                goto bail;
+        }
+        rc = medusa_monitor_get_stats(monitor, &stats);
+        if (rc < 0) {
+                goto bail;
+        }
+        if (stats.subjects.deletes != 0 ||
+            stats.subjects.actives + stats.subjects.changes + stats.subjects.rogues != subjects) {
+                fprintf(stderr, "invalid subject stats: %u/%u/%u/%u\n", stats.subjects.actives, stats.subjects.changes, stats.subjects.deletes, stats.subjects.rogues);
+                goto bail;
+        }
+
+        medusa_monitor_destroy(monitor);
+        close(fds[0]);
+        close(fds[1]);
+        return 0;
+bail:   if (monitor != NULL) {
+                medusa_monitor_destroy(monitor);
+        }
+        if (fds[0] >= 0) {
+                close(fds[0]);
+        }
+        if (fds[1] >= 0) {
+                close(fds[1]);
+        }
+        return -1;
+}
+
+static void alarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+
+        (void) argc;
+        (void) argv;
+
+        srand(time(NULL));
+        signal(SIGALRM, alarm_handler);
+
+        for (i = 0; i < sizeof(g_polls) / sizeof(g_polls[0]); i++) {
+                alarm(5);
+                fprintf(stderr, "testing poll: %d\n", g_polls[i]);
+
+                rc = test_poll(g_polls[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "  failed\n");
+                        return -1;
+                }
+                fprintf(stderr, "success\n");
+        }
+        return 0;
+}
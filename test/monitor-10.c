@@ -0,0 +1,174 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+
+#include "medusa/error.h"
+#include "medusa/timer.h"
+#include "medusa/monitor.h"
+
+#define TICK_INTERVAL   0.001
+#define TICK_COUNT      3
+#define STALL_DURATION  5000
+#define STALL_THRESHOLD 2000
+
+static const unsigned int g_polls[] = {
+        MEDUSA_MONITOR_POLL_DEFAULT,
+#if defined(__LINUX__)
+        MEDUSA_MONITOR_POLL_EPOLL,
+        MEDUSA_MONITOR_POLL_IO_URING,
+#endif
+#if defined(__APPLE__)
+        MEDUSA_MONITOR_POLL_KQUEUE,
+#endif
+        MEDUSA_MONITOR_POLL_POLL,
+        MEDUSA_MONITOR_POLL_SELECT
+};
+
+static int timer_onevent (struct medusa_timer *timer, unsigned int events, void *context, ...)
+{
+        int *count = (int *) context;
+        if (events & MEDUSA_TIMER_EVENT_TIMEOUT) {
+                *count += 1;
+                if (*count == 1) {
+                        usleep(STALL_DURATION);
+                }
+                if (*count == TICK_COUNT) {
+                        return medusa_monitor_break(medusa_timer_get_monitor(timer));
+                }
+        }
+        return 0;
+}
+
+static int test_poll (unsigned int poll)
+{
+        int i;
+        int rc;
+        int lag;
+        int count;
+        int callback;
+
+        struct medusa_timer *timer;
+        struct medusa_monitor *monitor;
+        struct medusa_monitor_stats stats;
+        struct medusa_monitor_stall stalls[16];
+        struct medusa_monitor_init_options options;
+
+        count = 0;
+        monitor = NULL;
+
+        medusa_monitor_init_options_default(&options);
+        options.poll.type = poll;
+        options.watchdog.lag      = STALL_THRESHOLD;
+        options.watchdog.callback = STALL_THRESHOLD;
+        options.watchdog.size     = 16;
+
+        monitor = medusa_monitor_create(&options);
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                fprintf(stderr, "medusa_monitor_create failed\n");
+                goto bail;
+        }
+
+        timer = medusa_timer_create(monitor, timer_onevent, &count);
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                goto bail;
+        }
+        rc  = medusa_timer_set_interval(timer, TICK_INTERVAL);
+        rc |= medusa_timer_set_enabled(timer, 1);
+        if (rc < 0) {
+                goto bail;
+        }
+
+        rc = medusa_monitor_run(monitor);
+        if (rc != 0) {
+                fprintf(stderr, "can not run monitor\n");
+                goto bail;
+        }
+        if (count != TICK_COUNT) {
+                goto bail;
+        }
+
+        rc = medusa_monitor_get_stats(monitor, &stats);
+        if (rc < 0) {
+                goto bail;
+        }
+        rc = medusa_monitor_drain_stalls(monitor, stalls, sizeof(stalls) / sizeof(stalls[0]));
+        if (rc < 0) {
+                goto bail;
+        }
+        fprintf(stderr, "stalls: %d, recorded: %llu, dropped: %llu\n", rc, stats.watchdog.stalls, stats.watchdog.dropped);
+        if ((unsigned long long) rc != stats.watchdog.stalls) {
+                goto bail;
+        }
+
+        lag = 0;
+        callback = 0;
+        for (i = 0; i < rc; i++) {
+                fprintf(stderr, "  type: %u, name: %s, duration: %llu\n", stalls[i].type, (stalls[i].name) ? stalls[i].name : "", stalls[i].duration);
+                if (stalls[i].duration < STALL_THRESHOLD * 1000ULL) {
+                        goto bail;
+                }
+                if (stalls[i].type == MEDUSA_MONITOR_STALL_TYPE_LAG) {
+                        lag += 1;
+                } else if (stalls[i].type == MEDUSA_MONITOR_STALL_TYPE_CALLBACK) {
+                        if (stalls[i].subject != timer ||
+                            stalls[i].onevent != (void (*) (void)) timer_onevent ||
+                            strcmp(stalls[i].name, "timer") != 0 ||
+                            stalls[i].duration < STALL_DURATION * 1000ULL) {
+                                goto bail;
+                        }
+                        callback += 1;
+                }
+        }
+        if (lag < 1 || callback != 1) {
+                fprintf(stderr, "invalid stalls, lag: %d, callback: %d\n", lag, callback);
+                goto bail;
+        }
+
+        rc = medusa_monitor_drain_stalls(monitor, stalls, sizeof(stalls) / sizeof(stalls[0]));
+        if (rc != 0) {
+                goto bail;
+        }
+
+        medusa_monitor_destroy(monitor);
+        return 0;
+bail:   if (monitor != NULL) {
+                medusa_monitor_destroy(monitor);
+        }
+        return -1;
+}
+
+static void alarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+
+        (void) argc;
+        (void) argv;
+
+        srand(time(NULL));
+        signal(SIGALRM, alarm_handler);
+
+        for (i = 0; i < sizeof(g_polls) / sizeof(g_polls[0]); i++) {
+                alarm(5);
+                fprintf(stderr, "testing poll: %d\n", g_polls[i]);
+
+                rc = test_poll(g_polls[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "  failed\n");
+                        return -1;
+                }
+                fprintf(stderr, "success\n");
+        }
+        return 0;
+}
@@ -0,0 +1,174 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+
+#include "medusa/error.h"
+#include "medusa/clock.h"
+#include "medusa/timer.h"
+#include "medusa/monitor.h"
+
+#define TIMER_IDLE      0.200
+#define TIMER_LONG      0.300
+#define TIMER_SHORT     0.050
+#define TIMER_EARLY     0.001
+
+static const unsigned int g_polls[] = {
+        MEDUSA_MONITOR_POLL_DEFAULT,
+#if defined(__LINUX__)
+        MEDUSA_MONITOR_POLL_EPOLL,
+        MEDUSA_MONITOR_POLL_IO_URING,
+#endif
+#if defined(__APPLE__)
+        MEDUSA_MONITOR_POLL_KQUEUE,
+#endif
+        MEDUSA_MONITOR_POLL_POLL,
+        MEDUSA_MONITOR_POLL_SELECT
+};
+
+static const unsigned int g_timers[] = {
+        MEDUSA_MONITOR_TIMER_DEFAULT,
+        MEDUSA_MONITOR_TIMER_POLL
+};
+
+struct entry {
+        double interval;
+        struct timespec armed;
+        int *count;
+        int *failed;
+};
+
+static double timespec_diff (const struct timespec *a, const struct timespec *b)
+{
+        return (a->tv_sec - b->tv_sec) + (a->tv_nsec - b->tv_nsec) * 1e-9;
+}
+
+static int timer_onevent (struct medusa_timer *timer, unsigned int events, void *context, ...)
+{
+        double elapsed;
+        struct timespec now;
+        struct entry *entry = (struct entry *) context;
+        if (events & MEDUSA_TIMER_EVENT_TIMEOUT) {
+                medusa_clock_monotonic(&now);
+                elapsed = timespec_diff(&now, &entry->armed);
+                fprintf(stderr, "  interval: %.3f, elapsed: %.6f\n", entry->interval, elapsed);
+                if (elapsed < entry->interval - TIMER_EARLY) {
+                        fprintf(stderr, "timer fired early\n");
+                        *entry->failed = 1;
+                }
+                *entry->count += 1;
+                if (*entry->count == 2) {
+                        return medusa_monitor_break(medusa_timer_get_monitor(timer));
+                }
+        }
+        return 0;
+}
+
+static int test_poll (unsigned int poll, unsigned int type)
+{
+        int i;
+        int rc;
+        int count;
+        int failed;
+
+        struct entry entries[2];
+        struct medusa_timer *timer;
+        struct medusa_monitor *monitor;
+        struct medusa_monitor_init_options options;
+
+        count = 0;
+        failed = 0;
+        monitor = NULL;
+
+        medusa_monitor_init_options_default(&options);
+        options.poll.type  = poll;
+        options.timer.type = type;
+
+        monitor = medusa_monitor_create(&options);
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                fprintf(stderr, "medusa_monitor_create failed\n");
+                goto bail;
+        }
+
+        /* idle inside the loop, then outside of it, before any timer is armed */
+        rc = medusa_monitor_run_timeout(monitor, TIMER_IDLE / 2);
+        if (rc < 0) {
+                fprintf(stderr, "can not run monitor\n");
+                goto bail;
+        }
+        usleep(TIMER_IDLE / 2 * 1e6);
+
+        entries[0].interval = TIMER_LONG;
+        entries[1].interval = TIMER_SHORT;
+        for (i = 0; i < 2; i++) {
+                entries[i].count  = &count;
+                entries[i].failed = &failed;
+                medusa_clock_monotonic(&entries[i].armed);
+                timer = medusa_timer_create(monitor, timer_onevent, &entries[i]);
+                if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                        fprintf(stderr, "medusa_timer_create failed\n");
+                        goto bail;
+                }
+                rc  = medusa_timer_set_interval(timer, entries[i].interval);
+                rc |= medusa_timer_set_singleshot(timer, 1);
+                rc |= medusa_timer_set_enabled(timer, 1);
+                if (rc < 0) {
+                        fprintf(stderr, "can not setup timer\n");
+                        goto bail;
+                }
+        }
+
+        rc = medusa_monitor_run(monitor);
+        if (rc != 0) {
+                fprintf(stderr, "can not run monitor\n");
+                goto bail;
+        }
+        fprintf(stderr, "count: %d, failed: %d\n", count, failed);
+        if (count != 2 || failed != 0) {
+                goto bail;
+        }
+
+        medusa_monitor_destroy(monitor);
+        return 0;
+bail:   if (monitor != NULL) {
+                medusa_monitor_destroy(monitor);
+        }
+        return -1;
+}
+
+static void alarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+        unsigned int j;
+
+        (void) argc;
+        (void) argv;
+
+        signal(SIGALRM, alarm_handler);
+
+        for (i = 0; i < sizeof(g_polls) / sizeof(g_polls[0]); i++) {
+                for (j = 0; j < sizeof(g_timers) / sizeof(g_timers[0]); j++) {
+                        alarm(5);
+                        fprintf(stderr, "testing poll: %d, timer: %d\n", g_polls[i], g_timers[j]);
+
+                        rc = test_poll(g_polls[i], g_timers[j]);
+                        if (rc != 0) {
+                                fprintf(stderr, "  failed\n");
+                                return -1;
+                        }
+                        fprintf(stderr, "success\n");
+                }
+        }
+        return 0;
+}
@@ -0,0 +1,118 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <time.h>
+#include <pthread.h>
+
+#include "medusa/pool.h"
+
+#define THREAD_COUNT    16
+#define THREAD_ALLOCS   4096
+#define THREAD_ROUNDS   64
+
+struct object {
+        unsigned int thread;
+        unsigned int index;
+        unsigned int round;
+};
+
+struct thread {
+        unsigned int index;
+        unsigned int failed;
+        pthread_t thread;
+        struct object *objects[THREAD_ALLOCS];
+};
+
+static struct medusa_pool *g_pool;
+static struct thread g_threads[THREAD_COUNT];
+static pthread_barrier_t g_barrier;
+
+static void * thread_worker (void *arg)
+{
+        unsigned int i;
+        unsigned int r;
+        struct thread *thread = (struct thread *) arg;
+        struct thread *peer;
+        struct object *object;
+        for (r = 0; r < THREAD_ROUNDS; r++) {
+                for (i = 0; i < THREAD_ALLOCS; i++) {
+                        object = medusa_pool_malloc(g_pool);
+                        if (object == NULL) {
+                                thread->failed = 1;
+                                break;
+                        }
+                        object->thread = thread->index;
+                        object->index  = i;
+                        object->round  = r;
+                        thread->objects[i] = object;
+                }
+                pthread_barrier_wait(&g_barrier);
+                peer = &g_threads[(thread->index + 1 + (r % (THREAD_COUNT - 1))) % THREAD_COUNT];
+                for (i = 0; i < THREAD_ALLOCS; i++) {
+                        object = ((r % 2) == 0 || (i % 2) == 0) ? peer->objects[i] : thread->objects[i];
+                        if (object == NULL) {
+                                continue;
+                        }
+                        if (object->index != i ||
+                            object->round != r) {
+                                thread->failed = 1;
+                        }
+                        object->round = -1;
+                }
+                pthread_barrier_wait(&g_barrier);
+                for (i = 0; i < THREAD_ALLOCS; i++) {
+                        object = ((r % 2) == 0 || (i % 2) == 0) ? peer->objects[i] : thread->objects[i];
+                        medusa_pool_free(object);
+                }
+                pthread_barrier_wait(&g_barrier);
+                memset(thread->objects, 0, sizeof(thread->objects));
+        }
+        return NULL;
+}
+
+static void alarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+        unsigned int failed;
+
+        (void) argc;
+        (void) argv;
+
+        signal(SIGALRM, alarm_handler);
+        alarm(20);
+
+        g_pool = medusa_pool_create("pool", sizeof(struct object), 0, 0, MEDUSA_POOL_FLAG_DEFAULT | MEDUSA_POOL_FLAG_THREAD_SAFE, NULL, NULL, NULL);
+        if (g_pool == NULL) {
+                return -1;
+        }
+        pthread_barrier_init(&g_barrier, NULL, THREAD_COUNT);
+
+        memset(g_threads, 0, sizeof(g_threads));
+        for (i = 0; i < THREAD_COUNT; i++) {
+                g_threads[i].index = i;
+                rc = pthread_create(&g_threads[i].thread, NULL, thread_worker, &g_threads[i]);
+                if (rc != 0) {
+                        return -1;
+                }
+        }
+        for (failed = 0, i = 0; i < THREAD_COUNT; i++) {
+                pthread_join(g_threads[i].thread, NULL);
+                failed |= g_threads[i].failed;
+        }
+        fprintf(stderr, "failed: %d\n", failed);
+
+        pthread_barrier_destroy(&g_barrier);
+        medusa_pool_destroy(g_pool);
+        return (failed == 0) ? 0 : -1;
+}
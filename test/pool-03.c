@@ -0,0 +1,119 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <time.h>
+
+#include "medusa/pool.h"
+
+#define SPIKE_ALLOCS    100000
+#define RESUME_ALLOCS   64
+#define TRIM_PERIOD     0.1
+
+static int test_pool (double period, unsigned int flags)
+{
+        int rc;
+        int held;
+        unsigned int i;
+        void **ptrs;
+        struct medusa_pool *pool;
+        struct medusa_pool_stats stats;
+
+        pool = NULL;
+        ptrs = NULL;
+
+        pool = medusa_pool_create("pool", 64, 0, 0, MEDUSA_POOL_FLAG_DEFAULT | flags, NULL, NULL, NULL);
+        if (pool == NULL) {
+                goto bail;
+        }
+        rc = medusa_pool_set_trim_period(pool, -1);
+        if (rc == 0) {
+                goto bail;
+        }
+        rc = medusa_pool_set_trim_period(pool, period);
+        if (rc != 0) {
+                goto bail;
+        }
+
+        ptrs = malloc(sizeof(void *) * SPIKE_ALLOCS);
+        if (ptrs == NULL) {
+                goto bail;
+        }
+        for (i = 0; i < SPIKE_ALLOCS; i++) {
+                ptrs[i] = medusa_pool_malloc(pool);
+                if (ptrs[i] == NULL) {
+                        goto bail;
+                }
+        }
+        for (i = 0; i < SPIKE_ALLOCS; i++) {
+                medusa_pool_free(ptrs[i]);
+        }
+
+        /*
+         * allocations alone, which never empty a block, must be enough to
+         * release the blocks held since the spike.
+         */
+        usleep(TRIM_PERIOD * 2 * 1000000);
+        for (i = 0; i < RESUME_ALLOCS; i++) {
+                ptrs[i] = medusa_pool_malloc(pool);
+                if (ptrs[i] == NULL) {
+                        goto bail;
+                }
+        }
+        rc = medusa_pool_get_stats(pool, &stats);
+        if (rc != 0) {
+                goto bail;
+        }
+        held = stats.blocks.free;
+        for (i = 0; i < RESUME_ALLOCS; i++) {
+                medusa_pool_free(ptrs[i]);
+        }
+
+        rc = medusa_pool_trim(pool);
+        fprintf(stderr, "period: %.3f, flags: 0x%08x, held: %d, trimmed: %d\n", period, flags, held, rc);
+        if (rc < 0) {
+                goto bail;
+        }
+        if (medusa_pool_trim(pool) != 0) {
+                goto bail;
+        }
+
+        free(ptrs);
+        medusa_pool_destroy(pool);
+        return held;
+bail:   if (ptrs != NULL) {
+                free(ptrs);
+        }
+        if (pool != NULL) {
+                medusa_pool_destroy(pool);
+        }
+        return -1;
+}
+
+int main (int argc, char *argv[])
+{
+        int hold;
+        int trim;
+        unsigned int i;
+        static const unsigned int flags[] = {
+                MEDUSA_POOL_FLAG_NONE,
+                MEDUSA_POOL_FLAG_THREAD_SAFE
+        };
+
+        (void) argc;
+        (void) argv;
+
+        for (i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+                hold = test_pool(TRIM_PERIOD * 100, flags[i]);
+                if (hold <= 0) {
+                        return -1;
+                }
+                trim = test_pool(TRIM_PERIOD, flags[i]);
+                if (trim < 0 || trim * 2 > hold) {
+                        return -1;
+                }
+        }
+        return 0;
+}
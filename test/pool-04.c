@@ -0,0 +1,133 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <time.h>
+
+#include "medusa/pool.h"
+
+#define BULK_COUNT      10000
+#define BULK_ROUNDS     16
+
+struct object {
+        unsigned int index;
+        unsigned int round;
+};
+
+static int test_pool (unsigned int flags)
+{
+        int rc;
+        unsigned int i;
+        unsigned int r;
+        unsigned int n;
+        struct object *object;
+        struct object **objects;
+        struct medusa_pool *pool;
+        struct medusa_pool *other;
+
+        pool = NULL;
+        other = NULL;
+        objects = NULL;
+
+        pool = medusa_pool_create("pool", sizeof(struct object), 0, 0, MEDUSA_POOL_FLAG_DEFAULT | flags, NULL, NULL, NULL);
+        if (pool == NULL) {
+                goto bail;
+        }
+        other = medusa_pool_create("other", sizeof(struct object), 0, 0, MEDUSA_POOL_FLAG_DEFAULT | flags, NULL, NULL, NULL);
+        if (other == NULL) {
+                goto bail;
+        }
+        objects = malloc(sizeof(struct object *) * BULK_COUNT);
+        if (objects == NULL) {
+                goto bail;
+        }
+
+        rc = medusa_pool_malloc_bulk(NULL, (void **) objects, BULK_COUNT);
+        if (rc == 0) {
+                goto bail;
+        }
+        rc = medusa_pool_malloc_bulk(pool, NULL, BULK_COUNT);
+        if (rc == 0) {
+                goto bail;
+        }
+
+        for (r = 0; r < BULK_ROUNDS; r++) {
+                n = 1 + rand() % BULK_COUNT;
+                rc = medusa_pool_malloc_bulk(pool, (void **) objects, n);
+                if (rc != 0) {
+                        goto bail;
+                }
+                for (i = 0; i < n; i++) {
+                        objects[i]->index = i;
+                        objects[i]->round = r;
+                }
+                for (i = 0; i < n; i++) {
+                        if (objects[i]->index != i ||
+                            objects[i]->round != r) {
+                                fprintf(stderr, "object: %d is shared\n", i);
+                                goto bail;
+                        }
+                }
+                for (i = 0; i < n; i += 2) {
+                        medusa_pool_free(objects[i]);
+                        objects[i] = NULL;
+                }
+                for (i = 1; i < n; i += 4) {
+                        medusa_pool_free(objects[i]);
+                        objects[i] = medusa_pool_malloc(other);
+                        if (objects[i] == NULL) {
+                                goto bail;
+                        }
+                }
+                medusa_pool_free_bulk((void **) objects, n);
+        }
+
+        object = medusa_pool_malloc(pool);
+        if (object == NULL) {
+                goto bail;
+        }
+        medusa_pool_free(object);
+        medusa_pool_free_bulk(NULL, BULK_COUNT);
+
+        free(objects);
+        medusa_pool_destroy(other);
+        medusa_pool_destroy(pool);
+        return 0;
+bail:   if (objects != NULL) {
+                free(objects);
+        }
+        if (other != NULL) {
+                medusa_pool_destroy(other);
+        }
+        if (pool != NULL) {
+                medusa_pool_destroy(pool);
+        }
+        return -1;
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+        static const unsigned int flags[] = {
+                MEDUSA_POOL_FLAG_NONE,
+                MEDUSA_POOL_FLAG_RESERVE_NONE,
+                MEDUSA_POOL_FLAG_THREAD_SAFE
+        };
+
+        (void) argc;
+        (void) argv;
+
+        srand(time(NULL));
+
+        for (i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+                rc = test_pool(flags[i]);
+                fprintf(stderr, "flags: 0x%08x, rc: %d\n", flags[i], rc);
+                if (rc != 0) {
+                        return -1;
+                }
+        }
+        return 0;
+}
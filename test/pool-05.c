@@ -0,0 +1,107 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <time.h>
+
+#include "medusa/pool.h"
+
+#define OBJECT_COUNT    100000
+
+struct object {
+        unsigned int index;
+        unsigned char data[60];
+};
+
+static int test_pool (unsigned int flags, int node)
+{
+        int rc;
+        unsigned int i;
+        struct object **objects;
+        struct medusa_pool *pool;
+
+        pool = NULL;
+        objects = NULL;
+
+        pool = medusa_pool_create("pool", sizeof(struct object), 0, 0, MEDUSA_POOL_FLAG_DEFAULT | flags, NULL, NULL, NULL);
+        if (pool == NULL) {
+                goto bail;
+        }
+        rc = medusa_pool_set_numa_node(pool, -2);
+        if (rc == 0) {
+                goto bail;
+        }
+        rc = medusa_pool_set_numa_node(pool, node);
+        if (flags & (MEDUSA_POOL_FLAG_MMAP | MEDUSA_POOL_FLAG_HUGETLB)) {
+                if (rc != 0 && rc != -ENOTSUP) {
+                        goto bail;
+                }
+        } else if (rc == 0) {
+                goto bail;
+        }
+
+        objects = malloc(sizeof(struct object *) * OBJECT_COUNT);
+        if (objects == NULL) {
+                goto bail;
+        }
+        for (i = 0; i < OBJECT_COUNT; i++) {
+                objects[i] = medusa_pool_malloc(pool);
+                if (objects[i] == NULL) {
+                        goto bail;
+                }
+                objects[i]->index = i;
+                memset(objects[i]->data, i, sizeof(objects[i]->data));
+        }
+        for (i = 0; i < OBJECT_COUNT; i++) {
+                if (objects[i]->index != i ||
+                    objects[i]->data[sizeof(objects[i]->data) - 1] != (unsigned char) i) {
+                        fprintf(stderr, "object: %d is corrupted\n", i);
+                        goto bail;
+                }
+                medusa_pool_free(objects[i]);
+        }
+        rc = medusa_pool_trim(pool);
+        fprintf(stderr, "flags: 0x%08x, node: %d, trimmed: %d\n", flags, node, rc);
+        if (rc <= 0) {
+                goto bail;
+        }
+
+        free(objects);
+        medusa_pool_destroy(pool);
+        return 0;
+bail:   if (objects != NULL) {
+                free(objects);
+        }
+        if (pool != NULL) {
+                medusa_pool_destroy(pool);
+        }
+        return -1;
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+        static const unsigned int flags[] = {
+                MEDUSA_POOL_FLAG_NONE,
+                MEDUSA_POOL_FLAG_MMAP,
+                MEDUSA_POOL_FLAG_HUGETLB,
+                MEDUSA_POOL_FLAG_MMAP | MEDUSA_POOL_FLAG_THREAD_SAFE,
+                MEDUSA_POOL_FLAG_HUGETLB | MEDUSA_POOL_FLAG_THREAD_SAFE
+        };
+
+        (void) argc;
+        (void) argv;
+
+        for (i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+                rc  = test_pool(flags[i], -1);
+                rc |= test_pool(flags[i], 0);
+                if (rc != 0) {
+                        return -1;
+                }
+        }
+        return 0;
+}
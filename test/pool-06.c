@@ -0,0 +1,148 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <time.h>
+
+#include "medusa/pool.h"
+
+#define OBJECT_COUNT    1000
+#define STATS_COUNT     64
+
+static int test_pool (unsigned int flags)
+{
+        int i;
+        int rc;
+        int found;
+        void *ptrs[OBJECT_COUNT];
+        struct medusa_pool *pool;
+        struct medusa_pool_stats stats;
+        struct medusa_pool_stats *all;
+
+        all = NULL;
+        pool = NULL;
+
+        pool = medusa_pool_create("pool-06", 100, 0, 0, MEDUSA_POOL_FLAG_DEFAULT | flags, NULL, NULL, NULL);
+        if (pool == NULL) {
+                goto bail;
+        }
+        rc = medusa_pool_get_stats(pool, NULL);
+        if (rc == 0) {
+                goto bail;
+        }
+        rc = medusa_pool_get_stats(pool, &stats);
+        if (rc != 0) {
+                goto bail;
+        }
+        if (strcmp(stats.name, "pool-06") != 0 ||
+            stats.size < 100 ||
+            stats.entries.used != 0 ||
+            stats.mallocs != 0) {
+                goto bail;
+        }
+
+        for (i = 0; i < OBJECT_COUNT; i++) {
+                ptrs[i] = medusa_pool_malloc(pool);
+                if (ptrs[i] == NULL) {
+                        goto bail;
+                }
+        }
+        rc = medusa_pool_get_stats(pool, &stats);
+        if (rc != 0) {
+                goto bail;
+        }
+        fprintf(stderr, "flags: 0x%08x, blocks: %d/%d/%d, entries: %d/%d, bytes: %llu/%llu, mallocs: %llu\n",
+                flags,
+                stats.blocks.free, stats.blocks.half, stats.blocks.full,
+                stats.entries.used, stats.entries.capacity,
+                stats.bytes.used, stats.bytes.reserved,
+                stats.mallocs);
+        if (stats.mallocs != OBJECT_COUNT ||
+            stats.entries.used < OBJECT_COUNT ||
+            stats.entries.used > stats.entries.capacity ||
+            stats.bytes.used < OBJECT_COUNT * 100ULL ||
+            stats.bytes.used > stats.bytes.reserved ||
+            stats.blocks.full == 0 ||
+            stats.entries.capacity != stats.count * (stats.blocks.free + stats.blocks.half + stats.blocks.full)) {
+                goto bail;
+        }
+
+        rc = medusa_pool_get_stats_all(NULL, 0);
+        if (rc <= 0) {
+                goto bail;
+        }
+        all = malloc(sizeof(struct medusa_pool_stats) * STATS_COUNT);
+        if (all == NULL) {
+                goto bail;
+        }
+        rc = medusa_pool_get_stats_all(all, STATS_COUNT);
+        if (rc <= 0) {
+                goto bail;
+        }
+        for (found = 0, i = 0; i < rc && i < STATS_COUNT; i++) {
+                if (strcmp(all[i].name, "pool-06") == 0 &&
+                    all[i].mallocs == OBJECT_COUNT) {
+                        found += 1;
+                }
+        }
+        if (found != 1) {
+                goto bail;
+        }
+
+        for (i = 0; i < OBJECT_COUNT; i++) {
+                medusa_pool_free(ptrs[i]);
+        }
+        medusa_pool_trim(pool);
+        rc = medusa_pool_get_stats(pool, &stats);
+        if (rc != 0) {
+                goto bail;
+        }
+        if (stats.entries.used != 0 ||
+            stats.bytes.used != 0 ||
+            stats.mallocs != OBJECT_COUNT) {
+                goto bail;
+        }
+
+        medusa_pool_destroy(pool);
+        pool = NULL;
+        rc = medusa_pool_get_stats_all(all, STATS_COUNT);
+        for (i = 0; i < rc && i < STATS_COUNT; i++) {
+                if (strcmp(all[i].name, "pool-06") == 0) {
+                        goto bail;
+                }
+        }
+
+        free(all);
+        return 0;
+bail:   if (all != NULL) {
+                free(all);
+        }
+        if (pool != NULL) {
+                medusa_pool_destroy(pool);
+        }
+        return -1;
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+        static const unsigned int flags[] = {
+                MEDUSA_POOL_FLAG_NONE,
+                MEDUSA_POOL_FLAG_THREAD_SAFE
+        };
+
+        (void) argc;
+        (void) argv;
+
+        for (i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+                rc = test_pool(flags[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "  failed\n");
+                        return -1;
+                }
+        }
+        return 0;
+}
@@ -0,0 +1,144 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <pthread.h>
+
+#include "medusa/pool.h"
+
+#define OBJECT_COUNT    1000
+
+struct worker {
+        struct medusa_pool *pool;
+        void *ptrs[OBJECT_COUNT];
+        int failed;
+        int done;
+        int quit;
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+};
+
+static void * worker_thread (void *arg)
+{
+        unsigned int i;
+        struct worker *worker = (struct worker *) arg;
+        for (i = 0; i < OBJECT_COUNT; i++) {
+                worker->ptrs[i] = medusa_pool_malloc(worker->pool);
+                if (worker->ptrs[i] == NULL) {
+                        worker->failed = 1;
+                }
+        }
+        pthread_mutex_lock(&worker->mutex);
+        worker->done = 1;
+        pthread_cond_broadcast(&worker->cond);
+        while (worker->quit == 0) {
+                pthread_cond_wait(&worker->cond, &worker->mutex);
+        }
+        pthread_mutex_unlock(&worker->mutex);
+        return NULL;
+}
+
+static int test_pool (int join)
+{
+        int rc;
+        unsigned int i;
+        pthread_t thread;
+        struct worker worker;
+        struct medusa_pool_stats stats;
+
+        memset(&worker, 0, sizeof(struct worker));
+        pthread_mutex_init(&worker.mutex, NULL);
+        pthread_cond_init(&worker.cond, NULL);
+
+        worker.pool = medusa_pool_create("pool-07", 64, 0, 0, MEDUSA_POOL_FLAG_DEFAULT | MEDUSA_POOL_FLAG_THREAD_SAFE, NULL, NULL, NULL);
+        if (worker.pool == NULL) {
+                goto bail;
+        }
+        rc = pthread_create(&thread, NULL, worker_thread, &worker);
+        if (rc != 0) {
+                goto bail;
+        }
+
+        pthread_mutex_lock(&worker.mutex);
+        while (worker.done == 0) {
+                pthread_cond_wait(&worker.cond, &worker.mutex);
+        }
+        if (join) {
+                worker.quit = 1;
+                pthread_cond_broadcast(&worker.cond);
+        }
+        pthread_mutex_unlock(&worker.mutex);
+        if (join) {
+                pthread_join(thread, NULL);
+        }
+        if (worker.failed) {
+                goto bail;
+        }
+
+        for (i = 0; i < OBJECT_COUNT; i++) {
+                medusa_pool_free(worker.ptrs[i]);
+        }
+        rc = medusa_pool_get_stats(worker.pool, &stats);
+        if (rc != 0) {
+                goto bail;
+        }
+        fprintf(stderr, "join: %d, used: %d\n", join, stats.entries.used);
+        if (join && stats.entries.used != 0) {
+                goto bail;
+        }
+
+        rc = medusa_pool_trim(worker.pool);
+        if (rc < 0) {
+                goto bail;
+        }
+        rc = medusa_pool_get_stats(worker.pool, &stats);
+        if (rc != 0) {
+                goto bail;
+        }
+        fprintf(stderr, "join: %d, used: %d, blocks: %d/%d/%d\n", join, stats.entries.used, stats.blocks.free, stats.blocks.half, stats.blocks.full);
+        if (join &&
+            (stats.entries.used != 0 ||
+             stats.blocks.free + stats.blocks.half + stats.blocks.full != 0)) {
+                goto bail;
+        }
+        if (!join &&
+            stats.entries.used >= OBJECT_COUNT) {
+                goto bail;
+        }
+
+        if (!join) {
+                pthread_mutex_lock(&worker.mutex);
+                worker.quit = 1;
+                pthread_cond_broadcast(&worker.cond);
+                pthread_mutex_unlock(&worker.mutex);
+                pthread_join(thread, NULL);
+        }
+        medusa_pool_destroy(worker.pool);
+        pthread_cond_destroy(&worker.cond);
+        pthread_mutex_destroy(&worker.mutex);
+        return 0;
+bail:   if (worker.pool != NULL) {
+                medusa_pool_destroy(worker.pool);
+        }
+        return -1;
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+
+        (void) argc;
+        (void) argv;
+
+        rc = test_pool(1);
+        if (rc != 0) {
+                return -1;
+        }
+        rc = test_pool(0);
+        if (rc != 0) {
+                return -1;
+        }
+        return 0;
+}
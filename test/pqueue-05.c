@@ -0,0 +1,225 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/pqueue.h"
+#include "../src/pqueue.c"
+
+struct entry {
+        unsigned long long pri;
+        unsigned int pos;
+        char pad[48];
+};
+
+static const unsigned int g_counts[] = {
+        10000,
+        100000,
+        1000000
+};
+
+static int entry_compare (void *a, void *b)
+{
+        struct entry *ea = (struct entry *) a;
+        struct entry *eb = (struct entry *) b;
+        if (ea->pri > eb->pri) {
+                return 1;
+        }
+        return 0;
+}
+
+static void entry_set_position (void *a, unsigned int p)
+{
+        struct entry *ea = (struct entry *) a;
+        ea->pos = p;
+}
+
+static unsigned int entry_get_position (void *a)
+{
+        struct entry *ea = (struct entry *) a;
+        return ea->pos;
+}
+
+static unsigned long long entry_random (void)
+{
+        return (((unsigned long long) rand()) << 16) ^ rand();
+}
+
+static double timespec_elapsed (const struct timespec *start)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+static struct entry ** entries_create (unsigned int count)
+{
+        unsigned int i;
+        unsigned int j;
+        struct entry *entry;
+        struct entry **entries;
+        entries = malloc(sizeof(struct entry *) * count);
+        if (entries == NULL) {
+                return NULL;
+        }
+        for (i = 0; i < count; i++) {
+                entries[i] = malloc(sizeof(struct entry));
+                if (entries[i] == NULL) {
+                        return NULL;
+                }
+                entries[i]->pos = -1;
+        }
+        for (i = count - 1; i > 0; i--) {
+                j = rand() % (i + 1);
+                entry = entries[i];
+                entries[i] = entries[j];
+                entries[j] = entry;
+        }
+        return entries;
+}
+
+static void entries_destroy (struct entry **entries, unsigned int count)
+{
+        unsigned int i;
+        for (i = 0; i < count; i++) {
+                free(entries[i]);
+        }
+        free(entries);
+}
+
+static int test_pqueue (struct entry **entries, unsigned int count)
+{
+        unsigned int i;
+        unsigned long long p;
+        struct timespec start;
+        struct entry *entry;
+        struct pqueue_head *pqueue;
+
+        pqueue = pqueue_create(0, 64, entry_compare, entry_set_position, entry_get_position);
+        if (pqueue == NULL) {
+                return -1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < count; i++) {
+                entries[i]->pri = entry_random();
+                if (pqueue_add(pqueue, entries[i]) != 0) {
+                        return -1;
+                }
+        }
+        for (i = 0; i < count; i++) {
+                entry = pqueue_pop(pqueue);
+                if (entry == NULL) {
+                        return -1;
+                }
+                entry->pri += entry_random();
+                if (pqueue_add(pqueue, entry) != 0) {
+                        return -1;
+                }
+        }
+        for (p = 0, i = 0; i < count; i++) {
+                entry = pqueue_pop(pqueue);
+                if (entry == NULL || entry->pri < p) {
+                        return -1;
+                }
+                p = entry->pri;
+        }
+        fprintf(stderr, "  pqueue : %.6f\n", timespec_elapsed(&start));
+
+        if (pqueue_pop(pqueue) != NULL) {
+                return -1;
+        }
+        pqueue_destroy(pqueue);
+        return 0;
+}
+
+static int test_pqueue4 (struct entry **entries, unsigned int count)
+{
+        unsigned int i;
+        unsigned long long p;
+        unsigned long long key;
+        struct timespec start;
+        struct entry *entry;
+        struct pqueue4_head *pqueue;
+
+        pqueue = pqueue4_create(0, 64, entry_set_position, entry_get_position);
+        if (pqueue == NULL) {
+                return -1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < count; i++) {
+                entries[i]->pri = entry_random();
+                if (pqueue4_add(pqueue, entries[i], entries[i]->pri) != 0) {
+                        return -1;
+                }
+        }
+        for (i = 0; i < count; i++) {
+                entry = pqueue4_pop(pqueue, &key);
+                if (entry == NULL) {
+                        return -1;
+                }
+                entry->pri = key + entry_random();
+                if (pqueue4_add(pqueue, entry, entry->pri) != 0) {
+                        return -1;
+                }
+        }
+        if (!pqueue4_verify(pqueue)) {
+                fprintf(stderr, "pqueue4 is invalid\n");
+                return -1;
+        }
+        for (p = 0, i = 0; i < count; i++) {
+                entry = pqueue4_pop(pqueue, &key);
+                if (entry == NULL || key < p || key != entry->pri) {
+                        return -1;
+                }
+                p = key;
+        }
+        fprintf(stderr, "  pqueue4: %.6f\n", timespec_elapsed(&start));
+
+        if (pqueue4_pop(pqueue, NULL) != NULL) {
+                return -1;
+        }
+        pqueue4_destroy(pqueue);
+        return 0;
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+        struct entry **entries;
+
+        long int seed;
+
+        (void) argc;
+        (void) argv;
+
+        seed = time(NULL);
+        srand(seed);
+
+        fprintf(stderr, "seed  : %ld\n", seed);
+
+        for (i = 0; i < sizeof(g_counts) / sizeof(g_counts[0]); i++) {
+                fprintf(stderr, "count : %u\n", g_counts[i]);
+                entries = entries_create(g_counts[i]);
+                if (entries == NULL) {
+                        return -1;
+                }
+                rc = test_pqueue(entries, g_counts[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "pqueue failed\n");
+                        return -1;
+                }
+                rc = test_pqueue4(entries, g_counts[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "pqueue4 failed\n");
+                        return -1;
+                }
+                entries_destroy(entries, g_counts[i]);
+        }
+
+        fprintf(stderr, "finish\n");
+
+        return 0;
+}
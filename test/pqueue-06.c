@@ -0,0 +1,158 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/pqueue.h"
+#include "../src/pqueue.c"
+
+#define BATCH_SIZE      32
+
+struct entry {
+        int pri;
+        int pos;
+};
+
+static int entry_compare (void *a, void *b)
+{
+        struct entry *ea = (struct entry *) a;
+        struct entry *eb = (struct entry *) b;
+        if (ea->pri > eb->pri) {
+                return 1;
+        }
+        return 0;
+}
+
+static void entry_set_position (void *a, unsigned int p)
+{
+        struct entry *ea = (struct entry *) a;
+        ea->pos = p;
+}
+
+static unsigned int entry_get_position (void *a)
+{
+        struct entry *ea = (struct entry *) a;
+        return ea->pos;
+}
+
+static int entries_check (void **out, unsigned int count, int check, int *p)
+{
+        unsigned int i;
+        struct entry *entry;
+        for (i = 0; i < count; i++) {
+                entry = out[i];
+                if (entry->pri > check) {
+                        fprintf(stderr, "  %d > %d\n", entry->pri, check);
+                        return -1;
+                }
+                if (entry->pri < *p) {
+                        fprintf(stderr, "  %d < %d\n", entry->pri, *p);
+                        return -1;
+                }
+                if (entry->pos != -1) {
+                        fprintf(stderr, "  pos is invalid: %d\n", entry->pos);
+                        return -1;
+                }
+                *p = entry->pri;
+        }
+        return 0;
+}
+
+int main (int argc, char *argv[])
+{
+        int i;
+        int p;
+        int hits;
+        int count;
+        int check;
+        struct entry *entries;
+
+        unsigned int n;
+        void *out[BATCH_SIZE];
+        struct entry kentry;
+        struct pqueue_head *pqueue;
+        struct pqueue4_head *pqueue4;
+
+        long int seed;
+
+        (void) argc;
+        (void) argv;
+
+        seed = time(NULL);
+        srand(seed);
+
+        count = 1 + rand() % 10000;
+        check = rand() % count;
+
+        fprintf(stderr, "seed  : %ld\n", seed);
+        fprintf(stderr, "count : %d\n", count);
+        fprintf(stderr, "check : %d\n", check);
+
+        entries = malloc(sizeof(struct entry) * count);
+        if (entries == NULL) {
+                return -1;
+        }
+
+        fprintf(stderr, "pqueue\n");
+        pqueue = pqueue_create(0, rand() % 64, entry_compare, entry_set_position, entry_get_position);
+        if (pqueue == NULL) {
+                return -1;
+        }
+        for (i = 0; i < count; i++) {
+                entries[i].pri = rand() % count;
+                pqueue_add(pqueue, &entries[i]);
+        }
+        for (i = 0, hits = 0; i < count; i++) {
+                hits += (entries[i].pri <= check);
+        }
+        kentry.pri = check;
+        for (p = -1, n = BATCH_SIZE; n == BATCH_SIZE; hits -= n) {
+                n = pqueue_pop_expired(pqueue, &kentry, out, BATCH_SIZE);
+                if (entries_check(out, n, check, &p) != 0) {
+                        return -1;
+                }
+        }
+        if (hits != 0) {
+                fprintf(stderr, "  hits is invalid: %d\n", hits);
+                return -1;
+        }
+        if (!pqueue_verify(pqueue)) {
+                fprintf(stderr, "pqueue is invalid\n");
+                return -1;
+        }
+        pqueue_destroy(pqueue);
+
+        fprintf(stderr, "pqueue4\n");
+        pqueue4 = pqueue4_create(0, rand() % 64, entry_set_position, entry_get_position);
+        if (pqueue4 == NULL) {
+                return -1;
+        }
+        for (i = 0; i < count; i++) {
+                entries[i].pri = rand() % count;
+                pqueue4_add(pqueue4, &entries[i], entries[i].pri);
+        }
+        for (i = 0, hits = 0; i < count; i++) {
+                hits += (entries[i].pri <= check);
+        }
+        for (p = -1, n = BATCH_SIZE; n == BATCH_SIZE; hits -= n) {
+                n = pqueue4_pop_expired(pqueue4, check, out, BATCH_SIZE);
+                if (entries_check(out, n, check, &p) != 0) {
+                        return -1;
+                }
+        }
+        if (hits != 0) {
+                fprintf(stderr, "  hits is invalid: %d\n", hits);
+                return -1;
+        }
+        if (!pqueue4_verify(pqueue4)) {
+                fprintf(stderr, "pqueue4 is invalid\n");
+                return -1;
+        }
+        pqueue4_destroy(pqueue4);
+
+        free(entries);
+
+        fprintf(stderr, "finish\n");
+
+        return 0;
+}
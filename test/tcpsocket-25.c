@@ -0,0 +1,332 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <errno.h>
+
+#include "medusa/error.h"
+#include "medusa/buffer.h"
+#include "medusa/tcpsocket.h"
+#include "medusa/monitor.h"
+
+#define TRANSFER_LENGTH         (4 * 1024 * 1024)
+#define TRANSFER_BUDGET         (64 * 1024)
+
+static const unsigned int g_polls[] = {
+        MEDUSA_MONITOR_POLL_DEFAULT,
+#if defined(__LINUX__)
+        MEDUSA_MONITOR_POLL_EPOLL,
+        MEDUSA_MONITOR_POLL_IO_URING,
+#endif
+#if defined(__APPLE__)
+        MEDUSA_MONITOR_POLL_KQUEUE,
+#endif
+        MEDUSA_MONITOR_POLL_POLL,
+        MEDUSA_MONITOR_POLL_SELECT
+};
+
+struct client {
+        struct medusa_tcpsocket *tcpsocket;
+        int64_t length;
+};
+
+static int client_tcpsocket_onevent (struct medusa_tcpsocket *tcpsocket, unsigned int events, void *context, ...)
+{
+        int64_t i;
+        int64_t length;
+        unsigned char buffer[4096];
+        struct client *client = (struct client *) context;
+
+        if (events & MEDUSA_TCPSOCKET_EVENT_BUFFERED_READ) {
+                while (1) {
+                        length = medusa_buffer_read(medusa_tcpsocket_get_read_buffer(tcpsocket), buffer, sizeof(buffer));
+                        if (length < 0) {
+                                fprintf(stderr, "can not read tcpsocket read buffer\n");
+                                goto bail;
+                        }
+                        if (length == 0) {
+                                break;
+                        }
+                        for (i = 0; i < length; i++) {
+                                if (buffer[i] != (unsigned char) ((client->length + i) & 0xff)) {
+                                        fprintf(stderr, "invalid data in tcpsocket read buffer\n");
+                                        goto bail;
+                                }
+                        }
+                        client->length += length;
+                }
+                if (client->length == TRANSFER_LENGTH) {
+                        fprintf(stderr, "         - read whole transfer\n");
+                        medusa_monitor_break(medusa_tcpsocket_get_monitor(tcpsocket));
+                }
+        } else {
+                fprintf(stderr, "client   events: 0x%08x, %s\n", events, medusa_tcpsocket_event_string(events));
+        }
+        return 0;
+bail:   return -1;
+}
+
+static void client_destroy (struct client *client)
+{
+        if (client == NULL) {
+                return;
+        }
+        if (!MEDUSA_IS_ERR_OR_NULL(client->tcpsocket)) {
+                medusa_tcpsocket_destroy(client->tcpsocket);
+        }
+        free(client);
+}
+
+static struct client * client_create (struct medusa_monitor *monitor, const char *host, unsigned short port)
+{
+        int rc;
+        struct client *client;
+        struct medusa_tcpsocket_init_options tcpsocket_init_options;
+
+        client = malloc(sizeof(struct client));
+        if (client == NULL) {
+                fprintf(stderr, "can not allocate memory\n");
+                goto bail;
+        }
+        memset(client, 0, sizeof(struct client));
+
+        client->length = 0;
+
+        rc = medusa_tcpsocket_init_options_default(&tcpsocket_init_options);
+        if (rc != 0) {
+                fprintf(stderr, "can not init tcpsocket init options\n");
+                goto bail;
+        }
+        tcpsocket_init_options.monitor     = monitor;
+        tcpsocket_init_options.backlog     = 10;
+        tcpsocket_init_options.buffered    = 1;
+        tcpsocket_init_options.nodelay     = 1;
+        tcpsocket_init_options.nonblocking = 1;
+        tcpsocket_init_options.reuseaddr   = 1;
+        tcpsocket_init_options.reuseport   = 1;
+        tcpsocket_init_options.edgetriggered = 1;
+        tcpsocket_init_options.budget      = TRANSFER_BUDGET;
+        tcpsocket_init_options.enabled     = 1;
+        tcpsocket_init_options.onevent     = client_tcpsocket_onevent;
+        tcpsocket_init_options.context     = client;
+        client->tcpsocket = medusa_tcpsocket_create_with_options(&tcpsocket_init_options);
+        if (MEDUSA_IS_ERR_OR_NULL(client->tcpsocket)) {
+                fprintf(stderr, "can not create tcpsocket\n");
+                goto bail;
+        }
+        if (medusa_tcpsocket_get_edgetriggered(client->tcpsocket) != 1) {
+                fprintf(stderr, "invalid tcpsocket edgetriggered\n");
+                goto bail;
+        }
+        if (medusa_tcpsocket_get_budget(client->tcpsocket) != TRANSFER_BUDGET) {
+                fprintf(stderr, "invalid tcpsocket budget\n");
+                goto bail;
+        }
+        rc = medusa_tcpsocket_connect(client->tcpsocket, MEDUSA_TCPSOCKET_PROTOCOL_ANY, host, port);
+        if (rc < 0) {
+                fprintf(stderr, "medusa_tcpsocket_connect failed\n");
+                goto bail;
+        }
+
+        return client;
+bail:   if (client != NULL) {
+                client_destroy(client);
+        }
+        return NULL;
+}
+
+static int tcpsocket_server_onevent (struct medusa_tcpsocket *tcpsocket, unsigned int events, void *context, ...)
+{
+        (void) tcpsocket;
+        (void) context;
+        if (events & (MEDUSA_TCPSOCKET_EVENT_BUFFERED_WRITE | MEDUSA_TCPSOCKET_EVENT_BUFFERED_READ)) {
+                return 0;
+        }
+        fprintf(stderr, "server   events: 0x%08x, %s\n", events, medusa_tcpsocket_event_string(events));
+        return 0;
+}
+
+static int tcpsocket_listener_onevent (struct medusa_tcpsocket *tcpsocket, unsigned int events, void *context, ...)
+{
+        int i;
+        int rc;
+        unsigned char *buffer;
+        struct medusa_tcpsocket *accepted;
+        struct medusa_tcpsocket_accept_options accepted_options;
+
+        (void) context;
+
+        fprintf(stderr, "listener events: 0x%08x, %s\n", events, medusa_tcpsocket_event_string(events));
+        if (events & MEDUSA_TCPSOCKET_EVENT_CONNECTION) {
+                fprintf(stderr, "         - accepting new connection\n");
+                rc = medusa_tcpsocket_accept_options_default(&accepted_options);
+                if (rc != 0) {
+                        fprintf(stderr, "can not init accept options\n");
+                        goto bail;
+                }
+                accepted_options.buffered    = 1;
+                accepted_options.nodelay     = 1;
+                accepted_options.nonblocking = 1;
+                accepted_options.edgetriggered = 1;
+                accepted_options.budget      = TRANSFER_BUDGET;
+                accepted_options.enabled     = 1;
+                accepted_options.onevent     = tcpsocket_server_onevent;
+                accepted_options.context     = NULL;
+                accepted = medusa_tcpsocket_accept_with_options(tcpsocket, &accepted_options);
+                if (MEDUSA_IS_ERR_OR_NULL(accepted)) {
+                        return MEDUSA_PTR_ERR(accepted);
+                }
+
+                fprintf(stderr, "         - writing transfer\n");
+                buffer = malloc(TRANSFER_LENGTH);
+                if (buffer == NULL) {
+                        fprintf(stderr, "can not allocate memory\n");
+                        goto bail;
+                }
+                for (i = 0; i < TRANSFER_LENGTH; i++) {
+                        buffer[i] = i & 0xff;
+                }
+                rc = medusa_buffer_write(medusa_tcpsocket_get_write_buffer(accepted), buffer, TRANSFER_LENGTH);
+                free(buffer);
+                if (rc != TRANSFER_LENGTH) {
+                        fprintf(stderr, "can not write to tcpsocket buffer (rc: %d)\n", rc);
+                        goto bail;
+                }
+                rc = medusa_tcpsocket_commit_write_buffer(accepted);
+                if (rc != 0) {
+                        fprintf(stderr, "can not commit tcpsocket write buffer\n");
+                        goto bail;
+                }
+        }
+
+        return 0;
+bail:   return -1;
+}
+
+static int test_poll (unsigned int poll)
+{
+        int rc;
+
+        struct medusa_monitor *monitor;
+        struct medusa_monitor_init_options monitor_init_options;
+
+        unsigned short port;
+
+        struct medusa_tcpsocket *tcpsocket;
+        struct medusa_tcpsocket_init_options tcpsocket_init_options;
+
+        struct client *client;
+
+        monitor = NULL;
+        client  = NULL;
+
+        rc = medusa_monitor_init_options_default(&monitor_init_options);
+        if (rc != 0) {
+                fprintf(stderr, "can not init monitor init options\n");
+                goto bail;
+        }
+        monitor_init_options.poll.type = poll;
+        monitor = medusa_monitor_create(&monitor_init_options);
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                fprintf(stderr, "can not create monitor\n");
+                goto bail;
+        }
+
+        rc = medusa_tcpsocket_init_options_default(&tcpsocket_init_options);
+        if (rc != 0) {
+                fprintf(stderr, "can not init tcpsocket init options\n");
+                goto bail;
+        }
+        tcpsocket_init_options.monitor     = monitor;
+        tcpsocket_init_options.backlog     = 10;
+        tcpsocket_init_options.buffered    = 1;
+        tcpsocket_init_options.nodelay     = 1;
+        tcpsocket_init_options.nonblocking = 1;
+        tcpsocket_init_options.reuseaddr   = 1;
+        tcpsocket_init_options.reuseport   = 1;
+        tcpsocket_init_options.enabled     = 1;
+        tcpsocket_init_options.onevent     = tcpsocket_listener_onevent;
+        tcpsocket_init_options.context     = NULL;
+        tcpsocket = medusa_tcpsocket_create_with_options(&tcpsocket_init_options);
+        if (MEDUSA_IS_ERR_OR_NULL(tcpsocket)) {
+                fprintf(stderr, "can not create tcpsocket\n");
+                goto bail;
+        }
+        for (port = 12345; port < 65535; port++) {
+                rc = medusa_tcpsocket_bind(tcpsocket, MEDUSA_TCPSOCKET_PROTOCOL_ANY, "127.0.0.1", port);
+                if (rc == 0) {
+                        break;
+                }
+        }
+        if (port >= 65535) {
+                fprintf(stderr, "medusa_tcpsocket_bind failed\n");
+                goto bail;
+        }
+
+        fprintf(stderr, "port: %d\n", port);
+
+        client = client_create(monitor, "127.0.0.1", port);
+        if (client == NULL) {
+                fprintf(stderr, "can not create client\n");
+                goto bail;
+        }
+
+        rc = medusa_monitor_run(monitor);
+        if (rc != 0) {
+                fprintf(stderr, "medusa_monitor_run failed\n");
+                goto bail;
+        }
+
+        client_destroy(client);
+        medusa_monitor_destroy(monitor);
+        return 0;
+bail:   if (client != NULL) {
+                client_destroy(client);
+        }
+        if (monitor != NULL) {
+                medusa_monitor_destroy(monitor);
+        }
+        return -1;
+}
+
+static void sigalarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+static void sigint_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+
+        (void) argc;
+        (void) argv;
+
+        srand(time(NULL));
+        signal(SIGALRM, sigalarm_handler);
+        signal(SIGINT, sigint_handler);
+
+        for (i = 0; i < sizeof(g_polls) / sizeof(g_polls[0]); i++) {
+                alarm(5);
+
+                fprintf(stderr, "testing poll: %d\n", g_polls[i]);
+                rc = test_poll(g_polls[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "failed\n");
+                        return -1;
+                }
+                fprintf(stderr, "success\n");
+        }
+        return 0;
+}
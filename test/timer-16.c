@@ -0,0 +1,139 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+
+#include "medusa/error.h"
+#include "medusa/clock.h"
+#include "medusa/timer.h"
+#include "medusa/monitor.h"
+
+#define TICK_INTERVAL   0.0001
+#define TICK_COUNT      200
+
+static const unsigned int g_polls[] = {
+        MEDUSA_MONITOR_POLL_DEFAULT,
+#if defined(__LINUX__)
+        MEDUSA_MONITOR_POLL_EPOLL,
+        MEDUSA_MONITOR_POLL_IO_URING,
+#endif
+#if defined(__APPLE__)
+        MEDUSA_MONITOR_POLL_KQUEUE,
+#endif
+        MEDUSA_MONITOR_POLL_POLL,
+        MEDUSA_MONITOR_POLL_SELECT
+};
+
+static int timer_onevent (struct medusa_timer *timer, unsigned int events, void *context, ...)
+{
+        int *count = (int *) context;
+        if (events & MEDUSA_TIMER_EVENT_TIMEOUT) {
+                *count += 1;
+                if (*count == TICK_COUNT) {
+                        return medusa_monitor_break(medusa_timer_get_monitor(timer));
+                }
+        }
+        return 0;
+}
+
+static int test_poll (unsigned int poll)
+{
+        int rc;
+        int count;
+        double elapsed;
+        struct timespec start;
+        struct timespec finish;
+
+        struct medusa_timer *timer;
+        struct medusa_monitor *monitor;
+        struct medusa_monitor_init_options options;
+
+        count = 0;
+        monitor = NULL;
+
+        medusa_monitor_init_options_default(&options);
+        options.poll.type = poll;
+
+        monitor = medusa_monitor_create(&options);
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                fprintf(stderr, "medusa_monitor_create failed\n");
+                goto bail;
+        }
+
+        timer = medusa_timer_create(monitor, timer_onevent, &count);
+        if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                fprintf(stderr, "medusa_timer_create failed\n");
+                goto bail;
+        }
+        rc  = medusa_timer_set_resolution(timer, MEDUSA_TIMER_RESOLUTION_MICROSECONDS);
+        rc |= medusa_timer_set_interval(timer, TICK_INTERVAL);
+        rc |= medusa_timer_set_enabled(timer, 1);
+        if (rc < 0) {
+                fprintf(stderr, "can not setup timer\n");
+                goto bail;
+        }
+
+        medusa_clock_monotonic(&start);
+        rc = medusa_monitor_run(monitor);
+        if (rc != 0) {
+                fprintf(stderr, "can not run monitor\n");
+                goto bail;
+        }
+        medusa_clock_monotonic(&finish);
+
+        elapsed = (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) * 1e-9;
+        fprintf(stderr, "count: %d, elapsed: %.6f\n", count, elapsed);
+        if (count != TICK_COUNT) {
+                goto bail;
+        }
+        if (elapsed < TICK_COUNT * TICK_INTERVAL * 0.9) {
+                fprintf(stderr, "timer fired too early\n");
+                goto bail;
+        }
+        if (elapsed > TICK_COUNT * TICK_INTERVAL * 10) {
+                fprintf(stderr, "timer fired too late\n");
+                goto bail;
+        }
+
+        medusa_monitor_destroy(monitor);
+        return 0;
+bail:   if (monitor != NULL) {
+                medusa_monitor_destroy(monitor);
+        }
+        return -1;
+}
+
+static void alarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+
+        (void) argc;
+        (void) argv;
+
+        srand(time(NULL));
+        signal(SIGALRM, alarm_handler);
+
+        for (i = 0; i < sizeof(g_polls) / sizeof(g_polls[0]); i++) {
+                alarm(5);
+                fprintf(stderr, "testing poll: %d\n", g_polls[i]);
+
+                rc = test_poll(g_polls[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "  failed\n");
+                        return -1;
+                }
+                fprintf(stderr, "success\n");
+        }
+        return 0;
+}
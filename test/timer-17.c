@@ -0,0 +1,176 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+
+#include "medusa/error.h"
+#include "medusa/clock.h"
+#include "medusa/timer.h"
+#include "medusa/monitor.h"
+
+#define TIMER_COUNT     256
+#define TIMER_INTERVAL  300
+#define TIMER_EARLY     0.001
+#define TIMER_LATE      0.050
+
+static const unsigned int g_polls[] = {
+        MEDUSA_MONITOR_POLL_DEFAULT,
+#if defined(__LINUX__)
+        MEDUSA_MONITOR_POLL_EPOLL,
+        MEDUSA_MONITOR_POLL_IO_URING,
+#endif
+#if defined(__APPLE__)
+        MEDUSA_MONITOR_POLL_KQUEUE,
+#endif
+        MEDUSA_MONITOR_POLL_POLL,
+        MEDUSA_MONITOR_POLL_SELECT
+};
+
+struct entry {
+        struct timespec deadline;
+        int fired;
+        int *count;
+        int *failed;
+};
+
+static int timer_onevent (struct medusa_timer *timer, unsigned int events, void *context, ...)
+{
+        double diff;
+        struct timespec now;
+        struct entry *entry = (struct entry *) context;
+        if (events & MEDUSA_TIMER_EVENT_TIMEOUT) {
+                medusa_clock_monotonic(&now);
+                diff = (now.tv_sec - entry->deadline.tv_sec) + (now.tv_nsec - entry->deadline.tv_nsec) * 1e-9;
+                if (diff < -TIMER_EARLY || diff > TIMER_LATE) {
+                        fprintf(stderr, "timer fired off deadline: %.6f\n", diff);
+                        *entry->failed = 1;
+                }
+                entry->fired += 1;
+                *entry->count += 1;
+                if (*entry->count == TIMER_COUNT) {
+                        return medusa_monitor_break(medusa_timer_get_monitor(timer));
+                }
+        }
+        return 0;
+}
+
+static int test_poll (unsigned int poll, unsigned int flags, int coarse)
+{
+        int i;
+        int rc;
+        int count;
+        int failed;
+        double interval;
+        struct timespec now;
+
+        struct entry entries[TIMER_COUNT];
+        struct medusa_timer *timer;
+        struct medusa_monitor *monitor;
+        struct medusa_monitor_init_options options;
+
+        count = 0;
+        failed = 0;
+        monitor = NULL;
+
+        medusa_monitor_init_options_default(&options);
+        options.poll.type = poll;
+        options.flags    |= flags;
+
+        monitor = medusa_monitor_create(&options);
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                fprintf(stderr, "medusa_monitor_create failed\n");
+                goto bail;
+        }
+
+        medusa_clock_monotonic(&now);
+        for (i = 0; i < TIMER_COUNT; i++) {
+                interval = (1 + rand() % TIMER_INTERVAL) / 1000.0;
+                entries[i].deadline.tv_sec  = now.tv_sec + (long) interval;
+                entries[i].deadline.tv_nsec = now.tv_nsec + (long) ((interval - (long) interval) * 1e9);
+                if (entries[i].deadline.tv_nsec >= 1000000000) {
+                        entries[i].deadline.tv_sec  += 1;
+                        entries[i].deadline.tv_nsec -= 1000000000;
+                }
+                entries[i].fired  = 0;
+                entries[i].count  = &count;
+                entries[i].failed = &failed;
+                timer = medusa_timer_create(monitor, timer_onevent, &entries[i]);
+                if (MEDUSA_IS_ERR_OR_NULL(timer)) {
+                        fprintf(stderr, "medusa_timer_create failed\n");
+                        goto bail;
+                }
+                rc  = medusa_timer_set_coarse(timer, coarse);
+                rc |= medusa_timer_set_interval(timer, interval);
+                rc |= medusa_timer_set_singleshot(timer, 1);
+                rc |= medusa_timer_set_enabled(timer, 1);
+                if (rc < 0) {
+                        fprintf(stderr, "can not setup timer\n");
+                        goto bail;
+                }
+                if (medusa_timer_get_coarse(timer) != coarse) {
+                        goto bail;
+                }
+        }
+
+        rc = medusa_monitor_run(monitor);
+        if (rc != 0) {
+                fprintf(stderr, "can not run monitor\n");
+                goto bail;
+        }
+        fprintf(stderr, "count: %d, failed: %d\n", count, failed);
+        if (count != TIMER_COUNT || failed != 0) {
+                goto bail;
+        }
+        for (i = 0; i < TIMER_COUNT; i++) {
+                if (entries[i].fired != 1) {
+                        goto bail;
+                }
+        }
+
+        medusa_monitor_destroy(monitor);
+        return 0;
+bail:   if (monitor != NULL) {
+                medusa_monitor_destroy(monitor);
+        }
+        return -1;
+}
+
+static void alarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+
+        (void) argc;
+        (void) argv;
+
+        srand(time(NULL));
+        signal(SIGALRM, alarm_handler);
+
+        for (i = 0; i < sizeof(g_polls) / sizeof(g_polls[0]); i++) {
+                alarm(5);
+                fprintf(stderr, "testing poll: %d\n", g_polls[i]);
+
+                rc = test_poll(g_polls[i], MEDUSA_MONITOR_FLAG_NONE, 1);
+                if (rc != 0) {
+                        fprintf(stderr, "  failed\n");
+                        return -1;
+                }
+                rc = test_poll(g_polls[i], MEDUSA_MONITOR_FLAG_TIMER_WHEEL, 0);
+                if (rc != 0) {
+                        fprintf(stderr, "  failed\n");
+                        return -1;
+                }
+                fprintf(stderr, "success\n");
+        }
+        return 0;
+}
@@ -0,0 +1,173 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+
+#include "medusa/error.h"
+#include "medusa/clock.h"
+#include "medusa/timer.h"
+#include "medusa/monitor.h"
+
+#define TIMER_COUNT     4096
+#define TIMER_FIRES     3
+#define TIMER_INTERVAL  0.010
+
+static const unsigned int g_polls[] = {
+        MEDUSA_MONITOR_POLL_DEFAULT,
+#if defined(__LINUX__)
+        MEDUSA_MONITOR_POLL_EPOLL,
+        MEDUSA_MONITOR_POLL_IO_URING,
+#endif
+#if defined(__APPLE__)
+        MEDUSA_MONITOR_POLL_KQUEUE,
+#endif
+        MEDUSA_MONITOR_POLL_POLL,
+        MEDUSA_MONITOR_POLL_SELECT
+};
+
+struct entry {
+        struct medusa_timer *timer;
+        struct entry *peer;
+        int fired;
+        int destroyed;
+        int *pending;
+        int *failed;
+};
+
+static int timer_onevent (struct medusa_timer *timer, unsigned int events, void *context, ...)
+{
+        struct entry *entry = (struct entry *) context;
+        if (events & MEDUSA_TIMER_EVENT_TIMEOUT) {
+                if (entry->destroyed) {
+                        fprintf(stderr, "timer fired after destroy\n");
+                        *entry->failed = 1;
+                }
+                entry->fired += 1;
+                if (entry->peer != NULL &&
+                    entry->peer->destroyed == 0) {
+                        entry->peer->destroyed = 1;
+                        *entry->pending -= 1;
+                        medusa_timer_destroy(entry->peer->timer);
+                }
+                if (entry->fired == TIMER_FIRES) {
+                        medusa_timer_set_enabled(timer, 0);
+                        *entry->pending -= 1;
+                }
+                if (*entry->pending == 0) {
+                        return medusa_monitor_break(medusa_timer_get_monitor(timer));
+                }
+        }
+        return 0;
+}
+
+static int test_poll (unsigned int poll)
+{
+        int i;
+        int rc;
+        int failed;
+        int pending;
+
+        struct entry *entries;
+        struct medusa_monitor *monitor;
+        struct medusa_monitor_init_options options;
+
+        failed = 0;
+        pending = TIMER_COUNT;
+        monitor = NULL;
+
+        entries = malloc(sizeof(struct entry) * TIMER_COUNT);
+        if (entries == NULL) {
+                goto bail;
+        }
+        memset(entries, 0, sizeof(struct entry) * TIMER_COUNT);
+
+        medusa_monitor_init_options_default(&options);
+        options.poll.type = poll;
+
+        monitor = medusa_monitor_create(&options);
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                fprintf(stderr, "medusa_monitor_create failed\n");
+                goto bail;
+        }
+
+        for (i = 0; i < TIMER_COUNT; i++) {
+                entries[i].pending = &pending;
+                entries[i].failed  = &failed;
+                entries[i].peer    = ((i % 8) == 0) ? &entries[i + 1] : NULL;
+                entries[i].timer   = medusa_timer_create(monitor, timer_onevent, &entries[i]);
+                if (MEDUSA_IS_ERR_OR_NULL(entries[i].timer)) {
+                        fprintf(stderr, "medusa_timer_create failed\n");
+                        goto bail;
+                }
+                rc  = medusa_timer_set_interval(entries[i].timer, TIMER_INTERVAL);
+                rc |= medusa_timer_set_singleshot(entries[i].timer, 0);
+                rc |= medusa_timer_set_enabled(entries[i].timer, 1);
+                if (rc < 0) {
+                        fprintf(stderr, "can not setup timer\n");
+                        goto bail;
+                }
+        }
+
+        rc = medusa_monitor_run(monitor);
+        if (rc != 0) {
+                fprintf(stderr, "can not run monitor\n");
+                goto bail;
+        }
+        fprintf(stderr, "pending: %d, failed: %d\n", pending, failed);
+        if (pending != 0 || failed != 0) {
+                goto bail;
+        }
+        for (i = 0; i < TIMER_COUNT; i++) {
+                if (entries[i].destroyed == 0 &&
+                    entries[i].fired != TIMER_FIRES) {
+                        fprintf(stderr, "timer: %d, fired: %d\n", i, entries[i].fired);
+                        goto bail;
+                }
+        }
+
+        medusa_monitor_destroy(monitor);
+        free(entries);
+        return 0;
+bail:   if (monitor != NULL) {
+                medusa_monitor_destroy(monitor);
+        }
+        if (entries != NULL) {
+                free(entries);
+        }
+        return -1;
+}
+
+static void alarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+
+        (void) argc;
+        (void) argv;
+
+        srand(time(NULL));
+        signal(SIGALRM, alarm_handler);
+
+        for (i = 0; i < sizeof(g_polls) / sizeof(g_polls[0]); i++) {
+                alarm(5);
+                fprintf(stderr, "testing poll: %d\n", g_polls[i]);
+
+                rc = test_poll(g_polls[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "  failed\n");
+                        return -1;
+                }
+                fprintf(stderr, "success\n");
+        }
+        return 0;
+}
@@ -0,0 +1,181 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+
+#include "medusa/error.h"
+#include "medusa/clock.h"
+#include "medusa/timer.h"
+#include "medusa/monitor.h"
+
+#define TIMER_COUNT     8192
+#define TIMER_INTERVAL  0.010
+
+static const unsigned int g_polls[] = {
+        MEDUSA_MONITOR_POLL_DEFAULT,
+#if defined(__LINUX__)
+        MEDUSA_MONITOR_POLL_EPOLL,
+        MEDUSA_MONITOR_POLL_IO_URING,
+#endif
+#if defined(__APPLE__)
+        MEDUSA_MONITOR_POLL_KQUEUE,
+#endif
+        MEDUSA_MONITOR_POLL_POLL,
+        MEDUSA_MONITOR_POLL_SELECT
+};
+
+static int timer_onevent (struct medusa_timer *timer, unsigned int events, void *context, ...)
+{
+        int *pending = (int *) context;
+        if (events & MEDUSA_TIMER_EVENT_TIMEOUT) {
+                *pending -= 1;
+                if (*pending == 0) {
+                        return medusa_monitor_break(medusa_timer_get_monitor(timer));
+                }
+        }
+        return 0;
+}
+
+static int test_poll (unsigned int poll)
+{
+        int i;
+        int rc;
+        int pending;
+
+        struct medusa_timer *timer;
+        struct medusa_timer **timers;
+        struct medusa_timer_init_options *timer_options;
+        struct medusa_monitor *monitor;
+        struct medusa_monitor_init_options options;
+
+        pending = TIMER_COUNT;
+        monitor = NULL;
+        timers = NULL;
+        timer_options = NULL;
+
+        timers = malloc(sizeof(struct medusa_timer *) * TIMER_COUNT);
+        if (timers == NULL) {
+                goto bail;
+        }
+        timer_options = malloc(sizeof(struct medusa_timer_init_options) * TIMER_COUNT);
+        if (timer_options == NULL) {
+                goto bail;
+        }
+
+        medusa_monitor_init_options_default(&options);
+        options.poll.type = poll;
+
+        monitor = medusa_monitor_create(&options);
+        if (MEDUSA_IS_ERR_OR_NULL(monitor)) {
+                fprintf(stderr, "medusa_monitor_create failed\n");
+                goto bail;
+        }
+
+        for (i = 0; i < TIMER_COUNT; i++) {
+                medusa_timer_init_options_default(&timer_options[i]);
+                timer_options[i].monitor    = monitor;
+                timer_options[i].onevent    = timer_onevent;
+                timer_options[i].context    = &pending;
+                timer_options[i].interval   = 1 + rand() % 100;
+                timer_options[i].singleshot = 1;
+                timer_options[i].enabled    = 1;
+        }
+        timer_options[TIMER_COUNT - 1].monitor = NULL;
+        rc = medusa_timer_create_bulk(timer_options, TIMER_COUNT, timers);
+        if (rc != -EINVAL) {
+                fprintf(stderr, "medusa_timer_create_bulk did not fail\n");
+                goto bail;
+        }
+        timer_options[TIMER_COUNT - 1].monitor = monitor;
+        rc = medusa_timer_create_bulk(timer_options, TIMER_COUNT, timers);
+        if (rc < 0) {
+                fprintf(stderr, "medusa_timer_create_bulk failed\n");
+                goto bail;
+        }
+
+        timer = timers[TIMER_COUNT - 1];
+        timers[TIMER_COUNT - 1] = NULL;
+        rc = medusa_timer_set_interval_bulk(timers, TIMER_COUNT, TIMER_INTERVAL);
+        timers[TIMER_COUNT - 1] = timer;
+        if (rc != -EINVAL) {
+                fprintf(stderr, "medusa_timer_set_interval_bulk did not fail\n");
+                goto bail;
+        }
+        for (i = 0; i < TIMER_COUNT; i++) {
+                if (medusa_timer_get_interval(timers[i]) == TIMER_INTERVAL) {
+                        fprintf(stderr, "timer: %d, interval changed by a failed batch\n", i);
+                        goto bail;
+                }
+        }
+        rc = medusa_timer_set_interval_bulk(timers, TIMER_COUNT, TIMER_INTERVAL);
+        if (rc < 0) {
+                fprintf(stderr, "medusa_timer_set_interval_bulk failed\n");
+                goto bail;
+        }
+        for (i = 0; i < TIMER_COUNT; i++) {
+                if (medusa_timer_get_interval(timers[i]) != TIMER_INTERVAL) {
+                        fprintf(stderr, "timer: %d, interval is invalid\n", i);
+                        goto bail;
+                }
+        }
+
+        rc = medusa_monitor_run(monitor);
+        if (rc != 0) {
+                fprintf(stderr, "can not run monitor\n");
+                goto bail;
+        }
+        fprintf(stderr, "pending: %d\n", pending);
+        if (pending != 0) {
+                goto bail;
+        }
+
+        medusa_monitor_destroy(monitor);
+        free(timer_options);
+        free(timers);
+        return 0;
+bail:   if (monitor != NULL) {
+                medusa_monitor_destroy(monitor);
+        }
+        if (timer_options != NULL) {
+                free(timer_options);
+        }
+        if (timers != NULL) {
+                free(timers);
+        }
+        return -1;
+}
+
+static void alarm_handler (int sig)
+{
+        (void) sig;
+        abort();
+}
+
+int main (int argc, char *argv[])
+{
+        int rc;
+        unsigned int i;
+
+        (void) argc;
+        (void) argv;
+
+        srand(time(NULL));
+        signal(SIGALRM, alarm_handler);
+
+        for (i = 0; i < sizeof(g_polls) / sizeof(g_polls[0]); i++) {
+                alarm(5);
+                fprintf(stderr, "testing poll: %d\n", g_polls[i]);
+
+                rc = test_poll(g_polls[i]);
+                if (rc != 0) {
+                        fprintf(stderr, "  failed\n");
+                        return -1;
+                }
+                fprintf(stderr, "success\n");
+        }
+        return 0;
+}